@@ -0,0 +1,190 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <mutex>
+
+// decides how many decode workers to run, and how many camera frames to let in the door.
+// the thing we're maximizing is recovered bytes/s -- not frames/s. More workers isn't better if the phone is
+// thermal throttling (every decode just gets slower), and more frames isn't better if we can't decode them.
+//
+// every `window` (checked on every admit() and every decode), we look at what the last window got us:
+// * workers: hill climbing. Keep going in the same direction (+1/-1 worker) while bytes/s improves, go back when it doesn't.
+//   after going back, sit still for a few windows before poking at it again.
+//   if it's a wash and nothing is waiting on us, we drop a worker -- no point in burning the battery.
+// * sampling: let in ~2x as many frames as the workers could decode at their current speed (3x if few of them were
+//   perfect, since then more looks means more chances at a good one). It's what they *could* do, not what they did --
+//   otherwise fewer frames means fewer decodes means fewer frames...
+//   if we're not decoding anything at all, let everything in: we're probably still looking for the code.
+//   (and leave the workers alone. An empty window tells us nothing about how many we need.)
+class AdmissionController
+{
+public:
+	using clock = std::chrono::steady_clock;
+
+public:
+	AdmissionController(unsigned max_workers, unsigned min_workers=1, clock::duration window=std::chrono::seconds(1));
+
+	// one per camera frame. false == skip it
+	bool admit(clock::time_point now=clock::now());
+
+	// one per decode
+	void record_decode(unsigned bytes, bool perfect, clock::duration latency, unsigned backlog, clock::time_point now=clock::now());
+
+	unsigned workers() const;
+	unsigned sample_every() const;
+	double bytes_per_second() const;
+
+protected:
+	// mutex held
+	void check_window(clock::time_point now);
+	void adjust(double seconds, unsigned backlog);
+
+protected:
+	const unsigned _minWorkers;
+	const unsigned _maxWorkers;
+	const clock::duration _window;
+
+	std::atomic<unsigned> _workers;
+	std::atomic<unsigned> _sampleEvery = 1;
+	std::atomic<unsigned> _offered = 0;
+	std::atomic<double> _bytesPerSecond = 0;
+
+	std::mutex _mutex; // for everything below
+	clock::time_point _windowStart;
+	unsigned _decoded = 0;
+	unsigned _perfect = 0;
+	size_t _bytes = 0;
+	clock::duration _latency = clock::duration::zero();
+	unsigned _maxBacklog = 0;
+
+	int _direction = 1;
+	unsigned _hold = 0;
+	double _lastBytesPerSecond = -1;
+	double _lastLatency = 0;
+};
+
+inline AdmissionController::AdmissionController(unsigned max_workers, unsigned min_workers, clock::duration window)
+	: _minWorkers(std::max(1U, min_workers))
+	, _maxWorkers(std::max(_minWorkers, max_workers))
+	, _window(window)
+	, _workers(std::max(_minWorkers, (_maxWorkers+1)/2)) // start in the middle, and feel our way from there
+	, _windowStart(clock::now())
+{
+}
+
+inline bool AdmissionController::admit(clock::time_point now)
+{
+	// decodes alone can't be the clock: if nothing makes it that far, we'd never notice and never let more frames in
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		check_window(now);
+	}
+
+	unsigned count = _offered++;
+	return count % _sampleEvery == 0;
+}
+
+inline void AdmissionController::record_decode(unsigned bytes, bool perfect, clock::duration latency, unsigned backlog, clock::time_point now)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	++_decoded;
+	_perfect += perfect;
+	_bytes += bytes;
+	_latency += latency;
+	_maxBacklog = std::max(_maxBacklog, backlog);
+	check_window(now);
+}
+
+inline void AdmissionController::check_window(clock::time_point now)
+{
+	if (now - _windowStart < _window)
+		return;
+
+	double seconds = std::chrono::duration<double>(now - _windowStart).count();
+	adjust(seconds, _maxBacklog);
+
+	_windowStart = now;
+	_decoded = _perfect = _maxBacklog = 0;
+	_bytes = 0;
+	_latency = clock::duration::zero();
+}
+
+inline void AdmissionController::adjust(double seconds, unsigned backlog)
+{
+	unsigned offered = _offered.exchange(0);
+	double bytesPerSecond = _bytes / seconds;
+	_bytesPerSecond = bytesPerSecond;
+
+	if (!_decoded)
+	{
+		// nothing to go on. Let everything in, and start the worker comparison over once there's a code to look at
+		_sampleEvery = 1;
+		_lastBytesPerSecond = -1;
+		_lastLatency = 0;
+		_hold = 0;
+		return;
+	}
+
+	double latency = std::chrono::duration<double>(_latency).count() / _decoded;
+
+	// workers
+	int step = _direction;
+	if (_lastBytesPerSecond >= 0)
+	{
+		bool better = bytesPerSecond > _lastBytesPerSecond * 1.05;
+		bool worse = bytesPerSecond < _lastBytesPerSecond * 0.95;
+		// throttling: everyone got slower, and we have nothing to show for it
+		bool slower = _lastLatency > 0 and latency > _lastLatency * 1.3;
+
+		if (worse or (slower and !better))
+		{
+			// undo the last step, then stay there for a bit
+			_direction = -_direction;
+			step = _direction;
+			_hold = 4;
+		}
+		else if (_hold)
+		{
+			--_hold;
+			step = 0;
+		}
+		else if (!better and backlog == 0)
+			step = _direction = -1;
+	}
+	int workers = std::clamp<int>((int)_workers + step, _minWorkers, _maxWorkers);
+	if (step and workers == (int)_workers)
+		_direction = -_direction; // hit a wall. Try the other way next time
+	_workers = workers;
+
+	_lastBytesPerSecond = bytesPerSecond;
+	_lastLatency = latency;
+
+	// sampling
+	unsigned sampleEvery = 1;
+	if (latency > 0)
+	{
+		double capacity = workers / latency;
+		double offeredRate = offered / seconds;
+		double headroom = (_perfect * 4 < _decoded)? 3.0 : 2.0;
+		sampleEvery = std::clamp<unsigned>(std::floor(offeredRate / (capacity * headroom)), 1, 8);
+	}
+	_sampleEvery = sampleEvery;
+}
+
+inline unsigned AdmissionController::workers() const
+{
+	return _workers;
+}
+
+inline unsigned AdmissionController::sample_every() const
+{
+	return _sampleEvery;
+}
+
+inline double AdmissionController::bytes_per_second() const
+{
+	return _bytesPerSecond;
+}
@@ -1,21 +1,44 @@
 #pragma once
 
+#include "AdmissionController.h"
 #include "compression/zstd_decompressor.h"
 #include "encoder/Decoder.h"
 #include "extractor/Anchor.h"
+#include "extractor/Corners.h"
 #include "extractor/Deskewer.h"
 #include "extractor/Extractor.h"
 #include "extractor/Scanner.h"
 #include "fountain/concurrent_fountain_decoder_sink.h"
+#include "util/bounded_queue.h"
 
 #include "concurrent/thread_pool.h"
 #include <opencv2/opencv.hpp>
+#include <atomic>
+#include <condition_variable>
 #include <fstream>
-
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// scan -> deskew -> decode (symbols, colors, reed solomon) -> fountain.
+// the stages are connected by small queues that throw out the oldest frame when they fill up:
+// the camera gives us frames faster than we can decode them, and the freshest one is the one worth working on.
+// the fountain stage is the consumer thread inside concurrent_fountain_decoder_sink.
+//
+// the other stages share one thread_pool (a thread per core). Each task takes one frame through one stage, and each
+// stage has a cap on how many tasks it can have going at once. When the pool is busy, the further along a frame is,
+// the sooner it gets a thread: decode is HIGH, deskew NORMAL, scan LOW.
+//
+// how many decodes can run at once -- and how many camera frames we bother to scan -- is up to the
+// AdmissionController, which watches decode latency, backlog and perfect frames, and chases recovered bytes/s.
+// `decode_threads` is the most it's allowed to use.
 class MultiThreadedDecoder
 {
 public:
-	MultiThreadedDecoder(std::string data_path, int mode_val);
+	MultiThreadedDecoder(std::string data_path, int mode_val, unsigned scan_threads=0, unsigned decode_threads=0);
+	~MultiThreadedDecoder();
 
 	inline static clock_t count = 0;
 	inline static clock_t bytes = 0;
@@ -34,92 +57,231 @@ public:
 	bool set_mode(int mode_val);
 	int detected_mode() const;
 
+	// the anchors from the most recent scan -- good or not. Doesn't wait on any decodes, so it's good for UI hints.
+	std::vector<Anchor> latest_scan() const;
+
 	unsigned num_threads() const;
 	unsigned backlog() const;
+	unsigned sample_every() const;
+	unsigned dropped() const;
 	unsigned files_in_flight() const;
 	unsigned files_decoded() const;
+	unsigned files_evicted() const;
 	std::vector<std::string> get_done() const;
 	std::vector<double> get_progress() const;
 
 protected:
-	int do_extract(const cv::Mat& mat, cv::Mat& img);
+	// one frame, as it moves through the stages
+	struct job
+	{
+		cv::Mat mat;
+		bool legacy_mode = false;
+		std::vector<Anchor> anchors;
+		cv::Mat img;
+	};
+
+	// a queue of frames, and the pool tasks working on it
+	struct stage
+	{
+		stage(unsigned capacity, unsigned limit, turbo::thread_pool::priority prio, std::function<bool(job&)> fun, stage* next=nullptr)
+			: queue(capacity)
+			, limit(limit)
+			, prio(prio)
+			, fun(fun)
+			, next(next)
+		{}
+
+		bounded_queue<job> queue;
+		std::atomic<unsigned> limit;
+		std::atomic<unsigned> running = 0;
+		turbo::thread_pool::priority prio;
+		std::function<bool(job&)> fun; // false == this frame goes no further
+		stage* next;
+	};
+
+	void scan(job& j);
+	bool deskew(job& j);
+	bool decode(job& j);
+
+	void schedule(stage& st);
+	void run_stage(stage& st);
+	void update_decoders();
 	void save(const cv::Mat& img);
 
 	static unsigned fountain_chunk_size(int mode_val);
 
 protected:
-	int _modeVal;
-	int _detectedMode;
+	std::atomic<int> _modeVal;
+	std::atomic<int> _detectedMode;
 
 	Decoder _dec;
-	unsigned _numThreads;
-	turbo::thread_pool _pool;
+	unsigned _scanThreads;
+	unsigned _decodeThreads;
 	concurrent_fountain_decoder_sink<cimbar::zstd_decompressor<std::ofstream>> _writer;
 	std::string _dataPath;
+
+	AdmissionController _admission;
+	std::atomic<bool> _stopping;
+	std::atomic<unsigned> _admitted;
+
+	stage _decodeStage;
+	stage _deskewStage;
+	stage _scanStage;
+
+	// tasks handed to the pool that haven't finished yet. stop() waits for this to hit 0
+	std::atomic<unsigned> _tasks;
+	std::mutex _idleMutex;
+	std::condition_variable _idle;
+
+	std::shared_ptr<const std::vector<Anchor>> _latestScan;
+
+	// last, so it goes first: no task outlives the stages it's working on
+	turbo::thread_pool _pool;
 };
 
-inline MultiThreadedDecoder::MultiThreadedDecoder(std::string data_path, int mode_val)
+inline MultiThreadedDecoder::MultiThreadedDecoder(std::string data_path, int mode_val, unsigned scan_threads, unsigned decode_threads)
 	: _modeVal(mode_val)
 	, _detectedMode(0)
 	, _dec(cimbar::Config::ecc_bytes(), cimbar::Config::color_bits())
-	, _numThreads(std::max<int>(((int)std::thread::hardware_concurrency()/2), 1))
-	, _pool(_numThreads, 1)
+	, _scanThreads(scan_threads? scan_threads : std::max<int>(((int)std::thread::hardware_concurrency()/4), 1))
+	, _decodeThreads(decode_threads? decode_threads : std::max<int>(((int)std::thread::hardware_concurrency()/2), 1))
 	, _writer(data_path, fountain_chunk_size(mode_val))
 	, _dataPath(data_path)
+	, _admission(_decodeThreads)
+	, _stopping(false)
+	, _admitted(0)
+	, _decodeStage(_decodeThreads, _admission.workers(), turbo::thread_pool::HIGH, [this](job& j) { return decode(j); })
+	, _deskewStage(1, 1, turbo::thread_pool::NORMAL, [this](job& j) { return deskew(j); }, &_decodeStage)
+	, _scanStage(_scanThreads, _scanThreads, turbo::thread_pool::LOW, [this](job& j) { scan(j); return j.anchors.size() >= 4; }, &_deskewStage)
+	, _tasks(0)
+	, _latestScan(std::make_shared<const std::vector<Anchor>>())
+	, _pool(std::max(2U, std::thread::hardware_concurrency()))
 {
 	FountainInit::init();
 	_pool.start();
 }
 
-inline int MultiThreadedDecoder::do_extract(const cv::Mat& mat, cv::Mat& img)
+inline MultiThreadedDecoder::~MultiThreadedDecoder()
+{
+	stop();
+}
+
+// one more task for this stage -- if it's under its limit
+inline void MultiThreadedDecoder::schedule(stage& st)
+{
+	unsigned running = st.running;
+	do {
+		if (running >= st.limit)
+			return;
+	} while (!st.running.compare_exchange_weak(running, running+1));
+
+	++_tasks;
+	_pool.execute([this, &st]() { run_stage(st); }, st.prio);
+}
+
+inline void MultiThreadedDecoder::run_stage(stage& st)
+{
+	// one frame per task. If a decode shows up while we're scanning, it shouldn't have to wait on a whole queue of scans
+	if (std::optional<job> j = st.queue.try_pop())
+	{
+		if (st.fun(*j) and st.next and st.next->queue.push_latest(std::move(*j)))
+			schedule(*st.next);
+	}
+
+	// if there's more to do -- or a push lost the race with our decrement -- go again
+	--st.running;
+	if (st.queue.size())
+		schedule(st);
+
+	if (--_tasks == 0)
+	{
+		std::lock_guard<std::mutex> lock(_idleMutex);
+		_idle.notify_all();
+	}
+}
+
+inline void MultiThreadedDecoder::scan(job& j)
 {
 	clock_t begin = clock();
 
-	Scanner scanner(mat);
-	std::vector<Anchor> anchors = scanner.scan();
+	Scanner scanner(j.mat);
+	j.anchors = scanner.scan();
 	++scanned;
 	scanTicks += (clock() - begin);
 
-	//if (anchors.size() >= 3) save(mat);
-
-	if (anchors.size() < 4)
-		return Extractor::FAILURE;
+	std::atomic_store(&_latestScan, std::make_shared<const std::vector<Anchor>>(j.anchors));
+	//if (j.anchors.size() >= 3) save(j.mat);
+}
 
-	begin = clock();
-	Corners corners(anchors);
+inline bool MultiThreadedDecoder::deskew(job& j)
+{
+	clock_t begin = clock();
+	Corners corners(j.anchors);
 	Deskewer de;
-	img = de.deskew(mat, corners);
+	j.img = de.deskew(j.mat, corners);
 	extractTicks += (clock() - begin);
 
-	return Extractor::SUCCESS;
+	// done with the camera frame
+	j.mat.release();
+	return true;
 }
 
-inline bool MultiThreadedDecoder::add(cv::Mat mat)
+inline bool MultiThreadedDecoder::decode(job& j)
 {
-    ++count;
-    bool legacy_mode = _modeVal == 4 or (_modeVal == 0 and count%2 == 0);
-    return _pool.try_execute( [&, mat, legacy_mode] () {
-		cv::Mat img;
-		int res = do_extract(mat, img);
-		if (res == Extractor::FAILURE)
-			return;
+	clock_t begin = clock();
+	AdmissionController::clock::time_point start = AdmissionController::clock::now();
+	// if extracted image is small, we'll need to run some filters on it
+	bool should_preprocess = false;
+	int color_correction = j.legacy_mode? 1 : 2;
+	unsigned color_mode = j.legacy_mode? 0 : 1;
+	unsigned decodeRes = _dec.decode_fountain(j.img, _writer, color_mode, should_preprocess, color_correction);
+	bytes += decodeRes;
+	++decoded;
+	decodeTicks += clock() - begin;
+
+	if (decodeRes and _modeVal == 0)
+		_detectedMode = j.legacy_mode? 4 : 68;
+
+	bool isPerfect = decodeRes >= 6900;
+	if (isPerfect)
+		++perfect;
+
+	AdmissionController::clock::time_point now = AdmissionController::clock::now();
+	_admission.record_decode(decodeRes, isPerfect, now - start, backlog(), now);
+	update_decoders();
+	return true;
+}
 
-		// if extracted image is small, we'll need to run some filters on it
-		clock_t begin = clock();
-		bool should_preprocess = (res == Extractor::NEEDS_SHARPEN);
-		int color_correction = legacy_mode? 1 : 2;
-		unsigned color_mode = legacy_mode? 0 : 1;
-		unsigned decodeRes = _dec.decode_fountain(img, _writer, color_mode, should_preprocess, color_correction);
-		bytes += decodeRes;
-		++decoded;
-		decodeTicks += clock() - begin;
+// the admission controller can change its mind on an admit() or a decode. Either way, the decode stage needs to hear about it.
+// fewer: the extra tasks finish what they have, and aren't replaced. More: start them now, if there's work for them.
+inline void MultiThreadedDecoder::update_decoders()
+{
+	if (_stopping)
+		return;
 
-		if (decodeRes and _modeVal == 0)
-            _detectedMode = legacy_mode? 4 : 68;
+	unsigned workers = _admission.workers();
+	unsigned previous = _decodeStage.limit.exchange(workers);
+	for (unsigned i = previous; i < workers and _decodeStage.queue.size(); ++i)
+		schedule(_decodeStage);
+}
 
-		if (decodeRes >= 6900)
-			++perfect;
-	} );
+inline bool MultiThreadedDecoder::add(cv::Mat mat)
+{
+	++count;
+	bool admitted = _admission.admit();
+	update_decoders();
+	if (!admitted)
+		return false;
+
+	job j;
+	j.mat = mat;
+	// alternate on the frames we keep, not the ones we're offered -- or sampling every 2nd frame would only ever try one mode
+	j.legacy_mode = _modeVal == 4 or (_modeVal == 0 and _admitted++%2 == 0);
+	// latest frame wins
+	if (!_scanStage.queue.push_latest(std::move(j)))
+		return false;
+	schedule(_scanStage);
+	return true;
 }
 
 inline void MultiThreadedDecoder::save(const cv::Mat& mat)
@@ -133,6 +295,17 @@ inline void MultiThreadedDecoder::save(const cv::Mat& mat)
 
 inline void MultiThreadedDecoder::stop()
 {
+	// no new frames. Everything already in the pipeline gets to finish -- and every decoder we have helps
+	_scanStage.queue.close();
+	_stopping = true;
+	_decodeStage.limit = _decodeThreads;
+	for (unsigned i = 0; i < _decodeThreads and _decodeStage.queue.size(); ++i)
+		schedule(_decodeStage);
+
+	{
+		std::unique_lock<std::mutex> lock(_idleMutex);
+		_idle.wait(lock, [this]() { return _tasks == 0; });
+	}
 	_pool.stop();
 }
 
@@ -167,14 +340,33 @@ inline int MultiThreadedDecoder::detected_mode() const
 	return _detectedMode;
 }
 
+inline std::vector<Anchor> MultiThreadedDecoder::latest_scan() const
+{
+	return *std::atomic_load(&_latestScan);
+}
+
+// the most we'd use right now. Decodes the admission controller has shed don't count.
 inline unsigned MultiThreadedDecoder::num_threads() const
 {
-	return _numThreads;
+	return std::min(_scanThreads + 1 + _decodeStage.limit, _pool.num_threads());
 }
 
+// frames waiting on a stage
 inline unsigned MultiThreadedDecoder::backlog() const
 {
-	return _pool.queued();
+	return _scanStage.queue.size() + _deskewStage.queue.size() + _decodeStage.queue.size();
+}
+
+// we scan 1 out of every N camera frames
+inline unsigned MultiThreadedDecoder::sample_every() const
+{
+	return _admission.sample_every();
+}
+
+// frames that got bumped by a newer one
+inline unsigned MultiThreadedDecoder::dropped() const
+{
+	return _scanStage.queue.dropped() + _deskewStage.queue.dropped() + _decodeStage.queue.dropped();
 }
 
 inline unsigned MultiThreadedDecoder::files_in_flight() const
@@ -187,6 +379,12 @@ inline unsigned MultiThreadedDecoder::files_decoded() const
 	return _writer.num_done();
 }
 
+// partial files we gave up on, to make room for newer ones
+inline unsigned MultiThreadedDecoder::files_evicted() const
+{
+	return _writer.num_evicted();
+}
+
 inline std::vector<std::string> MultiThreadedDecoder::get_done() const
 {
 	return _writer.get_done();
@@ -0,0 +1,137 @@
+/* This code is subject to the terms of the Mozilla Public License, v.2.0. http://mozilla.org/MPL/2.0/. */
+#include "unittest.h"
+
+#include "AdmissionController.h"
+#include <chrono>
+#include <vector>
+
+using namespace std::chrono_literals;
+using clock_type = AdmissionController::clock;
+
+namespace {
+	// one (1s) window: `frames` camera frames, then `decodes` decodes. The last thing that happens lands on the window boundary,
+	// so the controller makes its call before we return.
+	// returns the end of the window, which is the start of the next one.
+	clock_type::time_point run_window(AdmissionController& ac, clock_type::time_point start, unsigned frames, unsigned decodes,
+									  unsigned backlog=1, clock_type::duration latency=40ms, unsigned* admitted=nullptr)
+	{
+		for (unsigned i = 0; i < frames; ++i)
+		{
+			bool in = ac.admit(start + (i+1) * 500ms / (frames+1));
+			if (admitted)
+				*admitted += in;
+		}
+		for (unsigned i = 0; i < decodes; ++i)
+			ac.record_decode(1000, true, latency, backlog, start + 500ms + (i+1) * 500ms / decodes);
+
+		clock_type::time_point end = start + 1s;
+		if (!decodes)
+			ac.admit(end);
+		return end;
+	}
+}
+
+TEST_CASE( "AdmissionControllerTest/testDefaults", "[unit]" )
+{
+	AdmissionController ac(8);
+	assertEquals( 4, ac.workers() );
+	assertEquals( 1, ac.sample_every() );
+
+	// nothing happens until the window is up
+	clock_type::time_point t = clock_type::now();
+	ac.record_decode(1000, true, 40ms, 1, t + 500ms);
+	assertTrue( ac.admit(t + 600ms) );
+	assertEquals( 4, ac.workers() );
+}
+
+TEST_CASE( "AdmissionControllerTest/testStepsWhileImproving", "[unit]" )
+{
+	AdmissionController ac(8);
+	clock_type::time_point t = clock_type::now();
+
+	// more workers, more bytes
+	std::vector<unsigned> seen;
+	for (unsigned i = 0; i < 3; ++i)
+	{
+		t = run_window(ac, t, 30, 10 * ac.workers());
+		seen.push_back(ac.workers());
+	}
+	assertEquals( (std::vector<unsigned>{5, 6, 7}), seen );
+}
+
+TEST_CASE( "AdmissionControllerTest/testReverseAndHold", "[unit]" )
+{
+	AdmissionController ac(8);
+	clock_type::time_point t = clock_type::now();
+
+	// the sweet spot is 5 workers. Past that we're throttling.
+	auto decodes = [] (unsigned workers) { return workers == 5? 50 : 40; };
+
+	std::vector<unsigned> seen;
+	for (unsigned i = 0; i < 9; ++i)
+	{
+		t = run_window(ac, t, 30, decodes(ac.workers()));
+		seen.push_back(ac.workers());
+	}
+	// 4 -> 5 (better) -> 6 (worse, back to 5), sit for 4 windows, try 4 (worse, back to 5)...
+	assertEquals( (std::vector<unsigned>{5, 6, 5, 5, 5, 5, 5, 4, 5}), seen );
+}
+
+TEST_CASE( "AdmissionControllerTest/testShedsIdleWorkers", "[unit]" )
+{
+	AdmissionController ac(8);
+	clock_type::time_point t = clock_type::now();
+
+	// the camera is the bottleneck: the same 30 decodes no matter how many of us there are, and nobody waiting
+	for (unsigned i = 0; i < 8; ++i)
+		t = run_window(ac, t, 30, 30, 0);
+	assertEquals( 1, ac.workers() );
+}
+
+TEST_CASE( "AdmissionControllerTest/testSampling", "[unit]" )
+{
+	AdmissionController ac(8);
+	clock_type::time_point t = clock_type::now();
+
+	// slow decodes, and way more frames than we could ever look at
+	t = run_window(ac, t, 240, 10, 1, 200ms);
+	assertEquals( 5, ac.workers() );
+	// 5 workers @ 200ms == 25 decodes/s. Let in 2x that, out of 240
+	assertEquals( 4, ac.sample_every() );
+
+	unsigned admitted = 0;
+	t = run_window(ac, t, 240, 10, 1, 200ms, &admitted);
+	assertInRange( 55, admitted, 65 );
+
+	// lots of bad frames: more looks, please
+	ac.record_decode(1000, false, 200ms, 1, t + 100ms);
+	for (unsigned i = 0; i < 240; ++i)
+		ac.admit(t + 200ms + i * 1ms);
+	ac.record_decode(1000, false, 200ms, 1, t + 1s);
+	assertInRange( 2, ac.sample_every(), 3 );
+}
+
+TEST_CASE( "AdmissionControllerTest/testSamplingRecovers", "[unit]" )
+{
+	AdmissionController ac(8);
+	clock_type::time_point t = clock_type::now();
+
+	t = run_window(ac, t, 240, 10, 1, 200ms);
+	assertEquals( 4, ac.sample_every() );
+	unsigned workers = ac.workers();
+
+	// the code goes out of view. Nothing makes it to decode -- but the camera keeps calling admit(), and that's enough
+	t = run_window(ac, t, 240, 0);
+	assertEquals( 1, ac.sample_every() );
+	assertEquals( workers, ac.workers() );
+
+	unsigned admitted = 0;
+	t = run_window(ac, t, 240, 0, 1, 40ms, &admitted);
+	assertEquals( 240, admitted );
+	assertEquals( workers, ac.workers() );
+	assertEquals( 0, ac.bytes_per_second() );
+
+	// and when it comes back, we start over: no comparison against the empty windows
+	t = run_window(ac, t, 30, 10);
+	assertEquals( workers + 1, ac.workers() );
+}
@@ -0,0 +1,4 @@
+/* This code is subject to the terms of the Mozilla Public License, v.2.0. http://mozilla.org/MPL/2.0/. */
+#define CATCH_CONFIG_MAIN
+#include "catch.hpp"
+
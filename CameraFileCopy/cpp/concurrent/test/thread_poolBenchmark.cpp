@@ -0,0 +1,98 @@
+/* This code is subject to the terms of the Mozilla Public License, v.2.0. http://mozilla.org/MPL/2.0/. */
+#include "unittest.h"
+
+#include "legacy_thread_pool.h"
+#include "thread_pool.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+// concurrent_test "[benchmark]"
+namespace {
+	// the time from execute() to the task running, and us hearing about it.
+	// the old pool can lose a wakeup and leave a task sitting there until the next execute(), so (like a camera would)
+	// we poke it with another task if we've waited too long. Those stalls are part of the latency.
+	class round_trip
+	{
+	public:
+		template <typename POOL>
+		void run(POOL& pool, unsigned tasks=1)
+		{
+			_remaining = tasks;
+			for (unsigned i = 0; i < tasks; ++i)
+				pool.execute([this]() { finish(); });
+
+			std::unique_lock<std::mutex> lock(_mutex);
+			while (!_done.wait_for(lock, std::chrono::milliseconds(5), [this]() { return _remaining == 0; }))
+				pool.execute([](){});
+		}
+
+	protected:
+		void finish()
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			if (--_remaining == 0)
+				_done.notify_one();
+		}
+
+	protected:
+		unsigned _remaining = 0;
+		std::mutex _mutex;
+		std::condition_variable _done;
+	};
+}
+
+TEST_CASE( "thread_poolBenchmark/latency", "[benchmark]" )
+{
+	round_trip rt;
+	{
+		turbo::legacy_thread_pool pool(4);
+		pool.start();
+		BENCHMARK( "legacy, 1 task" )
+		{
+			rt.run(pool);
+		};
+		BENCHMARK( "legacy, 16 tasks" )
+		{
+			rt.run(pool, 16);
+		};
+	}
+
+	{
+		turbo::thread_pool pool(4);
+		pool.start();
+		BENCHMARK( "work stealing, 1 task" )
+		{
+			rt.run(pool);
+		};
+		BENCHMARK( "work stealing, 16 tasks" )
+		{
+			rt.run(pool, 16);
+		};
+	}
+}
+
+TEST_CASE( "thread_poolBenchmark/parallel_for", "[benchmark]" )
+{
+	std::vector<float> data(1 << 16, 1.0f);
+	turbo::thread_pool pool(4);
+	pool.start();
+
+	BENCHMARK( "serial" )
+	{
+		for (unsigned i = 0; i < data.size(); i += 1024)
+			for (unsigned j = i; j < i + 1024; ++j)
+				data[j] = data[j] * 0.5f + 1.0f;
+		return data[0];
+	};
+
+	BENCHMARK( "parallel_for" )
+	{
+		pool.parallel_for(0, data.size() / 1024, [&data](unsigned block) {
+			for (unsigned j = block*1024; j < (block+1)*1024; ++j)
+				data[j] = data[j] * 0.5f + 1.0f;
+		});
+		return data[0];
+	};
+}
@@ -0,0 +1,244 @@
+/* This code is subject to the terms of the Mozilla Public License, v.2.0. http://mozilla.org/MPL/2.0/. */
+#include "unittest.h"
+
+#include "thread_pool.h"
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+TEST_CASE( "thread_poolTest/testExecute", "[unit]" )
+{
+	turbo::thread_pool pool(4);
+	assertTrue( pool.start() );
+
+	std::atomic<unsigned> count = 0;
+	std::promise<void> done;
+	for (unsigned i = 0; i < 1000; ++i)
+		pool.execute([&]() {
+			if (++count == 1000)
+				done.set_value();
+		});
+
+	assertTrue( done.get_future().wait_for(5s) == std::future_status::ready );
+	assertEquals( 0, pool.queued() );
+}
+
+TEST_CASE( "thread_poolTest/testNoLostWakeups", "[unit]" )
+{
+	// one task at a time, so the workers are always parked (or parking) when the next one shows up
+	turbo::thread_pool pool(2);
+	pool.start();
+
+	for (unsigned i = 0; i < 2000; ++i)
+	{
+		std::promise<void> ran;
+		pool.execute([&ran]() { ran.set_value(); });
+		assertTrue( ran.get_future().wait_for(1s) == std::future_status::ready );
+	}
+}
+
+TEST_CASE( "thread_poolTest/testPriority", "[unit]" )
+{
+	turbo::thread_pool pool(1);
+	pool.start();
+
+	// keep the only worker busy while we queue things up
+	std::promise<void> release;
+	std::shared_future<void> gate = release.get_future().share();
+	pool.execute([gate]() { gate.wait(); });
+
+	std::mutex mutex;
+	std::vector<int> order;
+	std::promise<void> done;
+	auto record = [&](int id) {
+		return [&, id]() {
+			std::lock_guard<std::mutex> lock(mutex);
+			order.push_back(id);
+			if (order.size() == 4)
+				done.set_value();
+		};
+	};
+	pool.execute(record(3), turbo::thread_pool::LOW);
+	pool.execute(record(2), turbo::thread_pool::NORMAL);
+	pool.execute(record(1), turbo::thread_pool::HIGH);
+	pool.execute(record(4), turbo::thread_pool::LOW);
+
+	release.set_value();
+	assertTrue( done.get_future().wait_for(5s) == std::future_status::ready );
+	assertEquals( 1, order[0] );
+	assertEquals( 2, order[1] );
+	assertEquals( 7, order[2] + order[3] ); // the two LOWs, in either order
+}
+
+TEST_CASE( "thread_poolTest/testSteal", "[unit]" )
+{
+	// a task queues more work on its own deque, then blocks until it's done.
+	// if nobody steals, we never finish.
+	turbo::thread_pool pool(2);
+	pool.start();
+
+	std::promise<bool> done;
+	pool.execute([&]() {
+		std::promise<void> child;
+		pool.execute([&child]() { child.set_value(); });
+		done.set_value(child.get_future().wait_for(5s) == std::future_status::ready);
+	});
+
+	std::future<bool> res = done.get_future();
+	assertTrue( res.wait_for(10s) == std::future_status::ready );
+	assertTrue( res.get() );
+}
+
+TEST_CASE( "thread_poolTest/testTryExecute", "[unit]" )
+{
+	turbo::thread_pool pool(1, 2);
+	pool.start();
+
+	std::promise<void> release;
+	std::shared_future<void> gate = release.get_future().share();
+	std::promise<void> started;
+	pool.execute([&started, gate]() { started.set_value(); gate.wait(); });
+	started.get_future().wait();
+
+	assertTrue( pool.try_execute([](){}) );
+	assertTrue( pool.try_execute([](){}) );
+	assertFalse( pool.try_execute([](){}) );
+	assertEquals( 2, pool.queued() );
+
+	release.set_value();
+}
+
+TEST_CASE( "thread_poolTest/testParallelFor", "[unit]" )
+{
+	turbo::thread_pool pool(4);
+	pool.start();
+
+	std::vector<unsigned> seen(10000, 0);
+	pool.parallel_for(0, seen.size(), [&seen](unsigned i) { seen[i] += i; });
+	for (unsigned i = 0; i < seen.size(); ++i)
+		assertEquals( i, seen[i] );
+
+	// nothing to do
+	pool.parallel_for(5, 5, [&seen](unsigned i) { seen[i] = 0; });
+	assertEquals( 5, seen[5] );
+}
+
+TEST_CASE( "thread_poolTest/testParallelForNested", "[unit]" )
+{
+	// every worker is busy in a parallel_for of its own. Nobody should end up waiting on a helper that can't run.
+	turbo::thread_pool pool(2);
+	pool.start();
+
+	std::atomic<unsigned> total = 0;
+	std::promise<void> done;
+	std::atomic<unsigned> outer = 0;
+	for (unsigned t = 0; t < 4; ++t)
+		pool.execute([&]() {
+			pool.parallel_for(0, 100, [&total](unsigned i) { total += i; });
+			if (++outer == 4)
+				done.set_value();
+		});
+
+	assertTrue( done.get_future().wait_for(10s) == std::future_status::ready );
+	assertEquals( 4*4950, total );
+}
+
+TEST_CASE( "thread_poolTest/testFifo", "[unit]" )
+{
+	// same priority, same worker: first come, first served. Whether it was submitted from inside the pool or not.
+	turbo::thread_pool pool(1);
+	pool.start();
+
+	std::promise<void> release;
+	std::shared_future<void> gate = release.get_future().share();
+	pool.execute([gate]() { gate.wait(); });
+
+	std::mutex mutex;
+	std::vector<int> order;
+	std::promise<void> done;
+	auto record = [&](int id) {
+		std::lock_guard<std::mutex> lock(mutex);
+		order.push_back(id);
+		if (order.size() == 6)
+			done.set_value();
+	};
+	pool.execute([&]() {
+		record(0);
+		// these go on the worker's own deque
+		for (int i = 3; i < 6; ++i)
+			pool.execute([&record, i]() { record(i); });
+	});
+	pool.execute([&record]() { record(1); });
+	pool.execute([&record]() { record(2); });
+
+	release.set_value();
+	assertTrue( done.get_future().wait_for(5s) == std::future_status::ready );
+	assertEquals( std::vector<int>({0, 1, 2, 3, 4, 5}), order );
+}
+
+TEST_CASE( "thread_poolTest/testStop", "[unit]" )
+{
+	turbo::thread_pool pool(2);
+	pool.start();
+
+	std::atomic<unsigned> count = 0;
+	for (unsigned i = 0; i < 100; ++i)
+		pool.execute([&count]() { ++count; });
+	pool.stop();
+	assertEquals( 0, pool.queued() );
+
+	// and again, for the destructor
+	pool.stop();
+	assertTrue( count <= 100 );
+}
+
+TEST_CASE( "thread_poolTest/testQueuedNeverWraps", "[unit]" )
+{
+	// lots of submitters, lots of thieves. queued() should never be more than what we've handed over --
+	// if a task gets popped before it's counted, the counter wraps and says otherwise.
+	turbo::thread_pool pool(4);
+	pool.start();
+
+	const unsigned numProducers = 4;
+	const unsigned perProducer = 50000;
+	std::atomic<size_t> submitted = 0;
+	std::atomic<size_t> worst = 0;
+	std::atomic<unsigned> ran = 0;
+	auto check = [&]() {
+		size_t q = pool.queued();
+		if (q > submitted)
+			worst = q;
+	};
+
+	std::atomic<bool> sampling = true;
+	std::thread sampler([&]() {
+		while (sampling)
+			check();
+	});
+
+	std::vector<std::thread> producers;
+	for (unsigned p = 0; p < numProducers; ++p)
+		producers.emplace_back([&]() {
+			for (unsigned i = 0; i < perProducer; ++i)
+			{
+				++submitted;
+				pool.execute([&]() { check(); ++ran; });
+			}
+		});
+	for (std::thread& t : producers)
+		t.join();
+
+	for (int i = 0; i < 500 and ran < numProducers*perProducer; ++i)
+		std::this_thread::sleep_for(10ms);
+	sampling = false;
+	sampler.join();
+
+	assertEquals( numProducers*perProducer, ran );
+	assertEquals( 0, worst );
+	assertEquals( 0, pool.queued() );
+}
@@ -1,52 +1,97 @@
 /* This code is subject to the terms of the Mozilla Public License, v.2.0. http://mozilla.org/MPL/2.0/. */
 #pragma once
 
-#include "monitor.h"
-#include "concurrentqueue/concurrentqueue.h"
+#include <algorithm>
+#include <array>
 #include <atomic>
+#include <condition_variable>
+#include <deque>
 #include <functional>
 #include <list>
+#include <memory>
+#include <mutex>
 #include <thread>
+#include <vector>
 
 namespace turbo {
+
+// work stealing: every worker has its own deque (one per priority). Workers take from the front of their own,
+// and when they run dry, steal from the front of everyone else's -- so within a priority, a deque is first in, first out.
+// (no LIFO for the owner: our tasks are frames, and the oldest one is the one somebody is waiting on.)
+// tasks submitted from a worker go on that worker's deque. Everything else is dealt out round robin.
+// a higher priority task anywhere in the pool goes before a lower priority one, local or not.
 class thread_pool
 {
+public:
+	enum priority { HIGH = 0, NORMAL = 1, LOW = 2 };
+	static constexpr unsigned NUM_PRIORITIES = 3;
+
 public:
 	thread_pool(unsigned numThreads = std::thread::hardware_concurrency());
-	thread_pool(unsigned numThreads, unsigned producerLimit); // tries to limit size of queue
+	thread_pool(unsigned numThreads, unsigned producerLimit); // try_execute() fails if this many tasks are already queued
 	~thread_pool();
 
 	bool start();
 	void stop();
 
-	void execute(std::function<void()> fun);
-	bool try_execute(std::function<void()> fun);
+	void execute(std::function<void()> fun, priority prio=NORMAL);
+	bool try_execute(std::function<void()> fun, priority prio=NORMAL);
 	size_t queued() const;
+	unsigned num_threads() const;
+
+	// fun(i) for i in [begin, end), split across the pool. The calling thread pitches in, and we return when it's all done.
+	// safe to call from a pool thread: if every worker is busy, the caller just does it all itself.
+	// (it's for splitting up work *within* a stage. Helpers queue FIFO like anything else, so they don't jump ahead of older frames.)
+	template <typename FUN>
+	void parallel_for(unsigned begin, unsigned end, const FUN& fun, priority prio=HIGH);
 
 protected:
-	void run();
+	struct worker
+	{
+		std::mutex mutex;
+		std::array<std::deque<std::function<void()>>, NUM_PRIORITIES> tasks;
+	};
+
+	void push(std::function<void()>&& fun, priority prio);
+	bool pop(unsigned index, std::function<void()>& fun);
+	void run(unsigned index);
 
 protected:
-	std::atomic<int> _running;
+	std::atomic<bool> _running;
 	unsigned _numThreads;
+	unsigned _producerLimit;
 	std::list<std::thread> _threads;
+	std::vector<std::unique_ptr<worker>> _workers;
+	std::atomic<unsigned> _nextWorker;
+
+	// queued, but not yet picked up
+	std::atomic<size_t> _pending;
 
-	turbo::monitor _notifyRunning;
-	turbo::monitor _notifyWork;
-	moodycamel::ConcurrentQueue< std::function<void()> > _queue;
+	// parking. Submitters only take the lock if someone might be asleep, so it's cheap when we're busy.
+	std::atomic<unsigned> _sleeping;
+	std::mutex _parkMutex;
+	std::condition_variable _park;
+
+	// which pool (and which worker) the current thread belongs to, if any
+	inline static thread_local const thread_pool* _currentPool = nullptr;
+	inline static thread_local unsigned _currentWorker = 0;
 };
 
 inline thread_pool::thread_pool(unsigned numThreads)
-    : _running(0)
-    , _numThreads(numThreads)
-    , _queue()
+	: thread_pool(numThreads, 0)
 {
 }
+
 inline thread_pool::thread_pool(unsigned numThreads, unsigned producerLimit)
-    : _running(0)
-    , _numThreads(numThreads)
-    , _queue(1, 0, producerLimit)
+	: _running(false)
+	, _numThreads(std::max(1U, numThreads))
+	, _producerLimit(producerLimit)
+	, _nextWorker(0)
+	, _pending(0)
+	, _sleeping(0)
 {
+	for (unsigned i = 0; i < _numThreads; ++i)
+		_workers.push_back(std::make_unique<worker>());
 }
 
 inline thread_pool::~thread_pool()
@@ -56,64 +101,196 @@ inline thread_pool::~thread_pool()
 
 inline bool thread_pool::start()
 {
-	if (_running > 0)
+	if (_running.exchange(true))
 		return true;
 
 	for (unsigned i = 0; i < _numThreads; ++i)
-		_threads.push_back( std::thread(std::bind(&thread_pool::run, this)) );
-	_notifyRunning.wait_for(10000);
-	return _running == _numThreads;
+		_threads.push_back( std::thread(&thread_pool::run, this, i) );
+	return true;
 }
 
 inline void thread_pool::stop()
 {
-	_running = -1 - _numThreads;
-	_notifyWork.signal_all();
-	for (std::list<std::thread>::iterator it = _threads.begin(); it != _threads.end(); ++it)
 	{
-		if (it->joinable())
-			it->join();
+		std::lock_guard<std::mutex> lock(_parkMutex);
+		_running = false;
 	}
+	_park.notify_all();
+
+	for (std::thread& t : _threads)
+		if (t.joinable())
+			t.join();
 	_threads.clear();
+
+	// whatever didn't get run, won't be
+	for (std::unique_ptr<worker>& w : _workers)
+	{
+		std::lock_guard<std::mutex> lock(w->mutex);
+		for (auto& tasks : w->tasks)
+			tasks.clear();
+	}
+	_pending = 0;
 }
 
-inline void thread_pool::execute(std::function<void()> fun)
+inline void thread_pool::execute(std::function<void()> fun, priority prio)
 {
-	_queue.enqueue(fun);
-	_notifyWork.notify_one();
+	push(std::move(fun), prio);
 }
 
-inline bool thread_pool::try_execute(std::function<void()> fun)
+inline bool thread_pool::try_execute(std::function<void()> fun, priority prio)
 {
-	bool success = _queue.try_enqueue(fun);
-	if (success)
-		_notifyWork.notify_one();
-	return success;
+	if (_producerLimit and _pending >= _producerLimit)
+		return false;
+	push(std::move(fun), prio);
+	return true;
 }
 
 inline size_t thread_pool::queued() const
 {
-	return _queue.size_approx();
+	return _pending;
+}
+
+inline unsigned thread_pool::num_threads() const
+{
+	return _numThreads;
 }
 
-inline void thread_pool::run()
+inline void thread_pool::push(std::function<void()>&& fun, priority prio)
 {
-	if (++_running == _numThreads)
-		_notifyRunning.signal_all();
-	while (_running > 0)
+	unsigned index = (_currentPool == this)? _currentWorker : (_nextWorker++ % _numThreads);
 	{
-		_notifyWork.wait();
-		if (_running <= 0)
-			break;
+		// count it under the same lock that publishes it. Otherwise a thief can pop (and decrement) before we've incremented.
+		worker& w = *_workers[index];
+		std::lock_guard<std::mutex> lock(w.mutex);
+		++_pending;
+		w.tasks[prio].push_back(std::move(fun));
+	}
 
-		std::function<void()> fun;
-		while (_queue.try_dequeue(fun))
+	// a parking worker bumps _sleeping, *then* checks _pending. We bump _pending, *then* check _sleeping.
+	// so either it sees our task, or we see it -- and since it's holding the lock until it's waiting, the notify can't slip by.
+	if (_sleeping > 0)
+	{
+		{
+			std::lock_guard<std::mutex> lock(_parkMutex);
+		}
+		_park.notify_one();
+	}
+}
+
+inline bool thread_pool::pop(unsigned index, std::function<void()>& fun)
+{
+	// the highest priority work in the pool goes first, whoever's deque it's on
+	for (unsigned prio = 0; prio < NUM_PRIORITIES; ++prio)
+	{
+		worker& w = *_workers[index];
 		{
-			if (_running <= 0)
-				break;
+			std::lock_guard<std::mutex> lock(w.mutex);
+			std::deque<std::function<void()>>& tasks = w.tasks[prio];
+			if (!tasks.empty())
+			{
+				fun = std::move(tasks.front());
+				tasks.pop_front();
+				return true;
+			}
+		}
+
+		for (unsigned i = 1; i < _numThreads; ++i)
+		{
+			worker& victim = *_workers[(index + i) % _numThreads];
+			std::lock_guard<std::mutex> lock(victim.mutex);
+			std::deque<std::function<void()>>& tasks = victim.tasks[prio];
+			if (!tasks.empty())
+			{
+				fun = std::move(tasks.front());
+				tasks.pop_front();
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+inline void thread_pool::run(unsigned index)
+{
+	_currentPool = this;
+	_currentWorker = index;
+
+	std::function<void()> fun;
+	while (_running)
+	{
+		if (pop(index, fun))
+		{
+			--_pending;
 			fun();
+			fun = nullptr;
+			continue;
 		}
+
+		// new work tends to show up in bursts. Hang around a moment before we pay for a park + unpark
+		bool found = false;
+		for (unsigned spin = 0; spin < 64 and !found; ++spin)
+		{
+			std::this_thread::yield();
+			found = _pending > 0 or !_running;
+		}
+		if (found)
+			continue;
+
+		std::unique_lock<std::mutex> lock(_parkMutex);
+		++_sleeping;
+		_park.wait(lock, [this]() { return _pending > 0 or !_running; });
+		--_sleeping;
 	}
 }
 
+template <typename FUN>
+inline void thread_pool::parallel_for(unsigned begin, unsigned end, const FUN& fun, priority prio)
+{
+	if (begin >= end)
+		return;
+
+	// helpers may not get to run until after we've returned, so the shared bits live on the heap.
+	// a late helper finds nothing left to do, and leaves without touching `fun`.
+	struct state
+	{
+		std::atomic<unsigned> next;
+		unsigned end;
+		const FUN* fun;
+		unsigned running = 0;
+		std::mutex mutex;
+		std::condition_variable done;
+	};
+	std::shared_ptr<state> st = std::make_shared<state>();
+	st->next = begin;
+	st->end = end;
+	st->fun = &fun;
+
+	auto work = [] (state& s) {
+		for (unsigned i = s.next++; i < s.end; i = s.next++)
+			(*s.fun)(i);
+	};
+
+	unsigned helpers = std::min(_numThreads, end - begin - 1);
+	for (unsigned h = 0; h < helpers; ++h)
+		push([st, work] () {
+			{
+				std::lock_guard<std::mutex> lock(st->mutex);
+				if (st->next >= st->end)
+					return;
+				++st->running;
+			}
+			work(*st);
+
+			std::lock_guard<std::mutex> lock(st->mutex);
+			if (--st->running == 0)
+				st->done.notify_all();
+		}, prio);
+
+	work(*st);
+
+	// everything's been handed out. Wait for whoever is still chewing on their piece.
+	std::unique_lock<std::mutex> lock(st->mutex);
+	st->done.wait(lock, [&st]() { return st->running == 0; });
+}
+
 } // namespace turbo
@@ -1,52 +1,143 @@
 /* This code is subject to the terms of the Mozilla Public License, v.2.0. http://mozilla.org/MPL/2.0/. */
-#include "util/File.h"
-
-#include "base91/base.hpp"
 #include "cxxopts/cxxopts.hpp"
 #include "serialize/format.h"
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb/stb_image.h"
 
+#include <cstdint>
 #include <fstream>
 #include <iostream>
 #include <map>
+#include <memory>
 #include <string>
 #include <vector>
 using std::map;
 using std::string;
 using std::vector;
 
-map<string, string> getFileBlobs(string dir_path)
+namespace {
+	// every asset is two-tone, so we only keep one bit per pixel. 1 == white.
+	struct mask
+	{
+		unsigned width = 0;
+		unsigned height = 0;
+		vector<bool> bits;
+	};
+
+	mask load_mask(string file_path)
+	{
+		mask m;
+		int width, height, channels;
+		std::unique_ptr<uint8_t[], void (*)(void*)> imgdata(stbi_load(file_path.c_str(), &width, &height, &channels, STBI_rgb_alpha), ::free);
+		if (!imgdata)
+		{
+			std::cerr << "failed to load " << file_path << std::endl;
+			return m;
+		}
+
+		m.width = width;
+		m.height = height;
+		for (int i = 0; i < width * height; ++i)
+		{
+			const uint8_t* px = imgdata.get() + i*4;
+			m.bits.push_back(px[0] == 0xFF and px[1] == 0xFF and px[2] == 0xFF);
+		}
+		return m;
+	}
+
+	// msb first, row major. Same order image_hash::average_hash() uses
+	uint64_t to_int(const mask& m)
+	{
+		uint64_t res = 0;
+		for (bool b : m.bits)
+			res = (res << 1) | b;
+		return res;
+	}
+
+	string to_bytes(const mask& m)
+	{
+		vector<uint8_t> bytes((m.bits.size() + 7) / 8, 0);
+		for (unsigned i = 0; i < m.bits.size(); ++i)
+			bytes[i/8] |= m.bits[i] << (7 - i%8);
+
+		string res;
+		for (unsigned i = 0; i < bytes.size(); ++i)
+			res += fmt::format("{}0x{:02x},", (i % 16 == 0)? "\n\t\t" : " ", bytes[i]);
+		return res;
+	}
+
+	string to_array(const vector<uint64_t>& vals)
+	{
+		string res;
+		for (uint64_t v : vals)
+			res += fmt::format("\n\t\t0x{:x},", v);
+		return res;
+	}
+
+	string var_name(string name)
+	{
+		for (char& c : name)
+			if (c == '-')
+				c = '_';
+		return name;
+	}
+}
+
+string getMarkers(string dir_path)
 {
 	// std::filesystem is still hard to get the compiler to use, so we'll manually enumerate for now
-	map<string, string> blobs;
+	string data, table;
+	unsigned count = 0;
 
-	vector<string> anchors = {"anchor-{}.png", "anchor-secondary-{}.png", "guide-horizontal-{}.png", "guide-vertical-{}.png"};
+	vector<string> anchors = {"anchor-{}", "anchor-secondary-{}", "guide-horizontal-{}", "guide-vertical-{}"};
 	for (const string& mode : {"light", "dark"})
 		for (const string& a : anchors)
 		{
-			string short_path = fmt::format(a, mode);
-			string file_path = fmt::format("{}/{}", dir_path, short_path);
-			string contents = File(file_path).read_all();
-			blobs[file_path] = base91::encode(contents);
+			string name = fmt::format(a, mode);
+			mask m = load_mask(fmt::format("{}/{}.png", dir_path, name));
+
+			data += fmt::format("\tinline constexpr uint8_t {}[] = {{{}\n\t}};\n\n", var_name(name), to_bytes(m));
+			table += fmt::format("\t\t{{\"bitmap/{}.png\", {}, {}, {}}},\n", name, m.width, m.height, var_name(name));
+			++count;
 		}
 
-	for (int i = 0; i < 4; ++i)
-	{
-		string file_path = fmt::format("{}/2/{:02x}.png", dir_path, i);
-		string contents = File(file_path).read_all();
-		blobs[file_path] = base91::encode(contents);
-	}
-	for (int i = 0; i < 16; ++i)
+	return fmt::format("{}\tinline constexpr std::array<bitmap, {}> markers = {{{{\n{}\t}}}};\n", data, count, table);
+}
+
+string getSymbols(string dir_path)
+{
+	string data, table;
+	for (unsigned symbolBits : {2, 4})
 	{
-		string file_path = fmt::format("{}/4/{:02x}.png", dir_path, i);
-		string contents = File(file_path).read_all();
-		blobs[file_path] = base91::encode(contents);
+		unsigned count = 1 << symbolBits;
+		unsigned cellSize = 0;
+		vector<uint64_t> masks, darkHashes, lightHashes;
+		for (unsigned i = 0; i < count; ++i)
+		{
+			mask m = load_mask(fmt::format("{}/{}/{:02x}.png", dir_path, symbolBits, i));
+			cellSize = m.width;
+
+			// the rendered tile is two-tone, so average_hash() lands on whichever side is brighter:
+			// the white background in light mode, the colored symbol in dark mode
+			uint64_t bits = to_int(m);
+			uint64_t all = (m.bits.size() >= 64)? ~0ULL : (1ULL << m.bits.size()) - 1;
+			masks.push_back(bits);
+			lightHashes.push_back(bits);
+			darkHashes.push_back(~bits & all);
+		}
+
+		data += fmt::format("\tinline constexpr uint64_t symbols{}_masks[] = {{{}\n\t}};\n", symbolBits, to_array(masks));
+		data += fmt::format("\tinline constexpr uint64_t symbols{}_hashes_dark[] = {{{}\n\t}};\n", symbolBits, to_array(darkHashes));
+		data += fmt::format("\tinline constexpr uint64_t symbols{}_hashes_light[] = {{{}\n\t}};\n\n", symbolBits, to_array(lightHashes));
+		table += fmt::format("\t\t{{{0}, {1}, {2}, symbols{0}_masks, symbols{0}_hashes_dark, symbols{0}_hashes_light}},\n", symbolBits, cellSize, count);
 	}
-	return blobs;
+
+	return fmt::format("{}\tinline constexpr std::array<symbol_set, 2> symbols = {{{{\n{}\t}}}};\n", data, table);
 }
 
 int main(int argc, char** argv)
 {
-	cxxopts::Options options("build_image_assets", "Build a C++ class file (header-only) that contains base91 png asset data.");
+	cxxopts::Options options("build_image_assets", "Build a C++ header that contains the (1-bit) image asset data.");
 
 	options.add_options()
 		("b,bitmap", "Bitmap directory", cxxopts::value<std::string>())
@@ -64,14 +155,65 @@ int main(int argc, char** argv)
 	std::cout << "got bitmapDir, it's " << bitmapDir << std::endl;
 
 	std::ofstream out("bitmaps.h");
-	out << "namespace cimbar {" << std::endl;
-	out << "static const std::map<std::string, std::string> bitmaps = {" << std::endl;
+	out << R"(/* This code is subject to the terms of the Mozilla Public License, v.2.0. http://mozilla.org/MPL/2.0/. */
+/* generated by build_image_assets. Don't edit by hand! */
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+
+namespace cimbar {
+namespace bitmaps {
+	// 1 bit per pixel, row major, msb first. 1 == white, 0 == black
+	struct bitmap
+	{
+		const char* name;
+		unsigned width;
+		unsigned height;
+		const uint8_t* data;
 
-	map<string, string> blobs = getFileBlobs(bitmapDir);
-	for (auto const& [key, val] : blobs)
-		out << "{\"" << key << "\", R\"(" << val << ")\"}," << std::endl;
+		constexpr bool get(unsigned x, unsigned y) const
+		{
+			unsigned i = y*width + x;
+			return (data[i/8] >> (7 - i%8)) & 1;
+		}
+	};
+
+	// one uint64_t per symbol: cell_size*cell_size bits, row major, msb first. 1 == background
+	// the hashes are what image_hash::average_hash() gives for the rendered tile.
+	struct symbol_set
+	{
+		unsigned symbol_bits;
+		unsigned cell_size;
+		unsigned count;
+		const uint64_t* masks;
+		const uint64_t* hashes_dark;
+		const uint64_t* hashes_light;
+	};
 
-	out << "};" << std::endl;
-	out << "}" << std::endl;
+)";
+
+	out << getMarkers(bitmapDir) << std::endl;
+	out << getSymbols(bitmapDir) << std::endl;
+
+	out << R"(	constexpr const bitmap* get_marker(std::string_view name)
+	{
+		for (const bitmap& b : markers)
+			if (name == b.name)
+				return &b;
+		return nullptr;
+	}
+
+	constexpr const symbol_set* get_symbols(unsigned symbol_bits)
+	{
+		for (const symbol_set& s : symbols)
+			if (s.symbol_bits == symbol_bits)
+				return &s;
+		return nullptr;
+	}
+}
+}
+)";
 	return 0;
 }
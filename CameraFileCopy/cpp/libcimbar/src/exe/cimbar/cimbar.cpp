@@ -3,20 +3,30 @@
 #include "compression/zstd_decompressor.h"
 #include "encoder/Decoder.h"
 #include "encoder/Encoder.h"
+#include "encoder/RawVideoWriter.h"
 #include "extractor/Extractor.h"
 #include "extractor/SimpleCameraCalibration.h"
 #include "extractor/Undistort.h"
 #include "fountain/FountainInit.h"
+#include "fountain/concurrent_fountain_decoder_sink.h"
 #include "fountain/fountain_decoder_sink.h"
 #include "serialize/str.h"
+#include "util/bounded_queue.h"
 
 #include "cxxopts/cxxopts.hpp"
 
+#include <atomic>
+#include <chrono>
 #include <cstdio>
 #include <experimental/filesystem>
 #include <functional>
 #include <iostream>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 using std::string;
 using std::vector;
@@ -101,74 +111,180 @@ namespace {
 }
 
 template <typename FilenameIterable>
-int encode(const FilenameIterable& infiles, const std::string& outpath, int ecc, int color_bits, int compression_level, bool legacy_mode, bool no_fountain)
+int encode(const FilenameIterable& infiles, const std::string& outpath, int ecc, int color_bits, int compression_level, bool legacy_mode, bool no_fountain,
+		   unsigned threads, int png_compression, bool ppm, bool benchmark, RawVideoWriter* video)
 {
 	Encoder en(ecc, cimbar::Config::symbol_bits(), color_bits);
 	if (legacy_mode)
 		en.set_legacy_mode();
+	en.set_threads(threads);
+	en.set_png_compression(png_compression);
+	en.set_ppm_output(ppm);
+
+	auto start = std::chrono::steady_clock::now();
+	unsigned frames = 0;
 	for (const string& f : infiles)
 	{
 		if (f.empty())
 			continue;
-		if (no_fountain)
-			en.encode(f, outpath);
+
+		if (video)
+		{
+			// frames can finish out of order when we're encoding on several threads. The video can't.
+			std::mutex mutex;
+			std::map<unsigned, cv::Mat> pending;
+			unsigned next = 0;
+			auto to_video = [&](const cv::Mat& frame, unsigned i) {
+				std::lock_guard<std::mutex> lock(mutex);
+				pending[i] = frame.clone();
+				for (auto it = pending.find(next); it != pending.end(); it = pending.find(++next))
+				{
+					if (!video->write(it->second))
+						return false;
+					pending.erase(it);
+				}
+				return true;
+			};
+
+			if (no_fountain)
+				frames += en.encode(f, to_video);
+			else
+				frames += en.encode_fountain(f, to_video, compression_level);
+		}
+		else if (no_fountain)
+			frames += en.encode(f, outpath);
 		else
-			en.encode_fountain(f, outpath, compression_level);
+			frames += en.encode_fountain(f, outpath, compression_level);
+	}
+	if (video)
+		video->close();
+
+	if (benchmark)
+	{
+		double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		std::cerr << fmt::format("encoded {} frames in {:.3f}s ({:.1f} frames/s)", frames, secs, secs > 0? frames / secs : 0) << std::endl;
 	}
 	return 0;
 }
 
+// plain cv::Mat all the way through. UMat only buys us something if there's an OpenCL device, and our servers don't have one.
+using decode_fun = std::function<int(const cv::Mat&, unsigned, bool, int)>;
+
+cv::Mat read_image(const string& inf)
+{
+	cv::Mat img = cv::imread(inf);
+	if (!img.empty())
+		cv::cvtColor(img, img, cv::COLOR_BGR2RGB);
+	return img;
+}
+
+// the err bits for this one image
+int decode_image(cv::Mat img, const decode_fun& decodefun, bool no_deskew, bool undistort, unsigned color_mode, int preprocess, int color_correct)
+{
+	if (img.empty())
+		return 2; // couldn't read it. As good as not finding a code in it
+
+	int err = 0;
+	bool shouldPreprocess = (preprocess == 1);
+	if (!no_deskew)
+	{
+		// attempt undistort. It's currently a low-effort attempt to *reduce* distortion, not eliminate it.
+		// we rely on the decoder to power through minor distortion
+		if (undistort)
+		{
+			Undistort<SimpleCameraCalibration> und;
+			if (!und.undistort(img, img))
+				err |= 1;
+		}
+
+		Extractor ext;
+		int res = ext.extract(img, img);
+		if (!res)
+			return err | 2;
+		else if (preprocess != 0 and res == Extractor::NEEDS_SHARPEN)
+			shouldPreprocess = true;
+	}
+
+	int bytes = decodefun(img, color_mode, shouldPreprocess, color_correct);
+	if (!bytes)
+		err |= 4;
+	return err;
+}
+
 template <typename FilenameIterable>
-int decode(const FilenameIterable& infiles, const std::function<int(cv::UMat, unsigned, bool, int)>& decodefun, bool no_deskew, bool undistort, unsigned color_mode, int preprocess, int color_correct)
+int decode(const FilenameIterable& infiles, const decode_fun& decodefun, bool no_deskew, bool undistort, unsigned color_mode, int preprocess, int color_correct)
 {
 	int err = 0;
 	for (const string& inf : infiles)
 	{
 		if (inf.empty())
 			continue;
-		bool shouldPreprocess = (preprocess == 1);
-		cv::UMat img = cv::imread(inf).getUMat(cv::ACCESS_RW);
-		cv::cvtColor(img, img, cv::COLOR_BGR2RGB);
-
-		if (!no_deskew)
-		{
-			// attempt undistort. It's currently a low-effort attempt to *reduce* distortion, not eliminate it.
-			// we rely on the decoder to power through minor distortion
-			if (undistort)
-			{
-				Undistort<SimpleCameraCalibration> und;
-				if (!und.undistort(img, img))
-					err |= 1;
-			}
-
-			Extractor ext;
-			int res = ext.extract(img, img);
-			if (!res)
-			{
-				err |= 2;
-				continue;
-			}
-			else if (preprocess != 0 and res == Extractor::NEEDS_SHARPEN)
-				shouldPreprocess = true;
-		}
-
-		int bytes = decodefun(img, color_mode, shouldPreprocess, color_correct);
-		if (!bytes)
-			err |= 4;
+		err |= decode_image(read_image(inf), decodefun, no_deskew, undistort, color_mode, preprocess, color_correct);
 	}
 	return err;
 }
 
 // see also "decodefun" for non-fountain decodes, defined as a lambda inline below.
 // this one needs its own function since it's a template (:
+// fresh_ccm: start every image from a clean ccm. On one thread, an image with no usable header borrows the previous
+// image's colors -- but with several, "previous" is whatever that thread happened to get, so we don't let them borrow.
 template <typename SINK>
-std::function<int(cv::UMat,unsigned,bool,int)> fountain_decode_fun(SINK& sink, Decoder& d)
+decode_fun fountain_decode_fun(SINK& sink, Decoder& d, bool fresh_ccm=false)
 {
-	return [&sink, &d] (cv::UMat m, unsigned cm, bool pre, int cc) {
+	return [&sink, &d, fresh_ccm] (const cv::Mat& m, unsigned cm, bool pre, int cc) {
+		if (fresh_ccm)
+			d.reset_ccm();
 		return d.decode_fountain(m, sink, cm, pre, cc);
 	};
 }
 
+// filenames -> loader threads (imread) -> decode threads, each with its own Decoder -> one fountain sink.
+// the loaders stay a couple of images ahead of the decoders, so we're never waiting on a png.
+// fountain chunks don't care what order they show up in, so we end up with the same files as decode() would.
+template <typename OUTSTREAM, typename FilenameIterable>
+int decode_parallel(const FilenameIterable& infiles, const string& outpath, unsigned chunk_size, bool checkpoint, unsigned threads,
+					unsigned ecc, unsigned color_bits, bool no_deskew, bool undistort, unsigned color_mode, int preprocess, int color_correct)
+{
+	concurrent_fountain_decoder_sink<OUTSTREAM> sink(outpath, chunk_size, 256, true);
+	sink.set_checkpoint(checkpoint);
+	sink.set_lossless();
+
+	bounded_queue<string> names(threads*2);
+	bounded_queue<cv::Mat> images(threads*2);
+	std::atomic<int> err = 0;
+
+	std::list<std::thread> loaders;
+	for (unsigned i = 0; i < (threads+1)/2; ++i)
+		loaders.push_back( std::thread([&]() {
+			while (std::optional<string> inf = names.pop())
+				if (!images.push(read_image(*inf)))
+					break;
+		}) );
+
+	std::list<std::thread> workers;
+	for (unsigned i = 0; i < threads; ++i)
+		workers.push_back( std::thread([&]() {
+			Decoder d(ecc, color_bits);
+			decode_fun decodefun = fountain_decode_fun(sink, d, true);
+			while (std::optional<cv::Mat> img = images.pop())
+				err |= decode_image(*img, decodefun, no_deskew, undistort, color_mode, preprocess, color_correct);
+		}) );
+
+	for (const string& inf : infiles)
+		if (!inf.empty())
+			names.push(inf);
+	names.close();
+
+	for (std::thread& t : loaders)
+		t.join();
+	images.close();
+	for (std::thread& t : workers)
+		t.join();
+	sink.stop();
+	return err;
+}
+
+
 int main(int argc, char** argv)
 {
 	cxxopts::Options options("cimbar encoder/decoder", "Demonstration program for cimbar codes");
@@ -182,14 +298,24 @@ int main(int argc, char** argv)
 		("o,out", "Output file prefix (encoding) or directory (decoding).", cxxopts::value<string>())
 		("c,color-bits", "Color bits. [0-3]", cxxopts::value<int>()->default_value(turbo::str::str(colorBits)))
 		("e,ecc", "ECC level", cxxopts::value<unsigned>()->default_value(turbo::str::str(ecc)))
+		("g,grid", "Cell grid. 5x5 packs more cells into a frame, but needs a better camera. [8x8,5x5]", cxxopts::value<string>()->default_value("8x8"))
 		("m,mode", "Select a cimbar mode. B (the default) is new to 0.6.x. 4C is the 0.5.x config. [B,4C]", cxxopts::value<string>()->default_value("B"))
 		("z,compression", "Compression level. 0 == no compression.", cxxopts::value<int>()->default_value(turbo::str::str(compressionLevel)))
 		("color-correct", "Toggle decoding color correction. 2 == full (fountain mode only). 1 == simple. 0 == off.", cxxopts::value<int>()->default_value("2"))
 		("color-correction-file", "Debug -- save color correction matrix generated during fountain decode, or use it for non-fountain decodes", cxxopts::value<string>())
+		("checkpoint", "Journal partially decoded files to the output directory, so an interrupted decode can resume. Fountain mode only.", cxxopts::value<bool>())
+		("combine", "Combine failed decodes of the same frame (ex: several photos of a static image) and retry. Fountain mode only.", cxxopts::value<bool>())
 		("no-deskew", "Skip the deskew step -- treat input image as already extracted.", cxxopts::value<bool>())
 		("no-fountain", "Disable fountain encode/decode. Will also disable compression.", cxxopts::value<bool>())
 		("undistort", "Attempt undistort step -- useful if image distortion is significant.", cxxopts::value<bool>())
 		("preprocess", "Run sharpen filter on the input image. 1 == on. 0 == off. -1 == guess.", cxxopts::value<int>()->default_value("-1"))
+		("threads", "Encode (or decode) this many frames at once. 0 == one per core. (when decoding on >1, each image does its own color correction.)", cxxopts::value<unsigned>()->default_value("1"))
+		("png-compression", "Encoder png compression level. [0-9]. -1 == default.", cxxopts::value<int>()->default_value("-1"))
+		("ppm", "Encoder writes uncompressed .ppm files instead of .png.", cxxopts::value<bool>())
+		("benchmark", "Report how long the encode took, in frames/s.", cxxopts::value<bool>())
+		("video", "Encoder streams uncompressed video to this file instead of writing images. \"-\" == stdout.", cxxopts::value<string>())
+		("video-format", "Video format for --video. [y4m,rgb]", cxxopts::value<string>()->default_value("y4m"))
+		("fps", "Frame rate for --video.", cxxopts::value<unsigned>()->default_value("15"))
 		("h,help", "Print usage")
 	;
 	options.show_positional_help();
@@ -218,9 +344,18 @@ int main(int argc, char** argv)
 	bool encodeFlag = result.count("encode");
 	bool no_fountain = result.count("no-fountain");
 
+	if (!cimbar::Config::set_grid(result["grid"].as<string>()))
+	{
+		std::cerr << "unknown grid " << result["grid"].as<string>() << std::endl;
+		return 1;
+	}
+
 	colorBits = std::min(3, result["color-bits"].as<int>());
 	compressionLevel = result["compression"].as<int>();
-	ecc = result["ecc"].as<unsigned>();
+	// the default ecc goes with the grid
+	ecc = result.count("ecc")? result["ecc"].as<unsigned>() : cimbar::Config::ecc_bytes();
+
+	unsigned threads = result["threads"].as<unsigned>();
 
 	bool legacy_mode = false;
 	if (result.count("mode"))
@@ -231,10 +366,29 @@ int main(int argc, char** argv)
 
 	if (encodeFlag)
 	{
+		int png_compression = result["png-compression"].as<int>();
+		bool ppm = result.count("ppm");
+		bool benchmark = result.count("benchmark");
+
+		std::unique_ptr<RawVideoWriter> video;
+		if (result.count("video"))
+		{
+			bool rgb = result["video-format"].as<string>() == "rgb";
+			unsigned fps = result["fps"].as<unsigned>();
+			video = std::make_unique<RawVideoWriter>(result["video"].as<string>(), rgb? RawVideoWriter::RGB : RawVideoWriter::Y4M, fps);
+			if (!video->good())
+			{
+				std::cerr << "failed to open " << result["video"].as<string>() << std::endl;
+				return 1;
+			}
+			if (rgb)
+				std::cerr << fmt::format("raw rgb24 video, {0}x{0} @ {1}fps", cimbar::Config::image_size(), fps) << std::endl;
+		}
+
 		if (useStdin)
-			return encode(StdinLineReader(), outpath, ecc, colorBits, compressionLevel, legacy_mode, no_fountain);
+			return encode(StdinLineReader(), outpath, ecc, colorBits, compressionLevel, legacy_mode, no_fountain, threads, png_compression, ppm, benchmark, video.get());
 		else
-			return encode(infiles, outpath, ecc, colorBits, compressionLevel, legacy_mode, no_fountain);
+			return encode(infiles, outpath, ecc, colorBits, compressionLevel, legacy_mode, no_fountain, threads, png_compression, ppm, benchmark, video.get());
 	}
 
 	// else, decode
@@ -256,7 +410,7 @@ int main(int argc, char** argv)
 
 		// simpler encoding, just the basics + ECC. No compression, fountain codes, etc.
 		std::ofstream f(outpath);
-		std::function<int(cv::UMat,unsigned,bool,int)> decodefun = [&f, &d] (cv::UMat m, unsigned cm, bool pre, int cc) {
+		decode_fun decodefun = [&f, &d] (const cv::Mat& m, unsigned cm, bool pre, int cc) {
 			return d.decode(m, f, cm, pre, cc);
 		};
 		if (useStdin)
@@ -267,16 +421,48 @@ int main(int argc, char** argv)
 
 	// else, the good stuff
 	int res = -200;
+	if (result.count("combine"))
+		d.set_combine_frames();
+	bool checkpoint = result.count("checkpoint");
 
 	unsigned chunkSize = cimbar::Config::fountain_chunk_size(ecc, colorBits+cimbar::Config::symbol_bits(), legacy_mode);
+
+	// --combine and the ccm file both depend on frame order, so they stay on one thread
+	if (threads == 0)
+		threads = std::max(1U, std::thread::hardware_concurrency());
+	if (threads > 1 and (result.count("combine") or not color_correction_file.empty()))
+	{
+		std::cerr << "--combine and --color-correction-file decode on a single thread" << std::endl;
+		threads = 1;
+	}
+
+	if (threads > 1)
+	{
+		if (compressionLevel <= 0)
+		{
+			if (useStdin)
+				return decode_parallel<std::ofstream>(StdinLineReader(), outpath, chunkSize, checkpoint, threads, ecc, colorBits, no_deskew, undistort, color_mode, preprocess, color_correct);
+			else
+				return decode_parallel<std::ofstream>(infiles, outpath, chunkSize, checkpoint, threads, ecc, colorBits, no_deskew, undistort, color_mode, preprocess, color_correct);
+		}
+
+		using zstd_out = cimbar::zstd_decompressor<std::ofstream>;
+		if (useStdin)
+			return decode_parallel<zstd_out>(StdinLineReader(), outpath, chunkSize, checkpoint, threads, ecc, colorBits, no_deskew, undistort, color_mode, preprocess, color_correct);
+		else
+			return decode_parallel<zstd_out>(infiles, outpath, chunkSize, checkpoint, threads, ecc, colorBits, no_deskew, undistort, color_mode, preprocess, color_correct);
+	}
+
 	if (compressionLevel <= 0)
 	{
 		fountain_decoder_sink<std::ofstream> sink(outpath, chunkSize, true);
+		sink.set_checkpoint(checkpoint);
 		res = decode(infiles, fountain_decode_fun(sink, d), no_deskew, undistort, color_mode, preprocess, color_correct);
 	}
 	else // default case, all bells and whistles
 	{
 		fountain_decoder_sink<cimbar::zstd_decompressor<std::ofstream>> sink(outpath, chunkSize, true);
+		sink.set_checkpoint(checkpoint);
 
 		if (useStdin)
 			res = decode(StdinLineReader(), fountain_decode_fun(sink, d), no_deskew, undistort, color_mode, preprocess, color_correct);
@@ -3,8 +3,10 @@
 #include "compression/zstd_decompressor.h"
 #include "encoder/Decoder.h"
 #include "extractor/Extractor.h"
-#include "fountain/fountain_decoder_sink.h"
+#include "fountain/FountainInit.h"
+#include "fountain/concurrent_fountain_decoder_sink.h"
 #include "gui/window_glfw.h"
+#include "util/bounded_queue.h"
 
 #include "cxxopts/cxxopts.hpp"
 #include "serialize/str.h"
@@ -23,7 +25,9 @@
     #include <thread>
 #endif
 
+#include <atomic>
 #include <iostream>
+#include <list>
 #include <string>
 using std::string;
 
@@ -47,26 +51,179 @@ namespace {
 	}
 #endif
 
-// 统一的帧延迟函数
-inline uint64_t wait_for_frame_time(uint32_t delay, uint64_t start_time)
+// no window, no frame pacing: read the video as fast as we can decode it
+int decode_offline(cv::VideoCapture& vc, const string& outpath, unsigned ecc, unsigned color_bits, bool legacy_mode, unsigned threads)
 {
-	uint64_t current_time = get_current_time_millis();
-	uint64_t elapsed = current_time - start_time;
-	
-	if (delay > elapsed) {
-		uint32_t wait_time = (uint32_t)(delay - elapsed);
-#if defined(__APPLE__) && defined(CIMBAR_IOS_PLATFORM)
-		// iOS平台使用usleep
-		usleep(wait_time * 1000); // 转换为微秒
-#else
-		// 非iOS平台使用std::this_thread::sleep_for
-		std::this_thread::sleep_for(std::chrono::milliseconds(wait_time));
-#endif
+	FountainInit::init();
+
+	unsigned color_mode = legacy_mode? 0 : 1;
+	int color_correction = legacy_mode? 1 : 2;
+	unsigned chunkSize = cimbar::Config::fountain_chunk_size(ecc, color_bits+cimbar::Config::symbol_bits(), legacy_mode);
+	concurrent_fountain_decoder_sink<cimbar::zstd_decompressor<std::ofstream>> sink(outpath, chunkSize);
+	// nobody's waiting on us here, so wait on the fountain decoder instead of dropping chunks.
+	// same video in, same files out -- no matter how many threads.
+	sink.set_lossless();
+
+	bounded_queue<cv::Mat> frames(threads*2);
+	unsigned numFrames = 0;
+	std::atomic<unsigned> extracted = 0;
+	std::atomic<uint64_t> bytes = 0;
+
+	uint64_t start = get_current_time_millis();
+
+	std::thread reader([&]() {
+		while (true)
+		{
+			// fresh Mat every time -- the queue holds on to the last one
+			cv::Mat mat;
+			if (!vc.read(mat) or !frames.push(mat))
+				break;
+			++numFrames;
+		}
+		frames.close();
+	});
+
+	std::list<std::thread> workers;
+	for (unsigned i = 0; i < threads; ++i)
+		workers.push_back( std::thread([&]() {
+			Extractor ext;
+			Decoder dec(ecc, color_bits);
+			while (std::optional<cv::Mat> mat = frames.pop())
+			{
+				cv::cvtColor(*mat, *mat, cv::COLOR_BGR2RGB);
+
+				cv::Mat img;
+				int res = ext.extract(*mat, img);
+				if (!res)
+					continue;
+				++extracted;
+
+				// and don't let whichever frame this thread saw last decide the colors
+				dec.reset_ccm();
+				bool shouldPreprocess = (res == Extractor::NEEDS_SHARPEN);
+				bytes += dec.decode_fountain(img, sink, color_mode, shouldPreprocess, color_correction);
+			}
+		}) );
+
+	reader.join();
+	for (std::thread& t : workers)
+		t.join();
+	sink.stop();
+
+	double secs = std::max<uint64_t>(1, get_current_time_millis() - start) / 1000.0;
+	std::cerr << fmt::format("{} frames in {:.2f}s ({:.1f} frames/s). {} extracted, {} payload bytes ({:.1f} KB/s). {} threads.",
+							 numFrames, secs, numFrames / secs, extracted.load(), bytes.load(), bytes / secs / 1024, threads) << std::endl;
+
+	std::vector<string> done = sink.get_done();
+	std::cerr << fmt::format("{} files recovered", done.size()) << std::endl;
+	for (const string& f : done)
+		std::cout << f << std::endl;
+	return 0;
+}
+
+// capture, display and decode each get their own thread(s). The camera sets the pace -- capture never waits on a decode.
+// if the decoders fall behind, the oldest frame is the one that gets thrown out.
+// the window (and so, display) belongs to the main thread.
+int decode_live(cv::VideoCapture& vc, cimbar::window_glfw& window, const string& outpath, unsigned ecc, unsigned color_bits, bool legacy_mode, unsigned threads)
+{
+	FountainInit::init();
+
+	unsigned color_mode = legacy_mode? 0 : 1;
+	int color_correction = legacy_mode? 1 : 2;
+	unsigned chunkSize = cimbar::Config::fountain_chunk_size(ecc, color_bits+cimbar::Config::symbol_bits(), legacy_mode);
+	concurrent_fountain_decoder_sink<cimbar::zstd_decompressor<std::ofstream>> sink(outpath, chunkSize);
+
+	bounded_queue<cv::Mat> display(1);
+	bounded_queue<cv::Mat> frames(threads);
+	std::atomic<bool> running = true;
+	std::atomic<unsigned> captured = 0;
+	std::atomic<unsigned> extracted = 0;
+	std::atomic<uint64_t> bytes = 0;
+
+	std::thread capture([&]() {
+		while (running)
+		{
+			// fresh Mat every time. Display and the decoders share it, but nobody writes to it
+			cv::Mat mat;
+			if (!vc.read(mat))
+			{
+				std::cerr << "failed to read from cam" << std::endl;
+				std::this_thread::sleep_for(std::chrono::milliseconds(100));
+				continue;
+			}
+			cv::cvtColor(mat, mat, cv::COLOR_BGR2RGB);
+			++captured;
+
+			display.push_latest(mat);
+			frames.push_latest(mat);
+		}
+		display.close();
+		frames.close();
+	});
+
+	std::list<std::thread> workers;
+	for (unsigned i = 0; i < threads; ++i)
+		workers.push_back( std::thread([&]() {
+			Extractor ext;
+			Decoder dec(ecc, color_bits);
+			while (std::optional<cv::Mat> mat = frames.pop())
+			{
+				cv::Mat img;
+				int res = ext.extract(*mat, img);
+				if (!res)
+					continue;
+				++extracted;
+
+				bool shouldPreprocess = (res == Extractor::NEEDS_SHARPEN);
+				bytes += dec.decode_fountain(img, sink, color_mode, shouldPreprocess, color_correction);
+			}
+		}) );
+
+	// live numbers go in the title bar, once a second
+	uint64_t start = get_current_time_millis();
+	uint64_t lastReport = start;
+	unsigned lastCaptured = 0;
+	unsigned lastExtracted = 0;
+	uint64_t lastBytes = 0;
+	while (!window.should_close())
+	{
+		if (std::optional<cv::Mat> mat = display.pop_for(std::chrono::milliseconds(100)))
+			window.show(*mat);
+		else
+			window.poll();
+
+		uint64_t now = get_current_time_millis();
+		if (now - lastReport < 1000)
+			continue;
+
+		double secs = (now - lastReport) / 1000.0;
+		window.set_title(fmt::format("cimbar_recv: {:.1f} fps, {:.1f} extracts/s, {:.1f} KB/s. {} dropped, {} files",
+									 (captured - lastCaptured) / secs, (extracted - lastExtracted) / secs, (bytes - lastBytes) / secs / 1024,
+									 frames.dropped(), sink.num_done()));
+		lastReport = now;
+		lastCaptured = captured;
+		lastExtracted = extracted;
+		lastBytes = bytes;
 	}
-	
-	return get_current_time_millis();
+
+	running = false;
+	capture.join();
+	for (std::thread& t : workers)
+		t.join();
+	sink.stop();
+
+	double secs = std::max<uint64_t>(1, get_current_time_millis() - start) / 1000.0;
+	std::cerr << fmt::format("{} frames in {:.2f}s ({:.1f} frames/s). {} extracted, {} dropped, {} payload bytes ({:.1f} KB/s). {} threads.",
+							 captured.load(), secs, captured / secs, extracted.load(), frames.dropped(), bytes.load(), bytes / secs / 1024, threads) << std::endl;
+
+	std::vector<string> done = sink.get_done();
+	std::cerr << fmt::format("{} files recovered", done.size()) << std::endl;
+	for (const string& f : done)
+		std::cout << f << std::endl;
+	return 0;
 }
 
+}
 
 int main(int argc, char** argv)
 {
@@ -79,9 +236,12 @@ int main(int argc, char** argv)
 		("i,in", "Video source.", cxxopts::value<string>())
 		("o,out", "Output directory (decoding).", cxxopts::value<string>())
 		("c,colorbits", "Color bits. [0-3]", cxxopts::value<int>()->default_value(turbo::str::str(colorBits)))
+		("g,grid", "Cell grid. 5x5 packs more cells into a frame, but needs a better camera. [8x8,5x5]", cxxopts::value<string>()->default_value("8x8"))
 		("e,ecc", "ECC level", cxxopts::value<unsigned>()->default_value(turbo::str::str(ecc)))
-		("f,fps", "Target decode FPS", cxxopts::value<unsigned>()->default_value(turbo::str::str(defaultFps)))
+		("f,fps", "Camera FPS", cxxopts::value<unsigned>()->default_value(turbo::str::str(defaultFps)))
 		("m,mode", "Select a cimbar mode. B (the default) is new to 0.6.x. 4C is the 0.5.x config. [B,4C]", cxxopts::value<string>()->default_value("B"))
+		("offline", "Decode a recorded video file as fast as possible. No window, no frame pacing.", cxxopts::value<bool>())
+		("threads", "Decode threads. 0 == one per core.", cxxopts::value<unsigned>()->default_value("0"))
 		("h,help", "Print usage")
 	;
 	options.show_positional_help();
@@ -98,8 +258,15 @@ int main(int argc, char** argv)
 	string source = result["in"].as<string>();
 	string outpath = result["out"].as<string>();
 
+	if (!cimbar::Config::set_grid(result["grid"].as<string>()))
+	{
+		std::cerr << "unknown grid " << result["grid"].as<string>() << std::endl;
+		return 1;
+	}
+
 	colorBits = std::min(3, result["colorbits"].as<int>());
-	ecc = result["ecc"].as<unsigned>();
+	// the default ecc goes with the grid
+	ecc = result.count("ecc")? result["ecc"].as<unsigned>() : cimbar::Config::ecc_bytes();
 
 	bool legacy_mode = false;
 	if (result.count("mode"))
@@ -107,12 +274,10 @@ int main(int argc, char** argv)
 		string mode = result["mode"].as<string>();
 		legacy_mode = (mode == "4c") or (mode == "4C");
 	}
-	unsigned color_mode = legacy_mode? 0 : 1;
 
 	unsigned fps = result["fps"].as<unsigned>();
 	if (fps == 0)
 		fps = defaultFps;
-	unsigned delay = 1000 / fps;
 
 	cv::VideoCapture vc(source.c_str());
 	if (!vc.isOpened())
@@ -120,6 +285,13 @@ int main(int argc, char** argv)
 		std::cerr << "failed to open video device :(" << std::endl;
 		return 70;
 	}
+
+	unsigned threads = result["threads"].as<unsigned>();
+	if (threads == 0)
+		threads = std::max(1U, std::thread::hardware_concurrency());
+
+	if (result.count("offline"))
+		return decode_offline(vc, outpath, ecc, colorBits, legacy_mode, threads);
 	vc.set(cv::CAP_PROP_FRAME_WIDTH, 1920);
 	vc.set(cv::CAP_PROP_FRAME_HEIGHT, 1200);
 	vc.set(cv::CAP_PROP_FPS, fps);
@@ -139,56 +311,6 @@ int main(int argc, char** argv)
 		std::cerr << "failed to create window :(" << std::endl;
 		return 70;
 	}
-	window.auto_scale_to_window();
 
-	Extractor ext;
-	Decoder dec(-1, -1);
-
-	unsigned chunkSize = cimbar::Config::fountain_chunk_size(ecc, colorBits+cimbar::Config::symbol_bits(), legacy_mode);
-	fountain_decoder_sink<cimbar::zstd_decompressor<std::ofstream>> sink(outpath, chunkSize);
-
-	cv::Mat mat;
-
-	unsigned count = 0;
-	// 使用统一的计时API
-	uint64_t start = get_current_time_millis();
-	while (true)
-	{
-		++count;
-
-		// delay, then try to read frame
-		start = wait_for_frame_time(delay, start);
-		if (window.should_close())
-			break;
-
-		if (!vc.read(mat))
-		{
-			std::cerr << "failed to read from cam" << std::endl;
-			continue;
-		}
-
-		cv::UMat img = mat.getUMat(cv::ACCESS_RW);
-		cv::cvtColor(mat, mat, cv::COLOR_BGR2RGB);
-
-		// draw some stats on mat?
-		window.show(mat, 0);
-
-		// extract
-		bool shouldPreprocess = true;
-		int res = ext.extract(img, img);
-		if (!res)
-		{
-			//std::cerr << "no extract " << mat.cols << "," << mat.rows << std::endl;
-			continue;
-		}
-		else if (res == Extractor::NEEDS_SHARPEN)
-			shouldPreprocess = true;
-
-		// decode
-		int bytes = dec.decode_fountain(img, sink, color_mode, shouldPreprocess);
-		if (bytes > 0)
-			std::cerr << "got some bytes " << bytes << std::endl;
-	}
-
-	return 0;
+	return decode_live(vc, window, outpath, ecc, colorBits, legacy_mode, threads);
 }
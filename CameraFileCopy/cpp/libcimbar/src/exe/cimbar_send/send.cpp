@@ -79,6 +79,7 @@ int main(int argc, char** argv)
 	options.add_options()
 		("i,in", "Source file", cxxopts::value<vector<string>>())
 		("c,colorbits", "Color bits. [0-3]", cxxopts::value<int>()->default_value(turbo::str::str(colorBits)))
+		("g,grid", "Cell grid. 5x5 packs more cells into a frame, but needs a better camera. [8x8,5x5]", cxxopts::value<string>()->default_value("8x8"))
 		("e,ecc", "ECC level", cxxopts::value<unsigned>()->default_value(turbo::str::str(ecc)))
 		("f,fps", "Target FPS", cxxopts::value<unsigned>()->default_value(turbo::str::str(defaultFps)))
 		("m,mode", "Select a cimbar mode. B is new to 0.6.x. 4C is the 0.5.x config. [B,4C]", cxxopts::value<string>()->default_value("4C"))
@@ -98,9 +99,16 @@ int main(int argc, char** argv)
 
 	vector<string> infiles = result["in"].as<vector<string>>();
 
+	if (!cimbar::Config::set_grid(result["grid"].as<string>()))
+	{
+		std::cerr << "unknown grid " << result["grid"].as<string>() << std::endl;
+		return 1;
+	}
+
 	colorBits = std::min(3, result["colorbits"].as<int>());
 	compressionLevel = result["compression"].as<int>();
-	ecc = result["ecc"].as<unsigned>();
+	// the default ecc goes with the grid
+	ecc = result.count("ecc")? result["ecc"].as<unsigned>() : cimbar::Config::ecc_bytes();
 
 	bool legacy_mode = false;
 	if (result.count("mode"))
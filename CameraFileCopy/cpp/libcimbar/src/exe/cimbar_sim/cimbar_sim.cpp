@@ -0,0 +1,135 @@
+/* This code is subject to the terms of the Mozilla Public License, v.2.0. http://mozilla.org/MPL/2.0/. */
+#include "channel_sim/ChannelSimulator.h"
+#include "channel_sim/Loopback.h"
+#include "cimb_translator/Config.h"
+#include "fountain/FountainInit.h"
+#include "serialize/format.h"
+#include "serialize/str.h"
+#include "util/File.h"
+#include "util/MakeTempDirectory.h"
+
+#include "cxxopts/cxxopts.hpp"
+
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+using std::string;
+using std::vector;
+
+namespace {
+	string random_payload(unsigned size, uint64_t seed)
+	{
+		std::mt19937_64 rng(seed);
+		string payload(size, '\0');
+		for (char& c : payload)
+			c = rng() & 0xFF;
+		return payload;
+	}
+
+	// "noise=0,4,8" -> ("noise", {0, 4, 8})
+	bool parse_sweep(const string& sweep, string& name, vector<double>& values)
+	{
+		size_t eq = sweep.find('=');
+		if (eq == string::npos)
+			return false;
+
+		name = sweep.substr(0, eq);
+		std::stringstream ss(sweep.substr(eq+1));
+		string val;
+		while (std::getline(ss, val, ','))
+			values.push_back(std::stod(val));
+		return !values.empty() and ChannelParams().set(name, 0);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	cxxopts::Options options("cimbar_sim", "Encode -> simulated camera -> decode. Reports goodput for each channel setting.");
+
+	unsigned colorBits = cimbar::Config::color_bits();
+	unsigned ecc = cimbar::Config::ecc_bytes();
+	options.add_options()
+		("i,in", "File to send. If not set, we send --size random bytes.", cxxopts::value<string>())
+		("s,size", "Random payload size, in bytes.", cxxopts::value<unsigned>()->default_value("65536"))
+		("seed", "Seed for the payload and the channel.", cxxopts::value<uint64_t>()->default_value("1"))
+		("c,color-bits", "Color bits. [0-3]", cxxopts::value<int>()->default_value(turbo::str::str(colorBits)))
+		("g,grid", "Cell grid. 5x5 packs more cells into a frame, but needs a better camera. [8x8,5x5]", cxxopts::value<string>()->default_value("8x8"))
+		("e,ecc", "ECC level", cxxopts::value<unsigned>()->default_value(turbo::str::str(ecc)))
+		("m,mode", "Select a cimbar mode. B (the default) is new to 0.6.x. 4C is the 0.5.x config. [B,4C]", cxxopts::value<string>()->default_value("B"))
+		("z,compression", "Compression level. 0 == no compression.", cxxopts::value<int>()->default_value("6"))
+		("max-frames", "Give up after this many frames.", cxxopts::value<unsigned>()->default_value("1000"))
+		("sweep", "Run once per value of one channel parameter. ex: noise=0,4,8", cxxopts::value<string>())
+		("h,help", "Print usage")
+	;
+
+	ChannelParams defaults;
+	for (auto&& [name, help] : ChannelParams::describe())
+		options.add_options("channel")(name, help, cxxopts::value<double>()->default_value(turbo::str::str(defaults.get(name))));
+
+	auto result = options.parse(argc, argv);
+	if (result.count("help"))
+	{
+		std::cout << options.help({"", "channel"}) << std::endl;
+		return 0;
+	}
+
+	if (!cimbar::Config::set_grid(result["grid"].as<string>()))
+	{
+		std::cerr << "unknown grid " << result["grid"].as<string>() << std::endl;
+		return 1;
+	}
+
+	colorBits = std::min(3, result["color-bits"].as<int>());
+	// the default ecc goes with the grid
+	ecc = result.count("ecc")? result["ecc"].as<unsigned>() : cimbar::Config::ecc_bytes();
+	bool legacy_mode = false;
+	if (result.count("mode"))
+	{
+		string mode = result["mode"].as<string>();
+		legacy_mode = (mode == "4c") or (mode == "4C");
+	}
+	uint64_t seed = result["seed"].as<uint64_t>();
+	unsigned maxFrames = result["max-frames"].as<unsigned>();
+
+	string payload;
+	if (result.count("in"))
+		payload = File(result["in"].as<string>()).read_all();
+	else
+		payload = random_payload(result["size"].as<unsigned>(), seed);
+
+	ChannelParams params;
+	for (auto&& [name, help] : ChannelParams::describe())
+		params.set(name, result[name].as<double>());
+
+	string sweepName = "none";
+	vector<double> sweepValues = {0};
+	if (result.count("sweep"))
+	{
+		sweepValues.clear();
+		if (!parse_sweep(result["sweep"].as<string>(), sweepName, sweepValues))
+		{
+			std::cerr << "bad --sweep. Expected <param>=<val>,<val>,..." << std::endl;
+			return 1;
+		}
+	}
+
+	FountainInit::init();
+	MakeTempDirectory tempdir;
+	Loopback loop(ecc, colorBits, legacy_mode, result["compression"].as<int>());
+
+	// csv, so CI can diff it
+	std::cout << "param,value,frames_sent,frames_received,frames_extracted,frames_decoded,complete,goodput_bytes_per_frame,seconds" << std::endl;
+	for (double val : sweepValues)
+	{
+		ChannelParams p = params;
+		p.set(sweepName, val);
+		ChannelSimulator channel(p, seed);
+
+		LoopbackStats stats = loop.run(payload, channel, tempdir.path(), maxFrames);
+		std::cout << fmt::format("{},{},{},{},{},{},{},{:.1f},{:.3f}", sweepName, val, stats.frames_sent, stats.frames_received,
+								 stats.frames_extracted, stats.frames_decoded, stats.complete, stats.goodput(), stats.seconds) << std::endl;
+	}
+	return 0;
+}
@@ -1,6 +1,10 @@
 /* This code is subject to the terms of the Mozilla Public License, v.2.0. http://mozilla.org/MPL/2.0/. */
 #pragma once
 
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
 #include <vector>
 
 // write bits -> buffer
@@ -59,9 +63,167 @@ public:
 		_buffer.resize(size, 0);
 	}
 
+	// ORs `length` bits of data in at bit `index`, msb first. length <= 32
 	bool write(unsigned data, unsigned index, int length)
 	{
-		resize(index+length);
+		if (write_fast(data, index, length))
+			return true;
+		return write_slow(data, index, length);
+	}
+
+	unsigned read(unsigned index, int length) const
+	{
+		if (length <= 0)
+			return 0;
+
+		size_t byte = index/8;
+		unsigned bit = index%8;
+		if (bit + length <= 8)
+			return (static_cast<unsigned char>(_buffer[byte]) >> (8 - bit - length)) & mask(length);
+		if (byte + 8 <= _buffer.size())
+			return (load_be64(byte) << bit) >> (64 - length);
+		return read_slow(index, length);
+	}
+
+	// fixed width versions, for the hot loops. Same bits as write()/read().
+	// when N divides 8 (the 1/2/4/8 bit cells), the caller promises the N bits don't straddle a byte -- any multiple
+	// of N is fine -- so it's always exactly one byte. No window, no "does it fit?" branch.
+	template <int N>
+	bool write(unsigned data, unsigned index)
+	{
+		static_assert(N > 0 and N <= 32, "bitbuffer::write<N>: 0 < N <= 32");
+		if constexpr (8 % N == 0)
+		{
+			size_t byte = index/8;
+			unsigned bit = index%8;
+			assert(bit + N <= 8);
+			if (byte >= _buffer.size())
+				resize(index + N + 7);
+			_buffer[byte] |= static_cast<char>((data & mask(N)) << (8 - bit - N));
+			return true;
+		}
+		else
+			return write(data, index, N);
+	}
+
+	template <int N>
+	unsigned read(unsigned index) const
+	{
+		static_assert(N > 0 and N <= 32, "bitbuffer::read<N>: 0 < N <= 32");
+		if constexpr (8 % N == 0)
+		{
+			unsigned bit = index%8;
+			assert(bit + N <= 8);
+			return (static_cast<unsigned char>(_buffer[index/8]) >> (8 - bit - N)) & mask(N);
+		}
+		else
+			return read(index, N);
+	}
+
+	template <typename STREAM>
+	long flush(STREAM& f)
+	{
+		f.write(buffer().data(), buffer().size());
+		clear();
+		return f.tellp();
+	}
+
+	void clear()
+	{
+		// keeps the allocation around for the next frame
+		_buffer.assign(_sizeHint, 0);
+	}
+
+	// clear, with a new size. For buffers that get reused across configurations.
+	void reset(unsigned size_hint)
+	{
+		_sizeHint = size_hint;
+		clear();
+	}
+
+	const std::vector<char>& buffer() const
+	{
+		return _buffer;
+	}
+
+	void copy_to_buffer(const char* data, unsigned size)
+	{
+		_buffer.resize(size, 0);
+		std::copy(data, data+size, _buffer.data());
+	}
+
+	writer get_writer(size_t pos=0)
+	{
+		return writer(*this, pos);
+	}
+
+protected:
+	static constexpr uint64_t mask(int length)
+	{
+		return length >= 32? 0xFFFFFFFFULL : (1ULL << length) - 1;
+	}
+
+	// the buffer is big endian (msb first), so a 64-bit window is too
+	uint64_t load_be64(size_t byte) const
+	{
+		uint64_t word;
+		std::memcpy(&word, _buffer.data() + byte, sizeof(word));
+#if defined(__GNUC__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+		return __builtin_bswap64(word);
+#elif defined(__GNUC__)
+		return word;
+#else
+		const uint8_t* b = reinterpret_cast<const uint8_t*>(_buffer.data() + byte);
+		word = 0;
+		for (unsigned i = 0; i < 8; ++i)
+			word = (word << 8) | b[i];
+		return word;
+#endif
+	}
+
+	void store_be64(size_t byte, uint64_t word)
+	{
+#if defined(__GNUC__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+		word = __builtin_bswap64(word);
+		std::memcpy(_buffer.data() + byte, &word, sizeof(word));
+#elif defined(__GNUC__)
+		std::memcpy(_buffer.data() + byte, &word, sizeof(word));
+#else
+		for (int i = 7; i >= 0; --i, word >>= 8)
+			_buffer[byte + i] = static_cast<char>(word & 0xFF);
+#endif
+	}
+
+	// small enough to inline: one byte if we can, else a 64-bit window. false if we're too close to the end for either.
+	bool write_fast(unsigned data, unsigned index, int length)
+	{
+		size_t byte = index/8;
+		unsigned bit = index%8;
+		if (bit + length <= 8)
+		{
+			// 2 and 4 bit cells never straddle a byte
+			if (byte >= _buffer.size())
+				return false;
+			_buffer[byte] |= static_cast<char>((data & mask(length)) << (8 - bit - length));
+			return true;
+		}
+
+		if (byte + 8 > _buffer.size())
+			return false;
+		uint64_t word = load_be64(byte) | (static_cast<uint64_t>(data & mask(length)) << (64 - bit - length));
+		store_be64(byte, word);
+		return true;
+	}
+
+	// for the last few bytes, where a 64-bit window would run off the end. Or past the end, in which case we grow.
+	bool write_slow(unsigned data, unsigned index, int length)
+	{
+		if (index + length > _buffer.size() * 8)
+		{
+			resize(index + length + 7);
+			if (write_fast(data, index, length))
+				return true;
+		}
 
 		int currentByte = index/8;
 		int currentBit = index%8;
@@ -83,7 +245,7 @@ public:
 		return true;
 	}
 
-	unsigned read(unsigned index, int length) const
+	unsigned read_slow(unsigned index, int length) const
 	{
 		int currentByte = index/8;
 		int currentBit = index%8;
@@ -106,36 +268,6 @@ public:
 		return res;
 	}
 
-	template <typename STREAM>
-	long flush(STREAM& f)
-	{
-		f.write(buffer().data(), buffer().size());
-		clear();
-		return f.tellp();
-	}
-
-	void clear()
-	{
-		_buffer = {0};
-		_buffer.resize(_sizeHint, 0);
-	}
-
-	const std::vector<char>& buffer() const
-	{
-		return _buffer;
-	}
-
-	void copy_to_buffer(const char* data, unsigned size)
-	{
-		_buffer.resize(size, 0);
-		std::copy(data, data+size, _buffer.data());
-	}
-
-	writer get_writer(size_t pos=0)
-	{
-		return writer(*this, pos);
-	}
-
 protected:
 	std::vector<char> _buffer;
 	unsigned _sizeHint;
@@ -0,0 +1,95 @@
+/* This code is subject to the terms of the Mozilla Public License, v.2.0. http://mozilla.org/MPL/2.0/. */
+#include "unittest.h"
+
+#include "bitbuffer.h"
+#include "legacy_bitbuffer.h"
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <vector>
+
+// bit_file_test "[benchmark]"
+namespace {
+	// one frame's worth of cells, in a shuffled (interleaved-ish) order
+	std::vector<unsigned> cell_order(unsigned cells=12400)
+	{
+		std::vector<unsigned> order(cells);
+		std::iota(order.begin(), order.end(), 0);
+		std::shuffle(order.begin(), order.end(), std::mt19937(1));
+		return order;
+	}
+
+	template <int N>
+	void benchmark_width()
+	{
+		std::vector<unsigned> order = cell_order();
+		unsigned bytes = order.size() * N / 8 + 1;
+
+		BENCHMARK( "legacy write" )
+		{
+			std::vector<char> buff(bytes, 0);
+			for (unsigned i : order)
+				legacy_bitbuffer::write(buff, i & 0x3F, i*N, N);
+			return buff[0];
+		};
+
+		BENCHMARK( "write(n)" )
+		{
+			bitbuffer bb(bytes);
+			for (unsigned i : order)
+				bb.write(i & 0x3F, i*N, N);
+			return bb.buffer()[0];
+		};
+
+		BENCHMARK( "write<N>" )
+		{
+			bitbuffer bb(bytes);
+			for (unsigned i : order)
+				bb.write<N>(i & 0x3F, i*N);
+			return bb.buffer()[0];
+		};
+
+		bitbuffer bb(bytes);
+		for (unsigned i : order)
+			bb.write<N>(i & 0x3F, i*N);
+
+		BENCHMARK( "legacy read" )
+		{
+			unsigned total = 0;
+			for (unsigned i : order)
+				total += legacy_bitbuffer::read(bb.buffer(), i*N, N);
+			return total;
+		};
+
+		BENCHMARK( "read(n)" )
+		{
+			unsigned total = 0;
+			for (unsigned i : order)
+				total += bb.read(i*N, N);
+			return total;
+		};
+
+		BENCHMARK( "read<N>" )
+		{
+			unsigned total = 0;
+			for (unsigned i : order)
+				total += bb.read<N>(i*N);
+			return total;
+		};
+	}
+}
+
+TEST_CASE( "bitbufferBenchmark/2bits", "[.][benchmark]" )
+{
+	benchmark_width<2>();
+}
+
+TEST_CASE( "bitbufferBenchmark/4bits", "[.][benchmark]" )
+{
+	benchmark_width<4>();
+}
+
+TEST_CASE( "bitbufferBenchmark/6bits", "[.][benchmark]" )
+{
+	benchmark_width<6>();
+}
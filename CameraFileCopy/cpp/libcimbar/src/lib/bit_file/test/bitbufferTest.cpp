@@ -2,7 +2,9 @@
 #include "unittest.h"
 
 #include "bitbuffer.h"
+#include "legacy_bitbuffer.h"
 #include <iostream>
+#include <random>
 #include <sstream>
 #include <string>
 #include <vector>
@@ -158,3 +160,97 @@ TEST_CASE( "bitbufferTest/testCopyToBuffer", "[unit]" )
 	assertEquals( 0x6c, bb.read(24, 8) );
 	assertEquals( 0x6f, bb.read(32, 8) );
 }
+
+TEST_CASE( "bitbufferTest/testFixedWidth", "[unit]" )
+{
+	bitbuffer bb;
+	bb.write<6>(0x1F, 0);
+	bb.write<6>(0x0A, 6);
+	bb.write<6>(0x03, 12);
+	bb.write<6>(0x11, 18);
+
+	assertEquals( 0x7C, (int)(unsigned char)bb.buffer()[0] );
+	assertEquals( 0xA0, (int)(unsigned char)bb.buffer()[1] );
+	assertEquals( 0xD1, (int)(unsigned char)bb.buffer()[2] );
+
+	assertEquals( 0x1F, bb.read<6>(0) );
+	assertEquals( 0x0A, bb.read<6>(6) );
+	assertEquals( 0x03, bb.read<6>(12) );
+	assertEquals( 0x11, bb.read<6>(18) );
+	assertEquals( 0xF, bb.read<4>(2) );
+	assertEquals( 0x3, bb.read<2>(16) );
+}
+
+TEST_CASE( "bitbufferTest/testFixedWidth.byte", "[unit]" )
+{
+	// 2 and 4 bit cells are one byte each, and still grow the buffer if they have to
+	bitbuffer fixed(2);
+	bitbuffer runtime(2);
+	for (unsigned i = 0; i < 20; ++i)
+	{
+		fixed.write<4>(i, i*4);
+		runtime.write(i, i*4, 4);
+	}
+	for (unsigned i = 0; i < 16; ++i)
+	{
+		fixed.write<2>(i, 80 + i*2);
+		runtime.write(i, 80 + i*2, 2);
+	}
+
+	assertEquals( runtime.buffer(), fixed.buffer() );
+	assertEquals( 0x01, (int)(unsigned char)fixed.buffer()[0] );
+	for (unsigned i = 0; i < 20; ++i)
+		assertEquals( i & 0xF, fixed.read<4>(i*4) );
+	for (unsigned i = 0; i < 16; ++i)
+		assertEquals( i & 0x3, fixed.read<2>(80 + i*2) );
+}
+
+TEST_CASE( "bitbufferTest/testTail", "[unit]" )
+{
+	// the last few bytes can't use the 64-bit window
+	bitbuffer bb(10);
+	bb.write(0x2AB, 70, 10);
+	bb.write(0x5, 66, 4);
+
+	assertEquals( 10, bb.buffer().size() );
+	assertEquals( 0x2AB, bb.read(70, 10) );
+	assertEquals( 0x5, bb.read(66, 4) );
+	assertEquals( 0x16AB, bb.read(64, 16) );
+}
+
+TEST_CASE( "bitbufferTest/testGrow", "[unit]" )
+{
+	bitbuffer bb(10);
+	bb.write(0xFF, 76, 8);
+
+	assertEquals( 20, bb.buffer().size() );
+	assertEquals( 0xFF, bb.read(76, 8) );
+	assertEquals( 0x0F, (int)(unsigned char)bb.buffer()[9] );
+	assertEquals( 0xF0, (int)(unsigned char)bb.buffer()[10] );
+}
+
+TEST_CASE( "bitbufferTest/testMatchesLegacy", "[unit]" )
+{
+	std::mt19937 rng(42);
+	for (int length = 1; length <= 32; ++length)
+	{
+		DYNAMIC_SECTION( "length " << length )
+		{
+			const unsigned size = 64;
+			bitbuffer bb(size);
+			std::vector<char> expected(size, 0);
+
+			for (unsigned i = 0; i < 200; ++i)
+			{
+				unsigned index = rng() % (size*8 - length + 1);
+				unsigned data = rng() & (length == 32? 0xFFFFFFFFU : (1U << length) - 1);
+				bb.write(data, index, length);
+				legacy_bitbuffer::write(expected, data, index, length);
+			}
+			assertEquals( expected, bb.buffer() );
+
+			for (unsigned index = 0; index <= size*8 - length; ++index)
+				assertEquals( legacy_bitbuffer::read(expected, index, length), bb.read(index, length) );
+		}
+	}
+}
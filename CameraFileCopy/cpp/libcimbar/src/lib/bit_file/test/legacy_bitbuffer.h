@@ -0,0 +1,53 @@
+/* This code is subject to the terms of the Mozilla Public License, v.2.0. http://mozilla.org/MPL/2.0/. */
+#pragma once
+
+#include <algorithm>
+#include <vector>
+
+// the original byte-at-a-time bitbuffer read/write. Kept around to check (and time) the word-sized version against.
+namespace legacy_bitbuffer
+{
+	inline void write(std::vector<char>& buffer, unsigned data, unsigned index, int length)
+	{
+		int currentByte = index/8;
+		int currentBit = index%8;
+
+		int nextWrite = std::min(length, 8-currentBit);
+		while (length > 0 and nextWrite > 0)
+		{
+			unsigned char bits = data >> (length - nextWrite);
+			bits = bits << (8 - nextWrite - currentBit);
+			buffer[currentByte] |= bits;
+
+			length -= nextWrite;
+			currentBit += nextWrite;
+			if (currentBit >= 8)
+				currentBit = 0;
+			currentByte += 1;
+			nextWrite = std::min(length, 8-currentBit);
+		}
+	}
+
+	inline unsigned read(const std::vector<char>& buffer, unsigned index, int length)
+	{
+		int currentByte = index/8;
+		int currentBit = index%8;
+
+		unsigned res = 0;
+		int nextRead = std::min(length, 8-currentBit);
+		while (length > 0)
+		{
+			unsigned char bits = static_cast<unsigned char>(buffer[currentByte]) << currentBit;
+			bits = bits >> (8-nextRead);
+			res |= bits << (length - nextRead);
+
+			length -= nextRead;
+			currentBit += nextRead;
+			if (currentBit >= 8)
+				currentBit = 0;
+			currentByte += 1;
+			nextRead = std::min(length, 8-currentBit);
+		}
+		return res;
+	}
+}
@@ -0,0 +1,266 @@
+/* This code is subject to the terms of the Mozilla Public License, v.2.0. http://mozilla.org/MPL/2.0/. */
+#pragma once
+
+#include <opencv2/opencv.hpp>
+
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+// knobs for the fake screen -> camera channel. The defaults are a perfect channel (plus a little border).
+struct ChannelParams
+{
+	double margin = 0.1;       // background around the frame, as a fraction of frame size
+	double perspective = 0;    // max corner displacement, as a fraction of frame size
+	double rotation = 0;       // max rotation, in degrees (either direction)
+	double barrel = 0;         // radial distortion coefficient. > 0 == barrel, < 0 == pincushion
+	double defocus = 0;        // gaussian blur sigma, in pixels
+	double motion_blur = 0;    // blur length, in pixels. Random direction.
+	double exposure = 1;       // gain
+	double color_cast = 0;     // max per-channel gain deviation. 0.1 == each channel is scaled by [0.9, 1.1]
+	double noise = 0;          // gaussian sensor noise, stddev in [0,255] units
+	double jpeg = 0;           // jpeg quality. 0 == off
+	double drop = 0;           // probability a frame is never seen
+	double duplicate = 0;      // probability a frame is seen twice
+	double background = 32;    // gray level of whatever is around the screen
+
+	static const std::vector<std::pair<std::string, std::string>>& describe()
+	{
+		static const std::vector<std::pair<std::string, std::string>> params = {
+			{"margin", "Background around the frame, as a fraction of frame size."},
+			{"perspective", "Max corner displacement, as a fraction of frame size."},
+			{"rotation", "Max rotation, in degrees."},
+			{"barrel", "Radial distortion coefficient. > 0 == barrel, < 0 == pincushion."},
+			{"defocus", "Gaussian blur sigma, in pixels."},
+			{"motion-blur", "Motion blur length, in pixels."},
+			{"exposure", "Exposure gain."},
+			{"color-cast", "Max per-channel gain deviation."},
+			{"noise", "Sensor noise stddev, [0-255]."},
+			{"jpeg", "JPEG quality. 0 == off."},
+			{"drop", "Frame drop probability."},
+			{"duplicate", "Frame duplicate probability."},
+			{"background", "Background gray level."},
+		};
+		return params;
+	}
+
+	bool set(const std::string& name, double value)
+	{
+		double* f = field(name);
+		if (!f)
+			return false;
+		*f = value;
+		return true;
+	}
+
+	double get(const std::string& name) const
+	{
+		double* f = const_cast<ChannelParams*>(this)->field(name);
+		return f? *f : 0;
+	}
+
+protected:
+	double* field(const std::string& name)
+	{
+		if (name == "margin") return &margin;
+		if (name == "perspective") return &perspective;
+		if (name == "rotation") return &rotation;
+		if (name == "barrel") return &barrel;
+		if (name == "defocus") return &defocus;
+		if (name == "motion-blur") return &motion_blur;
+		if (name == "exposure") return &exposure;
+		if (name == "color-cast") return &color_cast;
+		if (name == "noise") return &noise;
+		if (name == "jpeg") return &jpeg;
+		if (name == "drop") return &drop;
+		if (name == "duplicate") return &duplicate;
+		if (name == "background") return &background;
+		return nullptr;
+	}
+};
+
+// takes clean (RGB) encoder frames, hands back what a camera pointed at a screen might have seen.
+// everything random comes off one seeded generator, so a (params, seed) pair always gives the same frames.
+class ChannelSimulator
+{
+public:
+	ChannelSimulator(const ChannelParams& params, uint64_t seed=0);
+
+	// 0 (dropped), 1, or 2 (duplicated) frames
+	std::vector<cv::Mat> transmit(const cv::Mat& frame);
+
+	cv::Mat degrade(const cv::Mat& frame);
+
+	const ChannelParams& params() const;
+
+protected:
+	double uniform(double lo, double hi);
+
+	void warp(const cv::Mat& frame, cv::Mat& out);
+	void distort(cv::Mat& img);
+	void blur(cv::Mat& img);
+	void add_noise(cv::Mat& img);
+	void compress(cv::Mat& img);
+
+protected:
+	ChannelParams _params;
+	std::mt19937_64 _rng; // the raw output is the same everywhere. The std distributions aren't, so we don't use them.
+
+	cv::Mat _mapX;
+	cv::Mat _mapY;
+};
+
+inline ChannelSimulator::ChannelSimulator(const ChannelParams& params, uint64_t seed)
+	: _params(params)
+	, _rng(seed)
+{
+}
+
+inline const ChannelParams& ChannelSimulator::params() const
+{
+	return _params;
+}
+
+inline double ChannelSimulator::uniform(double lo, double hi)
+{
+	return lo + (hi - lo) * ((_rng() >> 11) * 0x1.0p-53);
+}
+
+inline std::vector<cv::Mat> ChannelSimulator::transmit(const cv::Mat& frame)
+{
+	std::vector<cv::Mat> res;
+	bool drop = uniform(0, 1) < _params.drop;
+	bool dupe = uniform(0, 1) < _params.duplicate;
+	if (drop)
+		return res;
+
+	res.push_back(degrade(frame));
+	// a second look at the same screen: same picture, new noise
+	if (dupe)
+		res.push_back(degrade(frame));
+	return res;
+}
+
+inline cv::Mat ChannelSimulator::degrade(const cv::Mat& frame)
+{
+	cv::Mat img;
+	warp(frame, img);
+	distort(img);
+	blur(img);
+
+	cv::Scalar gain;
+	for (unsigned i = 0; i < 3; ++i)
+		gain[i] = _params.exposure * (1 + uniform(-_params.color_cast, _params.color_cast));
+	cv::multiply(img, gain, img);
+
+	add_noise(img);
+	compress(img);
+	return img;
+}
+
+// the frame lands somewhere on the sensor: rotated, a bit skewed, with some background around it
+inline void ChannelSimulator::warp(const cv::Mat& frame, cv::Mat& out)
+{
+	int margin = frame.cols * _params.margin;
+	cv::Size size(frame.cols + 2*margin, frame.rows + 2*margin);
+	cv::Point2f center(size.width / 2.0f, size.height / 2.0f);
+
+	double angle = uniform(-_params.rotation, _params.rotation) * CV_PI / 180;
+	double jitter = _params.perspective * frame.cols;
+
+	std::vector<cv::Point2f> src = {{0, 0}, {(float)frame.cols, 0}, {(float)frame.cols, (float)frame.rows}, {0, (float)frame.rows}};
+	std::vector<cv::Point2f> dst;
+	for (const cv::Point2f& p : src)
+	{
+		cv::Point2f q = p + cv::Point2f(margin, margin) - center;
+		cv::Point2f r(q.x*std::cos(angle) - q.y*std::sin(angle), q.x*std::sin(angle) + q.y*std::cos(angle));
+		dst.push_back(r + center + cv::Point2f(uniform(-jitter, jitter), uniform(-jitter, jitter)));
+	}
+
+	cv::Mat transform = cv::getPerspectiveTransform(src, dst);
+	cv::warpPerspective(frame, out, transform, size, cv::INTER_LINEAR, cv::BORDER_CONSTANT, cv::Scalar::all(_params.background));
+}
+
+// lens distortion. The maps only depend on the size and the coefficient, so we keep them around.
+inline void ChannelSimulator::distort(cv::Mat& img)
+{
+	if (_params.barrel == 0)
+		return;
+
+	if (_mapX.size() != img.size())
+	{
+		_mapX.create(img.size(), CV_32FC1);
+		_mapY.create(img.size(), CV_32FC1);
+
+		float cx = img.cols / 2.0f;
+		float cy = img.rows / 2.0f;
+		float radius = std::max(cx, cy);
+		for (int y = 0; y < img.rows; ++y)
+			for (int x = 0; x < img.cols; ++x)
+			{
+				float nx = (x - cx) / radius;
+				float ny = (y - cy) / radius;
+				float scale = 1 + _params.barrel * (nx*nx + ny*ny);
+				_mapX.at<float>(y, x) = cx + nx*scale*radius;
+				_mapY.at<float>(y, x) = cy + ny*scale*radius;
+			}
+	}
+
+	cv::Mat out;
+	cv::remap(img, out, _mapX, _mapY, cv::INTER_LINEAR, cv::BORDER_CONSTANT, cv::Scalar::all(_params.background));
+	img = out;
+}
+
+inline void ChannelSimulator::blur(cv::Mat& img)
+{
+	if (_params.defocus > 0)
+		cv::GaussianBlur(img, img, cv::Size(0, 0), _params.defocus);
+
+	if (_params.motion_blur >= 1)
+	{
+		int length = std::ceil(_params.motion_blur);
+		int ksize = length | 1;
+		double angle = uniform(0, CV_PI);
+		double half = _params.motion_blur / 2;
+
+		cv::Mat kernel = cv::Mat::zeros(ksize, ksize, CV_32FC1);
+		cv::Point2d center(ksize / 2, ksize / 2);
+		cv::Point2d dir(std::cos(angle) * half, std::sin(angle) * half);
+		cv::line(kernel, center - dir, center + dir, cv::Scalar(1), 1, cv::LINE_AA);
+		kernel /= cv::sum(kernel)[0];
+		cv::filter2D(img, img, -1, kernel);
+	}
+}
+
+inline void ChannelSimulator::add_noise(cv::Mat& img)
+{
+	if (_params.noise <= 0)
+		return;
+
+	// cv::RNG is deterministic too, and much faster than drawing per pixel from _rng
+	cv::RNG rng(_rng());
+	cv::Mat noise(img.size(), CV_16SC(img.channels()));
+	rng.fill(noise, cv::RNG::NORMAL, 0, _params.noise);
+
+	cv::Mat wide;
+	img.convertTo(wide, CV_16S);
+	wide += noise;
+	wide.convertTo(img, CV_8U);
+}
+
+inline void ChannelSimulator::compress(cv::Mat& img)
+{
+	if (_params.jpeg <= 0)
+		return;
+
+	// imencode thinks it's BGR
+	cv::Mat bgr;
+	cv::cvtColor(img, bgr, cv::COLOR_RGB2BGR);
+	std::vector<uint8_t> buff;
+	cv::imencode(".jpg", bgr, buff, {cv::IMWRITE_JPEG_QUALITY, (int)std::min(100.0, _params.jpeg)});
+	bgr = cv::imdecode(buff, cv::IMREAD_COLOR);
+	cv::cvtColor(bgr, img, cv::COLOR_BGR2RGB);
+}
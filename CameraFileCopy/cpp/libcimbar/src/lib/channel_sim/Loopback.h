@@ -0,0 +1,122 @@
+/* This code is subject to the terms of the Mozilla Public License, v.2.0. http://mozilla.org/MPL/2.0/. */
+#pragma once
+
+#include "ChannelSimulator.h"
+
+#include "cimb_translator/Config.h"
+#include "compression/zstd_decompressor.h"
+#include "encoder/Decoder.h"
+#include "encoder/SimpleEncoder.h"
+#include "extractor/Extractor.h"
+#include "fountain/fountain_decoder_sink.h"
+#include "util/File.h"
+#include "util/byte_istream.h"
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+struct LoopbackStats
+{
+	unsigned frames_sent = 0;
+	unsigned frames_received = 0; // after drops + duplicates
+	unsigned frames_extracted = 0;
+	unsigned frames_decoded = 0;
+	size_t bytes_decoded = 0;
+	size_t payload_size = 0;
+	bool complete = false; // we got the file back, byte for byte
+	double seconds = 0;
+
+	// payload bytes per frame shown on screen. 0 if the file never made it.
+	double goodput() const
+	{
+		if (!complete or !frames_sent)
+			return 0;
+		return (double)payload_size / frames_sent;
+	}
+};
+
+// encoder -> ChannelSimulator -> Extractor -> Decoder -> fountain_decoder_sink, until the file comes out the other side
+class Loopback
+{
+public:
+	Loopback(unsigned ecc, unsigned color_bits, bool legacy_mode=false, int compression_level=6);
+
+	// data_dir is where the decoder writes the recovered file. We clean it up.
+	LoopbackStats run(const std::string& payload, ChannelSimulator& channel, const std::string& data_dir, unsigned max_frames=1000);
+
+protected:
+	unsigned _ecc;
+	unsigned _colorBits;
+	bool _legacyMode;
+	int _compressionLevel;
+};
+
+inline Loopback::Loopback(unsigned ecc, unsigned color_bits, bool legacy_mode, int compression_level)
+	: _ecc(ecc)
+	, _colorBits(color_bits)
+	, _legacyMode(legacy_mode)
+	, _compressionLevel(compression_level)
+{
+}
+
+inline LoopbackStats Loopback::run(const std::string& payload, ChannelSimulator& channel, const std::string& data_dir, unsigned max_frames)
+{
+	LoopbackStats stats;
+	stats.payload_size = payload.size();
+
+	SimpleEncoder enc(_ecc, cimbar::Config::symbol_bits(), _colorBits);
+	if (_legacyMode)
+		enc.set_legacy_mode();
+
+	cimbar::byte_istream bis(payload.data(), payload.size());
+	fountain_encoder_stream::ptr fes = enc.create_fountain_encoder(bis, _compressionLevel);
+	if (!fes)
+		return stats;
+
+	Extractor ext;
+	Decoder dec(_ecc, _colorBits);
+	// the ccm is thread_local -- without this, a run would start with whatever color correction the last one left behind
+	dec.reset_ccm();
+	unsigned colorMode = _legacyMode? 0 : 1;
+	int colorCorrection = _legacyMode? 1 : 2;
+	unsigned chunkSize = cimbar::Config::fountain_chunk_size(_ecc, _colorBits + cimbar::Config::symbol_bits(), _legacyMode);
+	fountain_decoder_sink<cimbar::zstd_decompressor<std::ofstream>> sink(data_dir, chunkSize);
+
+	auto start = std::chrono::steady_clock::now();
+	while (stats.frames_sent < max_frames and !sink.num_done())
+	{
+		std::optional<cv::Mat> frame = enc.encode_next(*fes);
+		if (!frame)
+			break;
+		++stats.frames_sent;
+
+		for (const cv::Mat& img : channel.transmit(*frame))
+		{
+			++stats.frames_received;
+
+			cv::Mat extracted;
+			int res = ext.extract(img, extracted);
+			if (!res)
+				continue;
+			++stats.frames_extracted;
+
+			unsigned bytes = dec.decode_fountain(extracted, sink, colorMode, res == Extractor::NEEDS_SHARPEN, colorCorrection);
+			if (bytes)
+			{
+				++stats.frames_decoded;
+				stats.bytes_decoded += bytes;
+			}
+		}
+	}
+	stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	for (const std::string& name : sink.get_done())
+	{
+		std::string path = fmt::format("{}/{}", data_dir, name);
+		stats.complete |= File(path).read_all() == payload;
+		std::remove(path.c_str());
+	}
+	return stats;
+}
@@ -0,0 +1,95 @@
+/* This code is subject to the terms of the Mozilla Public License, v.2.0. http://mozilla.org/MPL/2.0/. */
+#include "unittest.h"
+#include "TestHelpers.h"
+
+#include "ChannelSimulator.h"
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+namespace {
+	cv::Mat sample_frame()
+	{
+		cv::Mat img(256, 256, CV_8UC3, cv::Scalar(255, 255, 255));
+		cv::rectangle(img, cv::Rect(32, 32, 64, 64), cv::Scalar(255, 0, 0), cv::FILLED);
+		cv::circle(img, cv::Point(160, 160), 40, cv::Scalar(0, 0, 255), cv::FILLED);
+		return img;
+	}
+
+	ChannelParams rough_channel()
+	{
+		ChannelParams params;
+		params.perspective = 0.05;
+		params.rotation = 10;
+		params.barrel = 0.05;
+		params.defocus = 1;
+		params.motion_blur = 3;
+		params.exposure = 0.9;
+		params.color_cast = 0.1;
+		params.noise = 8;
+		params.jpeg = 80;
+		return params;
+	}
+}
+
+TEST_CASE( "ChannelSimulatorTest/testPerfectChannel", "[unit]" )
+{
+	ChannelParams params;
+	params.margin = 0.25;
+	ChannelSimulator channel(params, 1);
+
+	cv::Mat frame = sample_frame();
+	std::vector<cv::Mat> out = channel.transmit(frame);
+	assertEquals( 1, out.size() );
+
+	// the frame sits in the middle of the background, untouched
+	cv::Mat img = out[0];
+	assertEquals( 384, img.cols );
+	assertEquals( 384, img.rows );
+	assertEquals( 0, cv::norm(img(cv::Rect(64, 64, 256, 256)), frame, cv::NORM_INF) );
+	assertEquals( cv::Vec3b(32, 32, 32), img.at<cv::Vec3b>(0, 0) );
+}
+
+TEST_CASE( "ChannelSimulatorTest/testSeeded", "[unit]" )
+{
+	cv::Mat frame = sample_frame();
+
+	ChannelSimulator a(rough_channel(), 42);
+	ChannelSimulator b(rough_channel(), 42);
+	ChannelSimulator c(rough_channel(), 43);
+
+	for (unsigned i = 0; i < 3; ++i)
+	{
+		cv::Mat imgA = a.degrade(frame);
+		cv::Mat imgB = b.degrade(frame);
+		cv::Mat imgC = c.degrade(frame);
+		assertEquals( 0, cv::norm(imgA, imgB, cv::NORM_INF) );
+		assertTrue( cv::norm(imgA, imgC, cv::NORM_INF) > 0 );
+	}
+}
+
+TEST_CASE( "ChannelSimulatorTest/testDropAndDuplicate", "[unit]" )
+{
+	cv::Mat frame = sample_frame();
+
+	ChannelParams params;
+	params.drop = 1;
+	ChannelSimulator dropper(params);
+	assertEquals( 0, dropper.transmit(frame).size() );
+
+	params.drop = 0;
+	params.duplicate = 1;
+	ChannelSimulator duper(params);
+	assertEquals( 2, duper.transmit(frame).size() );
+}
+
+TEST_CASE( "ChannelSimulatorTest/testParams", "[unit]" )
+{
+	ChannelParams params;
+	for (auto&& [name, help] : ChannelParams::describe())
+	{
+		assertTrue( params.set(name, 0.5) );
+		assertEquals( 0.5, params.get(name) );
+	}
+	assertEquals( 0.5, params.motion_blur );
+	assertFalse( params.set("bogus", 1) );
+}
@@ -0,0 +1,104 @@
+/* This code is subject to the terms of the Mozilla Public License, v.2.0. http://mozilla.org/MPL/2.0/. */
+#include "unittest.h"
+#include "TestHelpers.h"
+
+#include "Loopback.h"
+#include "util/MakeTempDirectory.h"
+
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+	std::string random_payload(unsigned size)
+	{
+		std::mt19937 rng(1234);
+		std::string payload;
+		for (unsigned i = 0; i < size; ++i)
+			payload += (char)(rng() & 0xFF);
+		return payload;
+	}
+}
+
+TEST_CASE( "LoopbackTest/testPerfectChannel", "[unit]" )
+{
+	MakeTempDirectory tempdir;
+	std::string payload = random_payload(20000);
+
+	ChannelSimulator channel(ChannelParams(), 1);
+	Loopback loop(30, 2);
+	LoopbackStats stats = loop.run(payload, channel, tempdir.path(), 20);
+
+	assertTrue( stats.complete );
+	assertEquals( stats.frames_sent, stats.frames_received );
+	assertEquals( stats.frames_sent, stats.frames_decoded );
+	assertTrue( stats.frames_sent <= 5 );
+	assertEquals( (double)payload.size() / stats.frames_sent, stats.goodput() );
+}
+
+TEST_CASE( "LoopbackTest/testMildChannel", "[unit]" )
+{
+	MakeTempDirectory tempdir;
+	std::string payload = random_payload(20000);
+
+	ChannelParams params;
+	params.perspective = 0.01;
+	params.rotation = 3;
+	params.defocus = 0.5;
+	params.noise = 3;
+	params.jpeg = 95;
+	params.drop = 0.2;
+	ChannelSimulator channel(params, 7);
+
+	Loopback loop(30, 2);
+	LoopbackStats stats = loop.run(payload, channel, tempdir.path(), 50);
+
+	assertTrue( stats.complete );
+	assertTrue( stats.goodput() > 0 );
+}
+
+TEST_CASE( "LoopbackTest/testDeadChannel", "[unit]" )
+{
+	MakeTempDirectory tempdir;
+	std::string payload = random_payload(20000);
+
+	ChannelParams params;
+	params.drop = 1;
+	ChannelSimulator channel(params, 1);
+
+	Loopback loop(30, 2);
+	LoopbackStats stats = loop.run(payload, channel, tempdir.path(), 10);
+
+	assertFalse( stats.complete );
+	assertEquals( 10, stats.frames_sent );
+	assertEquals( 0, stats.frames_received );
+	assertEquals( 0, stats.goodput() );
+}
+
+TEST_CASE( "LoopbackTest/testRepeatable", "[unit]" )
+{
+	MakeTempDirectory tempdir;
+	std::string payload = random_payload(20000);
+
+	ChannelParams params;
+	params.rotation = 2;
+	params.noise = 5;
+	params.jpeg = 90;
+	params.drop = 0.1;
+
+	// same setting, same seed => same answer. No matter what ran before it on this thread.
+	Loopback loop(30, 2);
+	std::vector<LoopbackStats> runs;
+	for (int i = 0; i < 2; ++i)
+	{
+		ChannelSimulator channel(params, 5);
+		runs.push_back(loop.run(payload, channel, tempdir.path(), 50));
+	}
+
+	assertEquals( runs[0].frames_sent, runs[1].frames_sent );
+	assertEquals( runs[0].frames_received, runs[1].frames_received );
+	assertEquals( runs[0].frames_extracted, runs[1].frames_extracted );
+	assertEquals( runs[0].frames_decoded, runs[1].frames_decoded );
+	assertEquals( runs[0].bytes_decoded, runs[1].bytes_decoded );
+	assertEquals( runs[0].complete, runs[1].complete );
+}
@@ -0,0 +1,122 @@
+/* This code is subject to the terms of the Mozilla Public License, v.2.0. http://mozilla.org/MPL/2.0/. */
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <tuple>
+#include <vector>
+
+// per-cell "soft" decode results -- the hamming distance to every symbol tile, and the raw average color --
+// summed across one or more looks at the same frame.
+// a single look is just a (very verbose) decode. Several looks can be combined to outvote the noise in any one of them.
+class CellEvidence
+{
+public:
+	CellEvidence(unsigned num_cells=0, unsigned num_symbols=0);
+
+	void reset(unsigned num_cells, unsigned num_symbols);
+	void clear();
+
+	unsigned looks() const;
+	unsigned num_cells() const;
+	unsigned num_symbols() const;
+
+	void add_symbol(unsigned index, const uint8_t* distances);
+	void add_color(unsigned index, uint8_t r, uint8_t g, uint8_t b);
+	void add_look(const CellEvidence& other);
+	void mark_look();
+
+	unsigned best_symbol(unsigned index) const;
+	std::tuple<float, float, float> mean_color(unsigned index) const;
+
+protected:
+	unsigned _numCells;
+	unsigned _numSymbols;
+	unsigned _looks;
+	std::vector<uint16_t> _distances; // _numCells * _numSymbols. 64 bits per hash => ~1000 looks before we'd overflow
+	std::vector<uint32_t> _colors; // _numCells * 3
+};
+
+inline CellEvidence::CellEvidence(unsigned num_cells, unsigned num_symbols)
+{
+	reset(num_cells, num_symbols);
+}
+
+inline void CellEvidence::reset(unsigned num_cells, unsigned num_symbols)
+{
+	_numCells = num_cells;
+	_numSymbols = num_symbols;
+	_distances.resize(_numCells * _numSymbols);
+	_colors.resize(_numCells * 3);
+	clear();
+}
+
+inline void CellEvidence::clear()
+{
+	_looks = 0;
+	std::fill(_distances.begin(), _distances.end(), 0);
+	std::fill(_colors.begin(), _colors.end(), 0);
+}
+
+inline unsigned CellEvidence::looks() const
+{
+	return _looks;
+}
+
+inline unsigned CellEvidence::num_cells() const
+{
+	return _numCells;
+}
+
+inline unsigned CellEvidence::num_symbols() const
+{
+	return _numSymbols;
+}
+
+inline void CellEvidence::add_symbol(unsigned index, const uint8_t* distances)
+{
+	uint16_t* d = _distances.data() + (index * _numSymbols);
+	for (unsigned s = 0; s < _numSymbols; ++s)
+		d[s] += distances[s];
+}
+
+inline void CellEvidence::add_color(unsigned index, uint8_t r, uint8_t g, uint8_t b)
+{
+	uint32_t* c = _colors.data() + (index * 3);
+	c[0] += r;
+	c[1] += g;
+	c[2] += b;
+}
+
+inline void CellEvidence::add_look(const CellEvidence& other)
+{
+	if (other._numCells != _numCells or other._numSymbols != _numSymbols)
+		return;
+
+	for (unsigned i = 0; i < _distances.size(); ++i)
+		_distances[i] += other._distances[i];
+	for (unsigned i = 0; i < _colors.size(); ++i)
+		_colors[i] += other._colors[i];
+	_looks += other._looks;
+}
+
+inline void CellEvidence::mark_look()
+{
+	++_looks;
+}
+
+inline unsigned CellEvidence::best_symbol(unsigned index) const
+{
+	const uint16_t* d = _distances.data() + (index * _numSymbols);
+	return std::min_element(d, d + _numSymbols) - d;
+}
+
+inline std::tuple<float, float, float> CellEvidence::mean_color(unsigned index) const
+{
+	if (!_looks)
+		return {0, 0, 0};
+
+	const uint32_t* c = _colors.data() + (index * 3);
+	float looks = _looks;
+	return {c[0] / looks, c[1] / looks, c[2] / looks};
+}
@@ -55,7 +55,8 @@ namespace {
 }
 
 CimbDecoder::CimbDecoder(unsigned symbol_bits, unsigned color_bits, bool dark, uchar ahashThreshold)
-	: _symbolBits(symbol_bits)
+	: _grid(&cimbar::Config::grid())
+	, _symbolBits(symbol_bits)
 	, _numSymbols(1 << symbol_bits)
 	, _numColors(1 << color_bits)
 	, _dark(dark)
@@ -83,10 +84,14 @@ void CimbDecoder::update_color_correction(cv::Matx<float, 3, 3>&& ccm)
 	internal_ccm().update(std::move(ccm));
 }
 
+void CimbDecoder::reset_color_correction()
+{
+	internal_ccm() = color_correction();
+}
+
 uint64_t CimbDecoder::get_tile_hash(unsigned symbol) const
 {
-	cv::Mat tile = cimbar::getTile(_symbolBits, symbol, _dark, _numColors);
-	return image_hash::average_hash(tile);
+	return cimbar::getTileHash(_symbolBits, symbol, _dark);
 }
 
 bool CimbDecoder::load_tiles()
@@ -97,7 +102,8 @@ bool CimbDecoder::load_tiles()
 	return true;
 }
 
-unsigned CimbDecoder::get_best_symbol(image_hash::ahash_result<cimbar::Config::cell_size()>& results, unsigned& drift_offset, unsigned& best_distance, unsigned cooldown) const
+template <unsigned CELLSIZE>
+unsigned CimbDecoder::get_best_symbol(image_hash::ahash_result<CELLSIZE>& results, unsigned& drift_offset, unsigned& best_distance, unsigned cooldown) const
 {
 	drift_offset = 0;
 	unsigned best_fit = 0;
@@ -130,19 +136,48 @@ unsigned CimbDecoder::get_best_symbol(image_hash::ahash_result<cimbar::Config::c
 	return best_fit;
 }
 
+template unsigned CimbDecoder::get_best_symbol(image_hash::ahash_result<cimbar::Conf5x5::cell_size>&, unsigned&, unsigned&, unsigned) const;
+template unsigned CimbDecoder::get_best_symbol(image_hash::ahash_result<cimbar::Conf8x8::cell_size>&, unsigned&, unsigned&, unsigned) const;
+
+// the hashing is specialized on cell size, so we pick the right one per call.
 unsigned CimbDecoder::decode_symbol(const cv::Mat& cell, unsigned& drift_offset, unsigned& best_distance, unsigned cooldown) const
 {
-	image_hash::ahash_result<cimbar::Config::cell_size()> results = image_hash::fuzzy_ahash<cimbar::Config::cell_size()>(
-		cell, _ahashThreshold, image_hash::ahash_result<cimbar::Config::cell_size()>::FAST
-	);
-	return get_best_symbol(results, drift_offset, best_distance, cooldown);
+	return cimbar::Config::dispatch(*_grid, [&](auto conf) {
+		constexpr unsigned CELLSIZE = decltype(conf)::cell_size;
+		image_hash::ahash_result<CELLSIZE> results = image_hash::fuzzy_ahash<CELLSIZE>(
+			cell, _ahashThreshold, image_hash::ahash_result<CELLSIZE>::FAST
+		);
+		return get_best_symbol(results, drift_offset, best_distance, cooldown);
+	});
 }
 
 unsigned CimbDecoder::decode_symbol(const bitmatrix& cell, unsigned& drift_offset, unsigned& best_distance, unsigned cooldown) const
 {
-	int checkRule = cooldown == 0xFE? image_hash::ahash_result<cimbar::Config::cell_size()>::ALL : image_hash::ahash_result<cimbar::Config::cell_size()>::FAST;
-	image_hash::ahash_result<cimbar::Config::cell_size()> results = image_hash::fuzzy_ahash<cimbar::Config::cell_size()>(cell, checkRule);
-	return get_best_symbol(results, drift_offset, best_distance, cooldown);
+	return cimbar::Config::dispatch(*_grid, [&](auto conf) {
+		constexpr unsigned CELLSIZE = decltype(conf)::cell_size;
+		int checkRule = cooldown == 0xFE? image_hash::ahash_result<CELLSIZE>::ALL : image_hash::ahash_result<CELLSIZE>::FAST;
+		image_hash::ahash_result<CELLSIZE> results = image_hash::fuzzy_ahash<CELLSIZE>(cell, checkRule);
+		return get_best_symbol(results, drift_offset, best_distance, cooldown);
+	});
+}
+
+unsigned CimbDecoder::decode_symbol(const bitmatrix& cell, unsigned& drift_offset, unsigned& best_distance, unsigned cooldown, uint8_t* distances) const
+{
+	return cimbar::Config::dispatch(*_grid, [&](auto conf) {
+		constexpr unsigned CELLSIZE = decltype(conf)::cell_size;
+		int checkRule = cooldown == 0xFE? image_hash::ahash_result<CELLSIZE>::ALL : image_hash::ahash_result<CELLSIZE>::FAST;
+		image_hash::ahash_result<CELLSIZE> results = image_hash::fuzzy_ahash<CELLSIZE>(cell, checkRule);
+		unsigned bits = get_best_symbol(results, drift_offset, best_distance, cooldown);
+		// the distances are for the winning drift only. Other drifts are where the symbol *isn't*.
+		get_symbol_distances(results[drift_offset], distances);
+		return bits;
+	});
+}
+
+void CimbDecoder::get_symbol_distances(uint64_t hash, uint8_t* distances) const
+{
+	for (unsigned i = 0; i < _tileHashes.size(); ++i)
+		distances[i] = image_hash::hamming_distance(hash, _tileHashes[i]);
 }
 
 std::tuple<uchar,uchar,uchar> CimbDecoder::fix_color(std::tuple<float,float,float> c, float adjustUp, float down) const
@@ -224,3 +259,13 @@ unsigned CimbDecoder::symbol_bits() const
 {
 	return _symbolBits;
 }
+
+unsigned CimbDecoder::num_symbols() const
+{
+	return _numSymbols;
+}
+
+unsigned CimbDecoder::cell_size() const
+{
+	return _grid->cell_size;
+}
@@ -17,10 +17,14 @@ public:
 
 	const color_correction& get_ccm() const;
 	void update_color_correction(cv::Matx<float, 3, 3>&& ccm);
+	void reset_color_correction();
 
-	unsigned get_best_symbol(image_hash::ahash_result<cimbar::Config::cell_size()>& results, unsigned& drift_offset, unsigned& best_distance, unsigned cooldown=0xFF) const;
+	template <unsigned CELLSIZE>
+	unsigned get_best_symbol(image_hash::ahash_result<CELLSIZE>& results, unsigned& drift_offset, unsigned& best_distance, unsigned cooldown=0xFF) const;
 	unsigned decode_symbol(const cv::Mat& cell, unsigned& drift_offset, unsigned& best_distance, unsigned cooldown=0xFF) const;
 	unsigned decode_symbol(const bitmatrix& cell, unsigned& drift_offset, unsigned& best_distance, unsigned cooldown=0xFF) const;
+	unsigned decode_symbol(const bitmatrix& cell, unsigned& drift_offset, unsigned& best_distance, unsigned cooldown, uint8_t* distances) const;
+	void get_symbol_distances(uint64_t hash, uint8_t* distances) const;
 
 	std::tuple<uchar,uchar,uchar> get_color(int i, unsigned color_mode) const;
 	std::tuple<uchar,uchar,uchar> avg_color(const Cell& color_cell) const;
@@ -29,6 +33,8 @@ public:
 
 	bool expects_binary_threshold() const;
 	unsigned symbol_bits() const;
+	unsigned num_symbols() const;
+	unsigned cell_size() const;
 
 protected:
 	color_correction& internal_ccm() const;
@@ -40,6 +46,7 @@ protected:
 	std::tuple<uchar,uchar,uchar> fix_color(std::tuple<float,float,float> c, float adjustUp, float down) const;
 
 protected:
+	const cimbar::GridSpec* _grid; // whatever Config said when we were made
 	std::vector<uint64_t> _tileHashes;
 	unsigned _symbolBits;
 	unsigned _numSymbols;
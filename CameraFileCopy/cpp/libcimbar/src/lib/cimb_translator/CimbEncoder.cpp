@@ -24,17 +24,14 @@ cv::Mat CimbEncoder::load_tile(unsigned symbol_bits, unsigned index)
 	return cimbar::getTile(symbol_bits, symbol, _dark, _numColors, color, _colorMode);
 }
 
-// dir will need to be passed via env? Doesn't make sense to compile it in, and doesn't *really* make sense to use cwd
+// the tiles are the same for every encoder with our settings, so they only get loaded once
 bool CimbEncoder::load_tiles(unsigned symbol_bits)
 {
-	unsigned numTiles = _numColors * _numSymbols;
-	for (unsigned i = 0; i < numTiles; ++i)
-		_tiles.push_back(load_tile(symbol_bits, i));
-	return true;
+	_tiles = TileAtlas::get(symbol_bits, (unsigned)std::log2(_numColors), _dark, _colorMode);
+	return _tiles->size() == _numColors * _numSymbols;
 }
 
 const cv::Mat& CimbEncoder::encode(unsigned bits) const
 {
-	bits = bits % _tiles.size();
-	return _tiles[bits];
+	return _tiles->tile(bits);
 }
@@ -1,10 +1,11 @@
 /* This code is subject to the terms of the Mozilla Public License, v.2.0. http://mozilla.org/MPL/2.0/. */
 #pragma once
 
+#include "TileAtlas.h"
 #include <opencv2/opencv.hpp>
 
+#include <memory>
 #include <string>
-#include <vector>
 
 class CimbEncoder
 {
@@ -17,7 +18,7 @@ public:
 	const cv::Mat& encode(unsigned bits) const;
 
 protected:
-	std::vector<cv::Mat> _tiles;
+	std::shared_ptr<const TileAtlas> _tiles;
 	unsigned _numSymbols;
 	unsigned _numColors;
 	bool _dark;
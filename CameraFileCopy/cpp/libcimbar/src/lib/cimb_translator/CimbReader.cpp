@@ -4,7 +4,7 @@
 #include "CellDrift.h"
 #include "Common.h"
 #include "Config.h"
-#include "Interleave.h"
+#include "DecodeGeometry.h"
 
 #include "bit_file/bitmatrix.h"
 #include "chromatic_adaptation/adaptation_transform.h"
@@ -27,22 +27,23 @@ namespace {
 	}
 
 	template <typename MAT>
-	bitbuffer preprocessSymbolGrid(const MAT& img, bool needs_sharpen)
+	void preprocessSymbolGrid(const MAT& img, bool needs_sharpen, CimbReader::Scratch& scratch)
 	{
 		int blockSize = 5; // default: no preprocessing
 
-		cv::Mat symbols;
-		cv::cvtColor(img, symbols, cv::COLOR_RGB2GRAY);
+		cv::cvtColor(img, scratch.gray, cv::COLOR_RGB2GRAY);
+		const cv::Mat* symbols = &scratch.gray;
 		if (needs_sharpen)
 		{
 			blockSize = 7;
-			sharpenSymbolGrid(symbols, symbols);
+			sharpenSymbolGrid(scratch.gray, scratch.sharpened);
+			symbols = &scratch.sharpened;
 		}
-		cv::adaptiveThreshold(symbols, symbols, 255, cv::ADAPTIVE_THRESH_MEAN_C, cv::THRESH_BINARY, blockSize, 0);
+		// not in place: adaptiveThreshold() uses dst for its mean image if it can, instead of allocating one
+		cv::adaptiveThreshold(*symbols, scratch.symbols, 255, cv::ADAPTIVE_THRESH_MEAN_C, cv::THRESH_BINARY, blockSize, 0);
 
-		bitbuffer bb(std::pow(Config::image_size(), 2) / 8);
-		bitmatrix::mat_to_bitbuffer(symbols, bb.get_writer());
-		return bb;
+		scratch.grayscale.clear();
+		bitmatrix::mat_to_bitbuffer(scratch.symbols, scratch.grayscale.get_writer());
 	}
 
 	void updateMaxColor(std::tuple<float, float, float>& max_color, const cv::Scalar& c)
@@ -90,23 +91,38 @@ namespace {
 	}
 }
 
-CimbReader::CimbReader(const cv::Mat& img, CimbDecoder& decoder, unsigned color_mode, bool needs_sharpen, int color_correction)
-	: _image(img)
+CimbReader::Scratch::Scratch()
+	: grayscale(std::pow(Config::image_size(), 2) / 8)
+	, positions(DecodeGeometry::get())
+	, header(FountainMetadata::md_size)
+{
+}
+
+CimbReader::CimbReader(const cv::Mat& img, CimbDecoder& decoder, unsigned color_mode, bool needs_sharpen, int color_correction, Scratch* scratch)
+	: _ownScratch(scratch? nullptr : std::make_unique<Scratch>())
+	, _scratch(scratch? *scratch : *_ownScratch)
+	, _image(img)
+	, _grayscale(_scratch.grayscale)
 	, _fountainColorHeader(0U)
 	, _cellSize(Config::cell_size() + 2)
-	, _positions(Config::cell_spacing(), Config::cells_per_col(), Config::cell_offset(), Config::corner_padding())
+	, _positions(_scratch.positions)
 	, _decoder(decoder)
 	, _good(_image.cols >= Config::image_size() and _image.rows >= Config::image_size())
 	, _colorCorrection(color_correction)
 	, _colorMode(color_mode)
 {
-	_grayscale = preprocessSymbolGrid(img, needs_sharpen);
+	// the scratch may have last seen a different grid
+	if (_positions.geometry().dimensions() != (int)Config::cells_per_col())
+		_positions = FloodDecodePositions(DecodeGeometry::get());
+	else
+		_positions.reset();
+	preprocessSymbolGrid(img, needs_sharpen, _scratch);
 	if (_good and color_correction == 1)
 		simpleColorCorrection(_image, decoder);
 }
 
-CimbReader::CimbReader(const cv::UMat& img, CimbDecoder& decoder, unsigned color_mode, bool needs_sharpen, int color_correction)
-	: CimbReader(img.getMat(cv::ACCESS_READ), decoder, color_mode, needs_sharpen, color_correction)
+CimbReader::CimbReader(const cv::UMat& img, CimbDecoder& decoder, unsigned color_mode, bool needs_sharpen, int color_correction, Scratch* scratch)
+	: CimbReader(img.getMat(cv::ACCESS_READ), decoder, color_mode, needs_sharpen, color_correction, scratch)
 {
 }
 
@@ -129,7 +145,15 @@ unsigned CimbReader::read(PositionData& pos)
 
 	unsigned drift_offset = 0;
 	unsigned error_distance;
-	unsigned bits = _decoder.decode_symbol(cell, drift_offset, error_distance, cooldown);
+	unsigned bits;
+	if (_evidence)
+	{
+		std::array<uint8_t, 64> distances;
+		bits = _decoder.decode_symbol(cell, drift_offset, error_distance, cooldown, distances.data());
+		_evidence->add_symbol(i, distances.data());
+	}
+	else
+		bits = _decoder.decode_symbol(cell, drift_offset, error_distance, cooldown);
 
 	std::pair<int, int> best_drift = CellDrift::driftPairs[drift_offset];
 	drift.updateDrift(best_drift.first, best_drift.second);
@@ -138,6 +162,14 @@ unsigned CimbReader::read(PositionData& pos)
 	pos.i = i;
 	pos.x = x + best_drift.first;
 	pos.y = y + best_drift.second;
+
+	// the color sample is raw (pre-ccm). The ccm is applied when the evidence is decoded.
+	if (_evidence)
+	{
+		Cell color_cell(_image, pos.x, pos.y, Config::cell_size(), Config::cell_size());
+		auto [r, g, b] = _decoder.avg_color(color_cell);
+		_evidence->add_color(i, r, g, b);
+	}
 	return bits;
 }
 
@@ -146,6 +178,18 @@ bool CimbReader::done() const
 	return !_good or _positions.done();
 }
 
+bool CimbReader::good() const
+{
+	return _good;
+}
+
+void CimbReader::capture_evidence(CellEvidence* evidence)
+{
+	_evidence = evidence;
+	if (_evidence)
+		_evidence->reset(num_reads(), _decoder.num_symbols());
+}
+
 void CimbReader::init_ccm(unsigned color_bits, unsigned interleave_blocks, unsigned interleave_partitions, unsigned fountain_blocks)
 {
 	if (_colorCorrection != 2)
@@ -163,7 +207,8 @@ void CimbReader::init_ccm(unsigned color_bits, unsigned interleave_blocks, unsig
 	// full ccm, using header values as known color index
 	// 1. get positions
 	// 2. put fountain header into a bitbuffer so we can read decoder.color_bits() bits at a time
-	CellPositions::positions_list positions = Interleave::interleave(_positions.positions(), interleave_blocks, interleave_partitions);
+	// (the interleaved order comes from the shared geometry, so there's nothing to build here)
+	std::shared_ptr<const DecodeGeometry> geometry = DecodeGeometry::get(interleave_blocks, interleave_partitions);
 
 	// 3. using expected fountain headers, decode color for each position
 	unsigned end = cimbar::Config::capacity(color_bits) * 8 / color_bits;
@@ -174,8 +219,9 @@ void CimbReader::init_ccm(unsigned color_bits, unsigned interleave_blocks, unsig
 	//std::cout << fmt::format("fountain end={},headerstart={},headerlen={}", end, headerStartInterval, headerLen) << std::endl;
 
 	// get color map
-	std::unordered_map<uint16_t, std::tuple<unsigned, unsigned, unsigned, unsigned>> colors;
-	bitbuffer buff;
+	std::vector<std::array<unsigned, 4>>& colors = _scratch.colors;
+	colors.assign(1 << color_bits, {0, 0, 0, 0}); // count,r,g,b
+	bitbuffer& buff = _scratch.header;
 	for (unsigned block = 0; block < end; block+=headerStartInterval)
 	{
 		// TODO: could just copy/write final 2 bytes after first round?
@@ -185,7 +231,7 @@ void CimbReader::init_ccm(unsigned color_bits, unsigned interleave_blocks, unsig
 		for (unsigned idx = block, i = 0; idx < block+headerLen; ++idx, i+=color_bits)
 		{
 			unsigned expected = buff.read(i, color_bits);
-			CellPositions::coordinate pos = positions[idx];
+			CellPositions::coordinate pos = geometry->position(geometry->interleave(idx));
 
 			//Cell color_cell(_image, pos.first, pos.second, Config::cell_size(), Config::cell_size());
 			//auto col = _decoder.avg_color(color_cell); // could just call cell mean_rgb directly?
@@ -193,54 +239,61 @@ void CimbReader::init_ccm(unsigned color_bits, unsigned interleave_blocks, unsig
 			Cell color_cell(_image, pos.first+1, pos.second+1, Config::cell_size()-2, Config::cell_size()-2);
 			auto col = color_cell.mean_rgb();
 
-			auto [it, isNew] = colors.try_emplace(expected, std::make_tuple(0, 0, 0, 0)); // count,r,g,b
-			std::get<0>(it->second) += 1;
-			std::get<1>(it->second) += std::get<0>(col);
-			std::get<2>(it->second) += std::get<1>(col);
-			std::get<3>(it->second) += std::get<2>(col);
+			std::array<unsigned, 4>& c = colors[expected];
+			c[0] += 1;
+			c[1] += std::get<0>(col);
+			c[2] += std::get<1>(col);
+			c[3] += std::get<2>(col);
 		}
 
 		_fountainColorHeader.increment_block_id();
 	}
 
 	// 4. compute avgs
-	cv::Mat actual = cv::Mat::ones(0, 3, CV_32F);
-	cv::Mat desired = cv::Mat::ones(0, 3, CV_32F);
+	// the scratch mats are sized for every color + the corner sample. We use the first `rows` of them.
+	_scratch.actual.create(colors.size() + 1, 3, CV_32F);
+	_scratch.desired.create(colors.size() + 1, 3, CV_32F);
 
-	for (auto& it : colors)
+	int rows = 0;
+	for (unsigned color = 0; color < colors.size(); ++color)
 	{
-		unsigned total = std::get<0>(it.second);
+		std::array<unsigned, 4>& c = colors[color];
+		unsigned total = c[0];
 		if (total == 0)
 			continue;
 
-		std::get<1>(it.second) /= total;
-		std::get<2>(it.second) /= total;
-		std::get<3>(it.second) /= total;
-
-		cv::Mat arow = (cv::Mat_<float>(1,3) << std::get<1>(it.second), std::get<2>(it.second), std::get<3>(it.second));
-		actual.push_back(arow);
-
-		cimbar::RGB cc = _decoder.get_color(it.first, _colorMode);
-		cv::Mat drow = (cv::Mat_<float>(1,3) << std::get<0>(cc), std::get<1>(cc), std::get<2>(cc));
-		desired.push_back(drow);
+		float* arow = _scratch.actual.ptr<float>(rows);
+		arow[0] = c[1] / total;
+		arow[1] = c[2] / total;
+		arow[2] = c[3] / total;
+
+		cimbar::RGB cc = _decoder.get_color(color, _colorMode);
+		float* drow = _scratch.desired.ptr<float>(rows);
+		drow[0] = std::get<0>(cc);
+		drow[1] = std::get<1>(cc);
+		drow[2] = std::get<2>(cc);
+		++rows;
 	}
 
 	// bail if we don't have enough data...
-	if (actual.rows < 4)
+	if (rows < 4)
 		return;
 
 	// 5. sample corners
 	{
 		std::tuple<float, float, float> white = calculateWhite(_image, Config::dark());
-		cv::Mat arow = (cv::Mat_<float>(1,3) << std::get<0>(white), std::get<1>(white), std::get<2>(white));
-		actual.push_back(arow);
-
-		cv::Mat drow = (cv::Mat_<float>(1,3) << 255, 255, 255);
-		desired.push_back(drow);
+		float* arow = _scratch.actual.ptr<float>(rows);
+		arow[0] = std::get<0>(white);
+		arow[1] = std::get<1>(white);
+		arow[2] = std::get<2>(white);
+
+		float* drow = _scratch.desired.ptr<float>(rows);
+		drow[0] = drow[1] = drow[2] = 255;
+		++rows;
 	}
 
 	// 6. generate ccm from avgs in #4/5, save in decoder. Success! We hope
-	_decoder.update_color_correction(color_correction::get_moore_penrose_lsm(actual, desired));
+	_decoder.update_color_correction(color_correction::get_moore_penrose_lsm(_scratch.actual.rowRange(0, rows), _scratch.desired.rowRange(0, rows)));
 }
 
 void CimbReader::update_metadata(char* buff, unsigned len)
@@ -1,6 +1,7 @@
 /* This code is subject to the terms of the Mozilla Public License, v.2.0. http://mozilla.org/MPL/2.0/. */
 #pragma once
 
+#include "CellEvidence.h"
 #include "CimbDecoder.h"
 #include "FloodDecodePositions.h"
 #include "PositionData.h"
@@ -9,15 +10,43 @@
 #include "fountain/FountainMetadata.h"
 #include <opencv2/opencv.hpp>
 
+#include <array>
+#include <memory>
+#include <vector>
+
 class CimbReader
 {
 public:
-	CimbReader(const cv::Mat& img, CimbDecoder& decoder, unsigned color_mode, bool needs_sharpen=false, int color_correction=2);
-	CimbReader(const cv::UMat& img, CimbDecoder& decoder, unsigned color_mode, bool needs_sharpen=false, int color_correction=2);
+	// the per-frame buffers. Hand one in (and keep it around) to avoid reallocating them every frame.
+	// one reader at a time, though!
+	struct Scratch
+	{
+		Scratch();
+
+		cv::Mat gray;
+		cv::Mat sharpened;
+		cv::Mat symbols;
+		bitbuffer grayscale;
+		FloodDecodePositions positions;
+
+		// for init_ccm()
+		bitbuffer header;
+		std::vector<std::array<unsigned, 4>> colors; // count,r,g,b
+		cv::Mat actual;
+		cv::Mat desired;
+	};
+
+public:
+	CimbReader(const cv::Mat& img, CimbDecoder& decoder, unsigned color_mode, bool needs_sharpen=false, int color_correction=2, Scratch* scratch=nullptr);
+	CimbReader(const cv::UMat& img, CimbDecoder& decoder, unsigned color_mode, bool needs_sharpen=false, int color_correction=2, Scratch* scratch=nullptr);
 
 	unsigned read(PositionData& pos);
 	unsigned read_color(const PositionData& pos) const;
 	bool done() const;
+	bool good() const;
+
+	// optional: also record the per-cell symbol distances and colors, for multi-frame decodes
+	void capture_evidence(CellEvidence* evidence);
 
 	void init_ccm(unsigned color_bits, unsigned interleave_blocks, unsigned interleave_partitions, unsigned fountain_blocks);
 	void update_metadata(char* buff, unsigned len);
@@ -25,13 +54,17 @@ public:
 	unsigned num_reads() const;
 
 protected:
+	std::unique_ptr<Scratch> _ownScratch; // if nobody gave us one
+	Scratch& _scratch;
+
 	cv::Mat _image;
-	bitbuffer _grayscale;
+	bitbuffer& _grayscale;
 	FountainMetadata _fountainColorHeader;
 
 	unsigned _cellSize;
-	FloodDecodePositions _positions;
+	FloodDecodePositions& _positions;
 	CimbDecoder& _decoder;
+	CellEvidence* _evidence = nullptr;
 	bool _good;
 	int _colorCorrection;
 	unsigned _colorMode;
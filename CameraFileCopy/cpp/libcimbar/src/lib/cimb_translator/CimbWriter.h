@@ -4,12 +4,18 @@
 #include "CellPositions.h"
 #include "CimbEncoder.h"
 
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <vector>
+
 class CimbWriter
 {
 public:
 	CimbWriter(unsigned symbol_bits, unsigned color_bits, bool dark=true, unsigned color_mode=1, int size=0);
 
 	bool write(unsigned bits);
+	unsigned write(const uint8_t* cells, unsigned count); // one tile index per cell. Returns how many were written
 	bool done() const;
 
 	cv::Mat image() const;
@@ -17,11 +23,26 @@ public:
 	unsigned num_cells() const;
 
 protected:
-	void paste(const cv::Mat& img, int x, int y);
+	void blit(unsigned bits, size_t offset);
+
+	// the tiles are tiny, so we want the row copies to be fixed size memcpys the compiler can inline
+	template <unsigned CELLSIZE, size_t... ROWS>
+	static void blit_rows(const uint8_t* tile, uint8_t* dst, size_t stride, std::index_sequence<ROWS...>)
+	{
+		(std::memcpy(dst + ROWS*stride, tile + ROWS*CELLSIZE*3, CELLSIZE*3), ...);
+	}
+
+	template <unsigned CELLSIZE>
+	static void blit(const uint8_t* tile, uint8_t* dst, size_t stride)
+	{
+		blit_rows<CELLSIZE>(tile, dst, stride, std::make_index_sequence<CELLSIZE>{});
+	}
 
 protected:
 	cv::Mat _image;
 	CellPositions _positions;
 	CimbEncoder _encoder;
+	std::vector<size_t> _cellOffsets; // byte offset of each cell in _image
+	unsigned _cellSize;
 	unsigned _offset = 0;
 };
@@ -2,20 +2,14 @@
 #include "Common.h"
 
 #include "Config.h"
-#include "base91/base.hpp"
-#include "serialize/format.h"
-#define STB_IMAGE_IMPLEMENTATION
-#include "stb/stb_image.h"
+#include "bitmaps.h"
 #include <opencv2/opencv.hpp>
 
-#include <map>
 #include <string>
-#include "bitmaps.h"
 
 using cimbar::RGB;
 using std::array;
 using std::string;
-using std::vector;
 
 namespace {
 	RGB getColor4(unsigned index)
@@ -76,22 +70,17 @@ namespace cimbar {
 
 cv::Mat load_img(string path)
 {
-	auto it = cimbar::bitmaps.find(path);
-	if (it == cimbar::bitmaps.end())
+	const bitmaps::bitmap* bm = bitmaps::get_marker(path);
+	if (!bm)
 		return cv::Mat();
 
-	string bytes = base91::decode(it->second);
-	vector<unsigned char> data(bytes.data(), bytes.data() + bytes.size());
-
-	int width, height, channels;
-	std::unique_ptr<uint8_t[], void (*)(void*)> imgdata(stbi_load_from_memory(data.data(), static_cast<int>(data.size()), &width, &height, &channels, STBI_rgb_alpha), ::free);
-	if (!imgdata)
-		return cv::Mat();
-
-	size_t len = width * height * channels;
-	cv::Mat mat(height, width, CV_MAKETYPE(CV_8U, channels));
-	std::copy(imgdata.get(), imgdata.get()+len, mat.data);
-	cv::cvtColor(mat, mat, cv::COLOR_RGBA2RGB);
+	cv::Mat mat(bm->height, bm->width, CV_8UC3);
+	for (unsigned y = 0; y < bm->height; ++y)
+	{
+		cv::Vec3b* p = mat.ptr<cv::Vec3b>(y);
+		for (unsigned x = 0; x < bm->width; ++x)
+			p[x] = bm->get(x, y)? cv::Vec3b(0xFF, 0xFF, 0xFF) : cv::Vec3b(0, 0, 0);
+	}
 	return mat;
 }
 
@@ -114,26 +103,35 @@ RGB getColor(unsigned index, unsigned num_colors, unsigned color_mode)
 
 cv::Mat getTile(unsigned symbol_bits, unsigned symbol, bool dark, unsigned num_colors, unsigned color, unsigned color_mode)
 {
-	static cv::Vec3b background({0xFF, 0xFF, 0xFF});
-
-	string imgPath = fmt::format("bitmap/{}/{:02x}.png", symbol_bits, symbol);
-	cv::Mat tile = load_img(imgPath);
+	const bitmaps::symbol_set* symbols = bitmaps::get_symbols(symbol_bits);
+	if (!symbols or symbol >= symbols->count)
+		return cv::Mat();
 
 	uchar r, g, b;
 	std::tie(r, g, b) = getColor(color, num_colors, color_mode);
-	cv::MatIterator_<cv::Vec3b> end = tile.end<cv::Vec3b>();
-	for (cv::MatIterator_<cv::Vec3b> it = tile.begin<cv::Vec3b>(); it != end; ++it)
+	cv::Vec3b foreground(r, g, b);
+	cv::Vec3b background = dark? cv::Vec3b(0, 0, 0) : cv::Vec3b(0xFF, 0xFF, 0xFF);
+
+	unsigned size = symbols->cell_size;
+	uint64_t mask = symbols->masks[symbol];
+	int bitpos = size*size - 1;
+
+	cv::Mat tile(size, size, CV_8UC3);
+	for (unsigned i = 0; i < size; ++i)
 	{
-		cv::Vec3b& c = *it;
-		if (c == background)
-		{
-			if (dark)
-				c = {0, 0, 0};
-			continue;
-		}
-		c = {r, g, b};
+		cv::Vec3b* p = tile.ptr<cv::Vec3b>(i);
+		for (unsigned j = 0; j < size; ++j, --bitpos)
+			p[j] = ((mask >> bitpos) & 1)? background : foreground;
 	}
 	return tile;
 }
 
+uint64_t getTileHash(unsigned symbol_bits, unsigned symbol, bool dark)
+{
+	const bitmaps::symbol_set* symbols = bitmaps::get_symbols(symbol_bits);
+	if (!symbols or symbol >= symbols->count)
+		return 0;
+	return dark? symbols->hashes_dark[symbol] : symbols->hashes_light[symbol];
+}
+
 }
@@ -2,6 +2,7 @@
 #pragma once
 
 #include <opencv2/opencv.hpp>
+#include <cstdint>
 #include <string>
 
 namespace cimbar
@@ -12,4 +13,5 @@ namespace cimbar
 
 	std::tuple<uchar,uchar,uchar> getColor(unsigned index, unsigned num_colors, unsigned color_mode);
 	cv::Mat getTile(unsigned symbol_bits, unsigned symbol, bool dark=true, unsigned num_colors=4, unsigned color=0, unsigned color_mode=1);
+	uint64_t getTileHash(unsigned symbol_bits, unsigned symbol, bool dark=true); // == average_hash(getTile(...)), but precomputed
 }
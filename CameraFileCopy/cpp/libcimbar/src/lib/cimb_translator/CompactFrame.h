@@ -0,0 +1,19 @@
+/* This code is subject to the terms of the Mozilla Public License, v.2.0. http://mozilla.org/MPL/2.0/. */
+#pragma once
+
+#include "GridConf.h"
+
+#include <cstdint>
+#include <vector>
+
+// an encoded frame, before it's drawn: one tile index per cell, in CellPositions order.
+// ~12KB, vs ~3MB for the rendered image. See FrameRasterizer.
+struct CompactFrame
+{
+	std::vector<uint8_t> cells;
+	unsigned symbol_bits = 0;
+	unsigned color_bits = 0;
+	bool dark = true;
+	unsigned color_mode = 1;
+	const cimbar::GridSpec* grid = nullptr; // nullptr == Config::grid()
+};
@@ -3,14 +3,84 @@
 
 #include "GridConf.h"
 
+#include <atomic>
+#include <initializer_list>
+#include <string>
+#include <utility>
+
 namespace cimbar
 {
 	class Config
 	{
-	protected:
-		using GridConf = Conf8x8;
-
 	public:
+		// the grid everyone on this thread is using right now.
+		// a Scope (if there is one) wins, then whatever set_grid() picked. The default is 8x8.
+		static const GridSpec& grid()
+		{
+			const GridSpec* spec = _threadGrid;
+			return spec? *spec : *_grid.load(std::memory_order_relaxed);
+		}
+
+		// the process-wide default. Objects that care (Decoder, SimpleEncoder, ...) look at it when they're constructed.
+		static void set_grid(const GridSpec& spec)
+		{
+			_grid = &spec;
+		}
+
+		static bool set_grid(const std::string& name)
+		{
+			const GridSpec* spec = find_grid(name);
+			if (spec)
+				set_grid(*spec);
+			return spec;
+		}
+
+		static const GridSpec* find_grid(const std::string& name)
+		{
+			for (const GridSpec* spec : {&Grid8x8, &Grid5x5})
+				if (name == spec->name)
+					return spec;
+			return nullptr;
+		}
+
+		// override the grid for the current thread, until we go out of scope
+		class Scope
+		{
+		public:
+			Scope(const GridSpec& spec)
+				: _prev(_threadGrid)
+			{
+				_threadGrid = &spec;
+			}
+
+			~Scope()
+			{
+				_threadGrid = _prev;
+			}
+
+			Scope(const Scope&) = delete;
+			Scope& operator=(const Scope&) = delete;
+
+		protected:
+			const GridSpec* _prev;
+		};
+
+		// call fun(Conf8x8()) or fun(Conf5x5()), depending on grid().
+		// this is how the hot loops get their compile time cell sizes back.
+		template <typename FUN>
+		static decltype(auto) dispatch(FUN&& fun)
+		{
+			return dispatch(grid(), std::forward<FUN>(fun));
+		}
+
+		template <typename FUN>
+		static decltype(auto) dispatch(const GridSpec& spec, FUN&& fun)
+		{
+			if (spec.cell_size == Conf5x5::cell_size)
+				return fun(Conf5x5());
+			return fun(Conf8x8());
+		}
+
 		static constexpr bool dark()
 		{
 			return true;
@@ -21,34 +91,34 @@ namespace cimbar
 			return 1; // unless we override per-thread?
 		}
 
-		static constexpr unsigned color_bits()
+		static unsigned color_bits()
 		{
-			return GridConf::color_bits;
+			return grid().color_bits;
 		}
 
-		static constexpr unsigned symbol_bits()
+		static unsigned symbol_bits()
 		{
-			return GridConf::symbol_bits;
+			return grid().symbol_bits;
 		}
 
-		static constexpr unsigned bits_per_cell()
+		static unsigned bits_per_cell()
 		{
 			return color_bits() + symbol_bits();
 		}
 
-		static constexpr unsigned ecc_bytes()
+		static unsigned ecc_bytes()
 		{
-			return GridConf::ecc_bytes;
+			return grid().ecc_bytes;
 		}
 
-		static constexpr unsigned ecc_block_size()
+		static unsigned ecc_block_size()
 		{
-			return GridConf::ecc_block_size;
+			return grid().ecc_block_size;
 		}
 
-		static constexpr int image_size()
+		static int image_size()
 		{
-			return GridConf::image_size;
+			return grid().image_size;
 		}
 
 		static constexpr unsigned anchor_size()
@@ -56,26 +126,26 @@ namespace cimbar
 			return 30;
 		}
 
-		static constexpr unsigned cell_size()
+		static unsigned cell_size()
 		{
-			return GridConf::cell_size;
+			return grid().cell_size;
 		}
 
-		static constexpr unsigned cell_spacing()
+		static unsigned cell_spacing()
 		{
 			return cell_size() + 1;
 		}
 
 		static unsigned corner_padding();
 
-		static constexpr unsigned cell_offset()
+		static unsigned cell_offset()
 		{
-			return GridConf::cell_offset;
+			return grid().cell_offset;
 		}
 
-		static constexpr unsigned cells_per_col()
+		static unsigned cells_per_col()
 		{
-			return GridConf::cells_per_col;
+			return grid().cells_per_col;
 		}
 
 		static unsigned total_cells();
@@ -84,7 +154,7 @@ namespace cimbar
 
 		static unsigned capacity(unsigned bitspercell=0);
 
-		static constexpr unsigned interleave_blocks()
+		static unsigned interleave_blocks()
 		{
 			return ecc_block_size();
 		}
@@ -105,6 +175,10 @@ namespace cimbar
 		{
 			return 16;
 		}
+
+	protected:
+		inline static std::atomic<const GridSpec*> _grid{&Grid8x8};
+		inline static thread_local const GridSpec* _threadGrid = nullptr;
 	};
 }
 
@@ -0,0 +1,158 @@
+/* This code is subject to the terms of the Mozilla Public License, v.2.0. http://mozilla.org/MPL/2.0/. */
+#pragma once
+
+#include "AdjacentCellFinder.h"
+#include "CellPositions.h"
+#include "Config.h"
+#include "Interleave.h"
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <vector>
+
+// everything about the cell grid that only depends on the configuration: where the cells are, who their neighbors are,
+// and how the interleave shuffles them. Built once per configuration, shared (read only) by every reader/decoder/thread.
+// cell counts fit in 16 bits for every grid we support, so we keep the tables small.
+class DecodeGeometry
+{
+public:
+	static constexpr uint16_t NONE = 0xFFFF;
+
+	static std::shared_ptr<const DecodeGeometry> get(unsigned interleave_blocks=cimbar::Config::interleave_blocks(), unsigned interleave_partitions=cimbar::Config::interleave_partitions());
+	static std::shared_ptr<const DecodeGeometry> get(int spacing, int dimensions, int offset, int marker_size, unsigned interleave_blocks=0, unsigned interleave_partitions=1);
+
+public:
+	DecodeGeometry(int spacing, int dimensions, int offset, int marker_size, unsigned interleave_blocks, unsigned interleave_partitions);
+
+	unsigned size() const;
+	int dimensions() const;
+	int marker_size() const;
+
+	CellPositions::coordinate position(unsigned cell) const;
+
+	// right, left, bottom, top. NONE if we're at an edge.
+	const std::array<uint16_t, 4>& adjacent(unsigned cell) const;
+	uint16_t right(unsigned cell) const;
+	uint16_t left(unsigned cell) const;
+	uint16_t bottom(unsigned cell) const;
+	uint16_t top(unsigned cell) const;
+
+	// interleaved slot -> cell, and cell -> interleaved slot
+	uint16_t interleave(unsigned slot) const;
+	const std::vector<uint16_t>& interleave_reverse() const;
+
+protected:
+	int _dimensions;
+	int _markerSize;
+
+	std::vector<uint16_t> _x;
+	std::vector<uint16_t> _y;
+	std::vector<std::array<uint16_t, 4>> _adjacent;
+	std::vector<uint16_t> _interleave;
+	std::vector<uint16_t> _interleaveReverse;
+};
+
+inline std::shared_ptr<const DecodeGeometry> DecodeGeometry::get(unsigned interleave_blocks, unsigned interleave_partitions)
+{
+	using cimbar::Config;
+	return get(Config::cell_spacing(), Config::cells_per_col(), Config::cell_offset(), Config::corner_padding(), interleave_blocks, interleave_partitions);
+}
+
+inline std::shared_ptr<const DecodeGeometry> DecodeGeometry::get(int spacing, int dimensions, int offset, int marker_size, unsigned interleave_blocks, unsigned interleave_partitions)
+{
+	static std::mutex mutex;
+	static std::map<std::tuple<int, int, int, int, unsigned, unsigned>, std::shared_ptr<const DecodeGeometry>> cache;
+
+	std::lock_guard<std::mutex> lock(mutex);
+	std::shared_ptr<const DecodeGeometry>& geo = cache[{spacing, dimensions, offset, marker_size, interleave_blocks, interleave_partitions}];
+	if (!geo)
+		geo = std::make_shared<const DecodeGeometry>(spacing, dimensions, offset, marker_size, interleave_blocks, interleave_partitions);
+	return geo;
+}
+
+inline DecodeGeometry::DecodeGeometry(int spacing, int dimensions, int offset, int marker_size, unsigned interleave_blocks, unsigned interleave_partitions)
+	: _dimensions(dimensions)
+	, _markerSize(marker_size)
+{
+	CellPositions::positions_list positions = CellPositions::compute(spacing, dimensions, offset, marker_size, 0);
+	AdjacentCellFinder finder(positions, dimensions, marker_size);
+
+	auto compact = [](int idx) { return idx < 0? NONE : static_cast<uint16_t>(idx); };
+
+	_x.reserve(positions.size());
+	_y.reserve(positions.size());
+	_adjacent.reserve(positions.size());
+	for (unsigned i = 0; i < positions.size(); ++i)
+	{
+		_x.push_back(positions[i].first);
+		_y.push_back(positions[i].second);
+
+		std::array<int, 4> adj = finder.find(i);
+		_adjacent.push_back({compact(adj[0]), compact(adj[1]), compact(adj[2]), compact(adj[3])});
+	}
+
+	std::vector<unsigned> indices = Interleave::interleave_indices(positions.size(), interleave_blocks, interleave_partitions);
+	_interleave.assign(indices.begin(), indices.end());
+	_interleaveReverse.resize(positions.size(), 0);
+	for (unsigned slot = 0; slot < _interleave.size(); ++slot)
+		_interleaveReverse[_interleave[slot]] = slot;
+}
+
+inline unsigned DecodeGeometry::size() const
+{
+	return _x.size();
+}
+
+inline int DecodeGeometry::dimensions() const
+{
+	return _dimensions;
+}
+
+inline int DecodeGeometry::marker_size() const
+{
+	return _markerSize;
+}
+
+inline CellPositions::coordinate DecodeGeometry::position(unsigned cell) const
+{
+	return {_x[cell], _y[cell]};
+}
+
+inline const std::array<uint16_t, 4>& DecodeGeometry::adjacent(unsigned cell) const
+{
+	return _adjacent[cell];
+}
+
+inline uint16_t DecodeGeometry::right(unsigned cell) const
+{
+	return _adjacent[cell][0];
+}
+
+inline uint16_t DecodeGeometry::left(unsigned cell) const
+{
+	return _adjacent[cell][1];
+}
+
+inline uint16_t DecodeGeometry::bottom(unsigned cell) const
+{
+	return _adjacent[cell][2];
+}
+
+inline uint16_t DecodeGeometry::top(unsigned cell) const
+{
+	return _adjacent[cell][3];
+}
+
+inline uint16_t DecodeGeometry::interleave(unsigned slot) const
+{
+	return _interleave[slot];
+}
+
+inline const std::vector<uint16_t>& DecodeGeometry::interleave_reverse() const
+{
+	return _interleaveReverse;
+}
@@ -1,44 +1,49 @@
 /* This code is subject to the terms of the Mozilla Public License, v.2.0. http://mozilla.org/MPL/2.0/. */
 #include "FloodDecodePositions.h"
-#include <iostream>
 
 FloodDecodePositions::FloodDecodePositions(int spacing, int dimensions, int offset, int marker_size)
-	: _positions(CellPositions::compute(spacing, dimensions, offset, marker_size, 0))
-	, _cellFinder(_positions, dimensions, marker_size)
+	: FloodDecodePositions(DecodeGeometry::get(spacing, dimensions, offset, marker_size))
+{
+}
+
+FloodDecodePositions::FloodDecodePositions(std::shared_ptr<const DecodeGeometry> geometry)
+	: _geometry(std::move(geometry))
 {
 	reset();
 }
 
 size_t FloodDecodePositions::size() const
 {
-	return _positions.size();
+	return _geometry->size();
 }
 
 void FloodDecodePositions::reset()
 {
 	_index = 0;
 	_count = 0;
-	_remaining.clear();
-	for (unsigned i = 0; i < _positions.size(); ++i)
-	{
-		_remaining.push_back(true);
-		_instructions.push_back({CellDrift(), 0xFE, 0xFE});
-	}
+	_cells.assign(size(), {CellDrift(), 0xFE, 0xFE, true});
+	_heap.clear();
 
 	// seed
-	uint16_t smallRowLen = _cellFinder.dimensions() - (2*_cellFinder.marker_size());
-	uint16_t lastElem = _positions.size()-1;
-	_heap.push({0, 0});
-	_heap.push({smallRowLen-1, 0});
-	_heap.push({lastElem, 0});
-	_heap.push({lastElem-(smallRowLen-1), 0});
+	uint16_t smallRowLen = _geometry->dimensions() - (2*_geometry->marker_size());
+	uint16_t lastElem = size()-1;
+	push(0, 0);
+	push(smallRowLen-1, 0);
+	push(lastElem, 0);
+	push(lastElem-(smallRowLen-1), 0);
 
 	// add more seed corners?
-	uint16_t betweenMarkerBlock = smallRowLen * _cellFinder.marker_size();
-	_heap.push({betweenMarkerBlock, 1});
-	_heap.push({betweenMarkerBlock+_cellFinder.dimensions()-1, 1});
-	_heap.push({lastElem-betweenMarkerBlock, 1});
-	_heap.push({lastElem-(betweenMarkerBlock+_cellFinder.dimensions()-1), 1});
+	uint16_t betweenMarkerBlock = smallRowLen * _geometry->marker_size();
+	push(betweenMarkerBlock, 1);
+	push(betweenMarkerBlock+_geometry->dimensions()-1, 1);
+	push(lastElem-betweenMarkerBlock, 1);
+	push(lastElem-(betweenMarkerBlock+_geometry->dimensions()-1), 1);
+}
+
+void FloodDecodePositions::push(uint16_t index, uint8_t prio)
+{
+	_heap.push_back({index, prio});
+	std::push_heap(_heap.begin(), _heap.end(), PrioCompare());
 }
 
 bool FloodDecodePositions::done() const
@@ -50,33 +55,36 @@ FloodDecodePositions::iter FloodDecodePositions::next()
 {
 	while (!_heap.empty())
 	{
-		auto [i, _] = _heap.top();
-		_heap.pop();
+		std::pop_heap(_heap.begin(), _heap.end(), PrioCompare());
+		uint16_t i = _heap.back().index;
+		_heap.pop_back();
 
-		std::vector<bool>::reference needsDecode = _remaining[i];
-		if (!needsDecode)
+		cell_state& cell = _cells[i];
+		if (!cell.remaining)
 			continue;
 
-		needsDecode = false;
+		cell.remaining = false;
 		++_count;
-		auto [drift, __, cooldown] = _instructions[i];
-		return {i, _positions[i], drift, cooldown};
+		return {i, _geometry->position(i), cell.drift, cell.cooldown};
 	}
 
 	return {0, {0, 0}, CellDrift(), 0xFF};
 }
 
-int FloodDecodePositions::update_adjacents(const std::array<int,4>& adj, const CellDrift& drift, unsigned error_distance, uint8_t cooldown)
+int FloodDecodePositions::update_adjacents(const std::array<uint16_t,4>& adj, const CellDrift& drift, unsigned error_distance, uint8_t cooldown)
 {
-	for (int next : adj)
+	for (uint16_t next : adj)
 	{
-		if (next < 0 or !_remaining[next])
+		if (next == DecodeGeometry::NONE)
 			continue;
-		decode_instructions& di = _instructions[next];
-		if (std::get<1>(di) <= error_distance)
+		cell_state& cell = _cells[next];
+		if (!cell.remaining or cell.best_prio <= error_distance)
 			continue;
-		di = {drift, error_distance, cooldown};
-		_heap.push({next, error_distance});
+
+		cell.drift = drift;
+		cell.best_prio = error_distance;
+		cell.cooldown = cooldown;
+		push(next, error_distance);
 	}
 
 	return 0;
@@ -84,10 +92,11 @@ int FloodDecodePositions::update_adjacents(const std::array<int,4>& adj, const C
 
 int FloodDecodePositions::update(unsigned index, const CellDrift& drift, unsigned error_distance, uint8_t cooldown)
 {
-	std::array<int,4> adj = _cellFinder.find(index);
+	const std::array<uint16_t,4>& adj = _geometry->adjacent(index);
 	update_adjacents(adj, drift, error_distance, cooldown);
 
-	auto& [_, prev_error, prev_cooldown] = _instructions[index];
+	uint8_t& prev_error = _cells[index].best_prio;
+	uint8_t& prev_cooldown = _cells[index].cooldown;
 	// in the case where we have consecutive high confidence cells with no drift changes,
 	// it's safe(ish) to aggressively queue a few more cells
 	if (prev_error < 3 and error_distance < 3 and prev_cooldown == 4 and cooldown == 4)
@@ -97,32 +106,32 @@ int FloodDecodePositions::update(unsigned index, const CellDrift& drift, unsigne
 		unsigned dd = 2;
 		unsigned uu = 3;
 
-		int rridx = adj[rr];
-		int llidx = adj[ll];
-		if (rridx >= 0 and llidx >= 0)
+		uint16_t rridx = adj[rr];
+		uint16_t llidx = adj[ll];
+		if (rridx != DecodeGeometry::NONE and llidx != DecodeGeometry::NONE)
 		{
-			std::array<int,4> horizon = {-1, -1, -1, -1};
-			horizon[0] = _cellFinder.right(rridx);
-			if (horizon[0] >= 0)
-				horizon[1] = _cellFinder.right(horizon[0]);
-			horizon[2] = _cellFinder.left(llidx);
-			if (horizon[2] >= 0)
-				horizon[3] = _cellFinder.left(horizon[2]);
+			std::array<uint16_t,4> horizon = {DecodeGeometry::NONE, DecodeGeometry::NONE, DecodeGeometry::NONE, DecodeGeometry::NONE};
+			horizon[0] = _geometry->right(rridx);
+			if (horizon[0] != DecodeGeometry::NONE)
+				horizon[1] = _geometry->right(horizon[0]);
+			horizon[2] = _geometry->left(llidx);
+			if (horizon[2] != DecodeGeometry::NONE)
+				horizon[3] = _geometry->left(horizon[2]);
 
 			update_adjacents(horizon, drift, error_distance, cooldown);
 		}
 
-		int uuidx = adj[uu];
-		int ddidx = adj[dd];
-		if (uuidx >= 0 and ddidx >= 0)
+		uint16_t uuidx = adj[uu];
+		uint16_t ddidx = adj[dd];
+		if (uuidx != DecodeGeometry::NONE and ddidx != DecodeGeometry::NONE)
 		{
-			std::array<int,4> vert = {-1, -1, -1, -1};
-			vert[0] = _cellFinder.top(uuidx);
-			if (vert[0] >= 0)
-				vert[1] = _cellFinder.top(vert[0]);
-			vert[2] = _cellFinder.bottom(ddidx);
-			if (vert[2] >= 0)
-				vert[3] = _cellFinder.bottom(vert[2]);
+			std::array<uint16_t,4> vert = {DecodeGeometry::NONE, DecodeGeometry::NONE, DecodeGeometry::NONE, DecodeGeometry::NONE};
+			vert[0] = _geometry->top(uuidx);
+			if (vert[0] != DecodeGeometry::NONE)
+				vert[1] = _geometry->top(vert[0]);
+			vert[2] = _geometry->bottom(ddidx);
+			if (vert[2] != DecodeGeometry::NONE)
+				vert[3] = _geometry->bottom(vert[2]);
 
 			update_adjacents(vert, drift, error_distance, cooldown);
 		}
@@ -133,7 +142,7 @@ int FloodDecodePositions::update(unsigned index, const CellDrift& drift, unsigne
 	return 0;
 }
 
-const CellPositions::positions_list& FloodDecodePositions::positions() const
+const DecodeGeometry& FloodDecodePositions::geometry() const
 {
-	return _positions;
+	return *_geometry;
 }
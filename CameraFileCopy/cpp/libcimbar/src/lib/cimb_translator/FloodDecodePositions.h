@@ -1,34 +1,48 @@
 /* This code is subject to the terms of the Mozilla Public License, v.2.0. http://mozilla.org/MPL/2.0/. */
 #pragma once
 
-#include "AdjacentCellFinder.h"
 #include "CellDrift.h"
 #include "CellPositions.h"
+#include "DecodeGeometry.h"
+#include <algorithm>
+#include <array>
 #include <cstdint>
-#include <queue>
-#include <set>
+#include <memory>
 #include <tuple>
+#include <vector>
 
 class FloodDecodePositions
 {
 public:
 	using iter = std::tuple<unsigned, CellPositions::coordinate, CellDrift, uint8_t>;
-	// compress these types down to reduce size and cache pressure?
-	// i.e. with a struct ...
-	using decode_instructions = std::tuple<CellDrift, uint8_t, uint8_t>; // drift, best_prio, cooldown_pos
-	using decode_prio = std::tuple<uint16_t, uint8_t>; // index, prio
+
+	// everything we know about a cell, in one place
+	struct cell_state
+	{
+		CellDrift drift;
+		uint8_t best_prio;
+		uint8_t cooldown;
+		bool remaining;
+	};
+
+	struct decode_prio
+	{
+		uint16_t index;
+		uint8_t prio;
+	};
 
 	class PrioCompare
 	{
 	public:
 		bool operator()(const decode_prio& a, const decode_prio& b) const
 		{
-			return std::get<1>(a) > std::get<1>(b);
+			return a.prio > b.prio;
 		}
 	};
 
 public:
 	FloodDecodePositions(int spacing, int dimensions, int offset, int marker_size);
+	FloodDecodePositions(std::shared_ptr<const DecodeGeometry> geometry);
 
 	size_t size() const;
 	void reset();
@@ -37,18 +51,21 @@ public:
 	iter next();
 	int update(unsigned index, const CellDrift& drift, unsigned error_distance, uint8_t cooldown);
 
-	const CellPositions::positions_list& positions() const;
+	const DecodeGeometry& geometry() const;
 
 protected:
-	int update_adjacents(const std::array<int,4>& adj, const CellDrift& drift, unsigned error_distance, uint8_t cooldown);
+	void push(uint16_t index, uint8_t prio);
+	int update_adjacents(const std::array<uint16_t,4>& adj, const CellDrift& drift, unsigned error_distance, uint8_t cooldown);
 
 protected:
 	unsigned _index;
 	unsigned _count;
-	std::priority_queue<decode_prio, std::vector<decode_prio>, PrioCompare> _heap;
-	std::vector<bool> _remaining;
-	std::vector<decode_instructions> _instructions;
-	CellPositions::positions_list _positions;
-	AdjacentCellFinder _cellFinder;
-};
 
+	// a std::priority_queue, but one we can clear() without giving back the memory.
+	// a cell that gets a better score is pushed again, and the stale entry is skipped when it comes up.
+	// the decode depends on the visit order, ties included -- so if this changes, check it against test/legacy_flood_decode_positions.h
+	std::vector<decode_prio> _heap;
+	std::vector<cell_state> _cells;
+
+	std::shared_ptr<const DecodeGeometry> _geometry;
+};
@@ -0,0 +1,96 @@
+/* This code is subject to the terms of the Mozilla Public License, v.2.0. http://mozilla.org/MPL/2.0/. */
+#pragma once
+
+#include "CellPositions.h"
+#include "CimbWriter.h"
+#include "CompactFrame.h"
+#include "Config.h"
+#include "TileAtlas.h"
+
+#include <opencv2/opencv.hpp>
+#include <cstdint>
+#include <cstring>
+
+// turns a CompactFrame into pixels -- either a new cv::Mat, or straight into an existing buffer (e.g. a texture upload).
+class FrameRasterizer
+{
+public:
+	// RGB, centered on a canvas_size x canvas_size image. Same thing SimpleEncoder::encode_next() gives you.
+	static cv::Mat rasterize(const CompactFrame& frame, int canvas_size=0);
+
+	// channels == 3 for RGB, 4 for RGBA. The frame is drawn with its top left corner at (x,y),
+	// and has to fit -- anything outside of it is left alone.
+	static bool rasterize(const CompactFrame& frame, uint8_t* dst, unsigned width, unsigned height, size_t stride, unsigned channels=3, int x=0, int y=0);
+
+protected:
+	static const CellPositions::positions_list& positions();
+
+	template <unsigned CHANNELS>
+	static void copy_pixels(const uint8_t* src, uint8_t* dst, unsigned count);
+};
+
+inline cv::Mat FrameRasterizer::rasterize(const CompactFrame& frame, int canvas_size)
+{
+	cimbar::Config::Scope scope(frame.grid? *frame.grid : cimbar::Config::grid());
+	CimbWriter writer(frame.symbol_bits, frame.color_bits, frame.dark, frame.color_mode, canvas_size);
+	writer.write(frame.cells.data(), frame.cells.size());
+	return writer.image();
+}
+
+inline bool FrameRasterizer::rasterize(const CompactFrame& frame, uint8_t* dst, unsigned width, unsigned height, size_t stride, unsigned channels, int x, int y)
+{
+	cimbar::Config::Scope scope(frame.grid? *frame.grid : cimbar::Config::grid());
+	const int size = cimbar::Config::image_size();
+	if (channels < 3 or channels > 4 or x < 0 or y < 0 or x + size > (int)width or y + size > (int)height)
+		return false;
+
+	auto copy = (channels == 3)? &copy_pixels<3> : &copy_pixels<4>;
+	uint8_t* origin = dst + y*stride + x*channels;
+
+	// the static parts
+	const cv::Mat& tmpl = TileAtlas::frame_template(frame.dark, size);
+	for (int row = 0; row < size; ++row)
+		copy(tmpl.ptr<uint8_t>(row), origin + row*stride, size);
+
+	// the cells
+	std::shared_ptr<const TileAtlas> atlas = TileAtlas::get(frame.symbol_bits, frame.color_bits, frame.dark, frame.color_mode);
+	const CellPositions::positions_list& pos = positions();
+	unsigned count = std::min(frame.cells.size(), pos.size());
+	for (unsigned i = 0; i < count; ++i)
+	{
+		const cv::Mat& tile = atlas->tile(frame.cells[i]);
+		uint8_t* cell = origin + pos[i].second*stride + pos[i].first*channels;
+		for (int row = 0; row < tile.rows; ++row)
+			copy(tile.ptr<uint8_t>(row), cell + row*stride, tile.cols);
+	}
+	return true;
+}
+
+inline const CellPositions::positions_list& FrameRasterizer::positions()
+{
+	using cimbar::Config;
+	// one list per grid -- each instantiation of the lambda gets its own static
+	return Config::dispatch([](auto) -> const CellPositions::positions_list& {
+		static const CellPositions::positions_list pos = CellPositions::compute(
+			Config::cell_spacing(), Config::cells_per_col(), Config::cell_offset(), Config::corner_padding(), Config::interleave_blocks(), Config::interleave_partitions()
+		);
+		return pos;
+	});
+}
+
+template <unsigned CHANNELS>
+inline void FrameRasterizer::copy_pixels(const uint8_t* src, uint8_t* dst, unsigned count)
+{
+	if constexpr (CHANNELS == 3)
+		std::memcpy(dst, src, count*3);
+	else
+	{
+		for (unsigned i = 0; i < count; ++i, src+=3, dst+=4)
+		{
+			dst[0] = src[0];
+			dst[1] = src[1];
+			dst[2] = src[2];
+			dst[3] = 0xFF;
+		}
+	}
+}
@@ -5,6 +5,7 @@ namespace cimbar
 {
 	struct Conf5x5
 	{
+		static constexpr const char* name = "5x5";
 		static constexpr unsigned color_bits = 2;
 		static constexpr unsigned symbol_bits = 2;
 		static constexpr unsigned ecc_bytes = 40;
@@ -18,6 +19,7 @@ namespace cimbar
 
 	struct Conf8x8
 	{
+		static constexpr const char* name = "8x8";
 		static constexpr unsigned color_bits = 2;
 		static constexpr unsigned symbol_bits = 4;
 		static constexpr unsigned ecc_bytes = 30;
@@ -28,4 +30,30 @@ namespace cimbar
 		static constexpr unsigned cell_offset = 8;
 		static constexpr unsigned cells_per_col = 112;
 	};
+
+	// the same numbers, as a value -- so we can pick one at runtime.
+	// the hot paths still want the compile time version: see Config::dispatch()
+	struct GridSpec
+	{
+		const char* name;
+		unsigned color_bits;
+		unsigned symbol_bits;
+		unsigned ecc_bytes;
+		unsigned ecc_block_size;
+		int image_size;
+
+		unsigned cell_size;
+		unsigned cell_offset;
+		unsigned cells_per_col;
+
+		template <typename CONF>
+		static constexpr GridSpec of()
+		{
+			return {CONF::name, CONF::color_bits, CONF::symbol_bits, CONF::ecc_bytes, CONF::ecc_block_size, CONF::image_size,
+					CONF::cell_size, CONF::cell_offset, CONF::cells_per_col};
+		}
+	};
+
+	inline constexpr GridSpec Grid8x8 = GridSpec::of<Conf8x8>();
+	inline constexpr GridSpec Grid5x5 = GridSpec::of<Conf5x5>();
 }
@@ -0,0 +1,135 @@
+/* This code is subject to the terms of the Mozilla Public License, v.2.0. http://mozilla.org/MPL/2.0/. */
+#pragma once
+
+#include "Common.h"
+#include "Config.h"
+#include "serialize/format.h"
+#include <opencv2/opencv.hpp>
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <vector>
+
+// every (colored) tile for one encoder configuration, loaded once per process and shared.
+// the cv::Mats are shared too -- treat them as read only.
+class TileAtlas
+{
+public:
+	static std::shared_ptr<const TileAtlas> get(unsigned symbol_bits, unsigned color_bits, bool dark=true, unsigned color_mode=1);
+
+	// the anchors + guides on a blank background. Also shared, also read only.
+	static const cv::Mat& frame_template(bool dark, int size);
+
+public:
+	TileAtlas(unsigned symbol_bits, unsigned color_bits, bool dark=true, unsigned color_mode=1);
+
+	const cv::Mat& tile(unsigned bits) const;
+	unsigned size() const;
+
+protected:
+	static cv::Mat load_marker(std::string name, bool dark);
+	static cv::Mat build_template(bool dark, int size);
+
+protected:
+	std::vector<cv::Mat> _tiles;
+};
+
+inline std::shared_ptr<const TileAtlas> TileAtlas::get(unsigned symbol_bits, unsigned color_bits, bool dark, unsigned color_mode)
+{
+	static std::mutex mutex;
+	static std::map<std::tuple<unsigned, unsigned, bool, unsigned>, std::shared_ptr<const TileAtlas>> cache;
+
+	std::lock_guard<std::mutex> lock(mutex);
+	std::shared_ptr<const TileAtlas>& atlas = cache[{symbol_bits, color_bits, dark, color_mode}];
+	if (!atlas)
+		atlas = std::make_shared<const TileAtlas>(symbol_bits, color_bits, dark, color_mode);
+	return atlas;
+}
+
+inline const cv::Mat& TileAtlas::frame_template(bool dark, int size)
+{
+	if (size < cimbar::Config::image_size())
+		size = cimbar::Config::image_size();
+
+	// map references stay put, so handing them out is fine
+	static std::mutex mutex;
+	static std::map<std::tuple<bool, int, int>, cv::Mat> cache;
+
+	// the same canvas size can hold either grid
+	std::lock_guard<std::mutex> lock(mutex);
+	cv::Mat& img = cache[{dark, size, cimbar::Config::image_size()}];
+	if (img.empty())
+		img = build_template(dark, size);
+	return img;
+}
+
+inline TileAtlas::TileAtlas(unsigned symbol_bits, unsigned color_bits, bool dark, unsigned color_mode)
+{
+	unsigned numSymbols = 1 << symbol_bits;
+	unsigned numColors = 1 << color_bits;
+	unsigned numTiles = numColors * numSymbols;
+
+	_tiles.reserve(numTiles);
+	for (unsigned i = 0; i < numTiles; ++i)
+	{
+		unsigned symbol = i % numSymbols;
+		unsigned color = i / numSymbols;
+		_tiles.push_back(cimbar::getTile(symbol_bits, symbol, dark, numColors, color, color_mode));
+	}
+}
+
+inline const cv::Mat& TileAtlas::tile(unsigned bits) const
+{
+	return _tiles[bits % _tiles.size()];
+}
+
+inline unsigned TileAtlas::size() const
+{
+	return _tiles.size();
+}
+
+inline cv::Mat TileAtlas::load_marker(std::string name, bool dark)
+{
+	return cimbar::load_img(fmt::format("bitmap/{}-{}.png", name, dark? "dark" : "light"));
+}
+
+inline cv::Mat TileAtlas::build_template(bool dark, int size)
+{
+	int offset = 0;
+	if (size > cimbar::Config::image_size())
+		offset = (size - cimbar::Config::image_size()) / 2;
+	else
+		size = cimbar::Config::image_size();
+
+	cv::Scalar bgcolor = dark? cv::Scalar(0, 0, 0) : cv::Scalar(0xFF, 0xFF, 0xFF);
+	cv::Mat image(size, size, CV_8UC3, bgcolor);
+
+	auto paste = [&image, offset](const cv::Mat& img, int x, int y) {
+		img.copyTo(image(cv::Rect(x+offset, y+offset, img.cols, img.rows)));
+	};
+
+	// from here on, we only care about the internal size
+	size = cimbar::Config::image_size();
+
+	cv::Mat anchor = load_marker("anchor", dark);
+	paste(anchor, 0, 0);
+	paste(anchor, 0, size - anchor.cols);
+	paste(anchor, size - anchor.rows, 0);
+
+	cv::Mat secondaryAnchor = load_marker("anchor-secondary", dark);
+	paste(secondaryAnchor, size - anchor.rows, size - anchor.cols);
+
+	cv::Mat hg = load_marker("guide-horizontal", dark);
+	paste(hg, (size/2) - (hg.cols/2), 2);
+	paste(hg, (size/2) - (hg.cols/2), size-4);
+	paste(hg, (size/2) - (hg.cols/2) - hg.cols, size-4);
+	paste(hg, (size/2) - (hg.cols/2) + hg.cols, size-4);
+
+	cv::Mat vg = load_marker("guide-vertical", dark);
+	paste(vg, 2, (size/2) - (vg.rows/2));
+	paste(vg, size-4, (size/2) - (vg.rows/2));
+	return image;
+}
@@ -1,32 +1,292 @@
+/* This code is subject to the terms of the Mozilla Public License, v.2.0. http://mozilla.org/MPL/2.0/. */
+/* generated by build_image_assets. Don't edit by hand! */
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+
 namespace cimbar {
-static const std::map<std::string, std::string> bitmaps = {
-{"bitmap/2/200.png", R"(vuk:eJs4+BAAN/-MCG4DAADHAABtZLYAAANJTkaoAA6y#TzjGFAA$FDAqCsCco~EbAAA'yCG@v_CLK;IA'B'1'1(-o5}s%9~(gEzXCg/0(KC{QC'0;XE/9/#iBAAC'nHpwZ9)'&F)"},
-{"bitmap/2/201.png", R"(vuk:eJs4+BAAN/-MCG4DAADHAABtZLYAAANJTkaoAA6y#TzjGFAA$FDAqCsCco~EbAAAPzCG@v_CLK;IA'B'tWPcq1,(KC{Qw2t/_(Tj'hDTV)kAJ1[Mk)_SvlLAAAdZJzDwHP_Q%)"},
-{"bitmap/2/202.png", R"(vuk:eJs4+BAAN/-MCG4DAADHAABtZLYAAANJTkaoAA6y#TzjGFAA$FDAqCsCco~EbAAAvzCG@v_CLK;IA'B'1'1(YEGRxt(a[hFBQ/_(sI$~Ybu+SAY4$`FBn``[CAAAXLhYKMe8#(\C)"},
-{"bitmap/2/203.png", R"(vuk:eJs4+BAAN/-MCG4DAADHAABtZLYAAANJTkaoAA6y#TzjGFAA$FDAqCsCco~EbAAAfzCG@v_CY^So5JAAU)ai%|tW(8Xj^zH9_t(C$1XUh'(C~tC[}hv2Q?=BAAAAr7vbMo\F9BB)"},
-{"bitmap/4/00.png", R"(vuk:eJs4+BAAN/-MCG4DAAXLAAAA7FMAAA_)z_ZMAAdZ=J.!wCC'\vBAVBWBP%tvNAAA&aCw`XaxEylEB'B'atItc|3|y|UAp!E8e+_GyD?^VR_3wcW'Qh#GAaztVEMA`*8DBfF/k8AAAA9ZNoBz[uhNI)"},
-{"bitmap/4/01.png", R"(vuk:eJs4+BAAN/-MCG4DAAXLAAAA7FMAAA_)z_ZMAAdZ=J.!wCC'\vBAVBWBP%tvNAAA]aCw`Xax=HOU:EBtV)%tL-IV&7RD,W?p/]fZO-8B$}Fhjf%GC}~Y8(/Y$w|t^oN/ZNiN0s}\5AAAuW&wUY6eit&F)"},
-{"bitmap/4/02.png", R"(vuk:eJs4+BAAN/-MCG4DAAXLAAAA7FMAAA_)z_ZMAAdZ=J.!wCC'\vBAVBWBP%tvNAAA]aCw`Xax4{NUBFBt&t%tk`B'H{1N6k{N,,B$ho#%7F'Su&HLs]iDkfwcgZSGR501W0WE+WxodAAAuW&wUY6eit&F)"},
-{"bitmap/4/03.png", R"(vuk:eJs4+BAAN/-MCG4DAAXLAAAA7FMAAA_)z_ZMAAdZ=J.!wCC'\vBAVBWBP%tvNAAA'aCw`Xax4{NUWGC'Ki?($[.Vk~Mw/(Vi|NaT&N6S!Z/oaW/o\9F-6}_UbXy:pB}A{4/A0(]PciAAAA_cE3Y@%LfDC)"},
-{"bitmap/4/04.png", R"(vuk:eJs4+BAAN/-MCG4DAAXLAAAA7FMAAA_)z_ZMAAdZ=J.!wCC'\vBAVBWBP%tvNAAAaaCw`XaxEy\~B'B'zA:hI0mgUE[h!G=C5F_AzIpYu+eM:GP^t/AyEA6}cu6:4fVWAAAA=5GUv+oX!GE)"},
-{"bitmap/4/05.png", R"(vuk:eJs4+BAAN/-MCG4DAAXLAAAA7FMAAA_)z_ZMAAdZ=J.!wCC'\vBAVBWBP%tvNAAA3bCw`XaxJTvR3DC'ai\!!~?Q/K&u:Ihr=k[CmZ^tc74&_pS16y?}w(e2A(kb_Ug0kId-N)|2Pjb$6Cq@`8NAAA6yQMFGPe=hnB)"},
-{"bitmap/4/06.png", R"(vuk:eJs4+BAAN/-MCG4DAAXLAAAA7FMAAA_)z_ZMAAdZ=J.!wCC'\vBAVBWBP%tvNAAA#bCw`Xax=HvR'EC'DX)_A'MJe7fGx+xz9fO!vadv&):zQ*Wy/[.@mw%,DZK?]yTayU_=[o;%oNaMmC?`6^2yAAAA=5GUv+oX!GE)"},
-{"bitmap/4/07.png", R"(vuk:eJs4+BAAN/-MCG4DAAXLAAAA7FMAAA_)z_ZMAAdZ=J.!wCC'\vBAVBWBP%tvNAAAHbCw`Xax=HnR'EAA?W=['~ZSw*NReO=a7#Y$)DW=%MX]VJschDxl0)eGxlG{4#2S4M1X#ydhP]kEAAAA?O@GxgqB_W)"},
-{"bitmap/4/08.png", R"(vuk:eJs4+BAAN/-MCG4DAAXLAAAA7FMAAA_)z_ZMAAdZ=J.!wCC'\vBAVBWBP%tvNAAAPbCw`XaxEylEB'B'.(KC!}MBbB`(CiHH*6.\lXB?\+bPNv3W2(,GVLaH%=hiRQ4(AAs8,UoY=&$BFAAAdZJzDwHP_Q%)"},
-{"bitmap/4/09.png", R"(vuk:eJs4+BAAN/-MCG4DAAXLAAAA7FMAAA_)z_ZMAAdZ=J.!wCC'\vBAVBWBP%tvNAAA'aCw`XaxEylEB'B'atIt*$._E%W'~?~tM[0tVEIMyq|9Pzs8Lv\hHH%mln=kbHBA3|duUVX5/8AAAA=5GUv+oX!GE)"},
-{"bitmap/4/0a.png", R"(vuk:eJs4+BAAN/-MCG4DAAXLAAAA7FMAAA_)z_ZMAAdZ=J.!wCC'\vBAVBWBP%tvNAAA]aCw`XaxEylEB'B'atIt+~.(KCtdiN$Ia67PQIl%XR%g;C#Bx?]AbN2eggTtBAo.rugwO$ofdAAA6yQMFGPe=hnB)"},
-{"bitmap/4/0b.png", R"(vuk:eJs4+BAAN/-MCG4DAAXLAAAA7FMAAA_)z_ZMAAdZ=J.!wCC'\vBAVBWBP%tvNAAAiaCw`XaxEylEB'B'b'x(CiJBDtdEEAR56}mz9~x2.\kD5yjG5y[B&C+\2PlZ001+&AAAC'nHpwZ9)'&F)"},
-{"bitmap/4/0c.png", R"(vuk:eJs4+BAAN/-MCG4DAAXLAAAA7FMAAA_)z_ZMAAdZ=J.!wCC'\vBAVBWBP%tvNAAAqaCw`XaxEylEB'B'X4};pI.(KCR?CKdt~QO*,=bP\WUtfdIw8DV/!y]B0k}0~Fok*2lAAAXLhYKMe8#(\C)"},
-{"bitmap/4/0d.png", R"(vuk:eJs4+BAAN/-MCG4DAAXLAAAA7FMAAA_)z_ZMAAdZ=J.!wCC'\vBAVBWBP%tvNAAAnbCw`Xax4{uR3DAA?WHb|~\jg1\Fw+ij&M[M.THhSA#;=+&1iDl3`vvOZik1@iRjSnl2eBlVXEE!^so1AAAA9ZNoBz[uhNI)"},
-{"bitmap/4/0e.png", R"(vuk:eJs4+BAAN/-MCG4DAAXLAAAA7FMAAA_)z_ZMAAdZ=J.!wCC'\vBAVBWBP%tvNAAAnbCw`XaxEy\~B'B'1'z(OO21/1Xbw+&a5N{~!eggL*zHiC!u\g`p=\o'7w6iS/bWrI,(AA,9:BMOC7XMAAAA=5GUv+oX!GE)"},
-{"bitmap/4/0f.png", R"(vuk:eJs4+BAAN/-MCG4DAAXLAAAA7FMAAA_)z_ZMAAdZ=J.!wCC'\vBAVBWBP%tvNAAA'aCw`XaxEy\~B'B'zA:hJB~(ZSxt(ajLv(AmX~8Z:GjDbP2!jRw2.\&JY.{N7NAA7*wB{2YGO7AAAA=5GUv+oX!GE)"},
-{"bitmap/anchor-dark.png", R"(vuk:eJs4+BAAN/-MCG4DAAk_AAAA.FMAAAkUJ/IKAAdZ=J.!wCC'\vBAVBWBP%tvNAAAskCw`Xg#A$mr2Dmu1X~4C*~sns0GV]=CYS#olfs)j'~4i8n5Rja=Ytlm5slR:K~%Re)(F-S:Diz*Xqr{NUwa{;Bk?S-GK)OSFpFE@:M:iVE7===wt=CmK]BRxEZ3j6H)OSFpv1YC7.S:DiHJwU*aNu{pf_E{\r~v.?Qi*aNuRIC?`8EzH`I@Qi*aNuRIC?%|Z:Y$Z4U!g~lh1lJAAAuW&wUY6eit&F)"},
-{"bitmap/anchor-light.png", R"(vuk:eJs4+BAAN/-MCG4DAAk_AAAA.FMAAAkUJ/IKAAdZ=J.!wCC'\vBAVBWBP%tvNAAA_kCw`Xg#A$?UPF$AO5sc?_B'29saGT,H|Ur0xDcVZID6t;$O}@TspIvaOXvO4`D`^#5+#2)EZ3j6rgZ1L4P~'`?gle{?Qi*aNuRIC?'8XK\[+jB_Zj9NSudkK]BRxEZ3j6H)OSFpv1YC7.S:DiHJwU*aY=f$j(OqiS#2)EZ3j6rg`%'0A}J@#2)EZ3j6rgw$X6!^2VCP-G3l/(]`!tV07AAABtnHpwZ9)'&F)"},
-{"bitmap/anchor-secondary-dark.png", R"(vuk:eJs4+BAAN/-MCG4DAAk_AAAA.FMAAAkUJ/IKAAdZ=J.!wCC'\vBAVBWBP%tvNAAAkkCw`Xg#A$mr+DpB`X~4HQ@~?QkxPv,Fiu%;Yj)E5/00wypzzSx^D4G\~nGi)!8[AesS&uCRxE+gFCvgFO)~v~Xgb60^Qi*aNudkK]BRxEZ3j6N:Y6op2TZ|k$\#%uCRxEZ3j6H)OSFpv1oyOgRLGbp^Qi*aNudkK]BRxEZ3j6N:XNXhwqibiC7.S:`gbP%,q!3CwE2v/&kEzWAAAA=5GUv+oX!GE)"},
-{"bitmap/anchor-secondary-light.png", R"(vuk:eJs4+BAAN/-MCG4DAAk_AAAA.FMAAAkUJ/IKAAdZ=J.!wCC'\vBAVBWBP%tvNAAA-kCw`Xg#A$?U'ElB+B~42)~s?ig#6uKOY^SeM!#zs5al&ls^&y?sx'A9NLY0gWRy8;+L*mBTFpv1[nS9dW=.H]B\6K&x%uCRxEZ3j6H)OSFpv1%XLQk;xhvn]p|w%uCRxEZ3j6H)OSFpv1waXgUy$N`$F-S:DiHJwU*aNudkK]h#5GXWYV-GK)OSFpFEb~K:*rh$\FmDEBUwmw:c=SmlAAAA=5GUv+oX!GE)"},
-{"bitmap/guide-horizontal-dark.png", R"(vuk:eJs4+BAAN/-MCG4DAA6yBAC'5FMAAAR9S,$BAAdZ=J.!wCC'\vBAVBWBP%tvNAAA$YCw`XJ0Cy\~B'B'di~haCJlf^Vxa4CAmy4B|;F4_RBAAA9ZNoBz[uhNI)"},
-{"bitmap/guide-horizontal-light.png", R"(vuk:eJs4+BAAN/-MCG4DAA6yBAC'5FMAAAR9S,$BAAdZ=J.!wCC'\vBAVBWBP%tvNAAA$YCw`XJ0CylE[h_sbxWEaAdCTFeO+OAA_cYtpIKWUOAAAA=5GUv+oX!GE)"},
-{"bitmap/guide-vertical-dark.png", R"(vuk:eJs4+BAAN/-MCG4DAA:CAAAA]FMAAAs8KD,IAAdZ=J.!wCC'\vBAVBWBP%tvNAAAFZCw`XJ0Cy\~B'B'0tVE[hHB~hpx+RJ,pVZA|;DV-vzcLWKBAABtnHpwZ9)'&F)"},
-{"bitmap/guide-vertical-light.png", R"(vuk:eJs4+BAAN/-MCG4DAA:CAAAA]FMAAAs8KD,IAAdZ=J.!wCC'\vBAVBWBP%tvNAAA}YCw`XJ0CylE[h_s{Qxt(aNtXxnR(*@I`NDAqv9(Xu`EEAAAAAr7vbMo\F9BB)"},
-};
+namespace bitmaps {
+	// 1 bit per pixel, row major, msb first. 1 == white, 0 == black
+	struct bitmap
+	{
+		const char* name;
+		unsigned width;
+		unsigned height;
+		const uint8_t* data;
+
+		constexpr bool get(unsigned x, unsigned y) const
+		{
+			unsigned i = y*width + x;
+			return (data[i/8] >> (7 - i%8)) & 1;
+		}
+	};
+
+	// one uint64_t per symbol: cell_size*cell_size bits, row major, msb first. 1 == background
+	// the hashes are what image_hash::average_hash() gives for the rendered tile.
+	struct symbol_set
+	{
+		unsigned symbol_bits;
+		unsigned cell_size;
+		unsigned count;
+		const uint64_t* masks;
+		const uint64_t* hashes_dark;
+		const uint64_t* hashes_light;
+	};
+
+	inline constexpr uint8_t anchor_light[] = {
+		0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xc0,
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x3c, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x03, 0xc0, 0x00,
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x3c, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x03, 0xc0, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0x00, 0x3c, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x03, 0xc0, 0x00, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0x3c, 0x07, 0xff, 0xff, 0xff, 0xff, 0xfe, 0x03, 0xc0, 0x7f, 0xff, 0xff, 0xff,
+		0xff, 0xe0, 0x3c, 0x07, 0xff, 0xff, 0xff, 0xff, 0xfe, 0x03, 0xc0, 0x7f, 0xff, 0xff, 0xff, 0xff,
+		0xe0, 0x3c, 0x07, 0xff, 0xff, 0xff, 0xff, 0xfe, 0x03, 0xc0, 0x7f, 0xff, 0xff, 0xff, 0xff, 0xe0,
+		0x3c, 0x07, 0xff, 0xff, 0xff, 0xff, 0xfe, 0x03, 0xc0, 0x7f, 0x00, 0x00, 0x00, 0x0f, 0xe0, 0x3c,
+		0x07, 0xf0, 0x00, 0x00, 0x00, 0xfe, 0x03, 0xc0, 0x7f, 0x00, 0x00, 0x00, 0x0f, 0xe0, 0x3c, 0x07,
+		0xf0, 0x00, 0x00, 0x00, 0xfe, 0x03, 0xc0, 0x7f, 0x00, 0x00, 0x00, 0x0f, 0xe0, 0x3c, 0x07, 0xf0,
+		0x00, 0x00, 0x00, 0xfe, 0x03, 0xc0, 0x7f, 0x00, 0x00, 0x00, 0x0f, 0xe0, 0x3c, 0x07, 0xf0, 0x00,
+		0x00, 0x00, 0xfe, 0x03, 0xc0, 0x7f, 0x00, 0x00, 0x00, 0x0f, 0xe0, 0x3c, 0x07, 0xf0, 0x00, 0x00,
+		0x00, 0xfe, 0x03, 0xc0, 0x7f, 0x00, 0x00, 0x00, 0x0f, 0xe0, 0x3c, 0x07, 0xf0, 0x00, 0x00, 0x00,
+		0xfe, 0x03, 0xc0, 0x7f, 0x00, 0x00, 0x00, 0x0f, 0xe0, 0x3c, 0x07, 0xf0, 0x00, 0x00, 0x00, 0xfe,
+		0x03, 0xc0, 0x7f, 0x00, 0x00, 0x00, 0x0f, 0xe0, 0x3c, 0x07, 0xf0, 0x00, 0x00, 0x00, 0xfe, 0x03,
+		0xc0, 0x7f, 0x00, 0x00, 0x00, 0x0f, 0xe0, 0x3c, 0x07, 0xf0, 0x00, 0x00, 0x00, 0xfe, 0x03, 0xc0,
+		0x7f, 0x00, 0x00, 0x00, 0x0f, 0xe0, 0x3c, 0x07, 0xf0, 0x00, 0x00, 0x00, 0xfe, 0x03, 0xc0, 0x7f,
+		0x00, 0x00, 0x00, 0x0f, 0xe0, 0x3c, 0x07, 0xf0, 0x00, 0x00, 0x00, 0xfe, 0x03, 0xc0, 0x7f, 0x00,
+		0x00, 0x00, 0x0f, 0xe0, 0x3c, 0x07, 0xf0, 0x00, 0x00, 0x00, 0xfe, 0x03, 0xc0, 0x7f, 0x00, 0x00,
+		0x00, 0x0f, 0xe0, 0x3c, 0x07, 0xf0, 0x00, 0x00, 0x00, 0xfe, 0x03, 0xc0, 0x7f, 0x00, 0x00, 0x00,
+		0x0f, 0xe0, 0x3c, 0x07, 0xf0, 0x00, 0x00, 0x00, 0xfe, 0x03, 0xc0, 0x7f, 0xff, 0xff, 0xff, 0xff,
+		0xe0, 0x3c, 0x07, 0xff, 0xff, 0xff, 0xff, 0xfe, 0x03, 0xc0, 0x7f, 0xff, 0xff, 0xff, 0xff, 0xe0,
+		0x3c, 0x07, 0xff, 0xff, 0xff, 0xff, 0xfe, 0x03, 0xc0, 0x7f, 0xff, 0xff, 0xff, 0xff, 0xe0, 0x3c,
+		0x07, 0xff, 0xff, 0xff, 0xff, 0xfe, 0x03, 0xc0, 0x7f, 0xff, 0xff, 0xff, 0xff, 0xe0, 0x3c, 0x00,
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x03, 0xc0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x3c, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0x00, 0x03, 0xc0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x3c, 0x00, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0x03, 0xc0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x3c, 0x00, 0x00, 0x00, 0x00,
+		0x00, 0x00, 0x03, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+		0xff, 0xff,
+	};
+
+	inline constexpr uint8_t anchor_secondary_light[] = {
+		0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xc0,
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x3c, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x03, 0xc0, 0x00,
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x3c, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x03, 0xc0, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0x00, 0x3c, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x03, 0xc0, 0x00, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0x3c, 0x07, 0xff, 0xff, 0xff, 0xff, 0xfe, 0x03, 0xc0, 0x7f, 0xff, 0xff, 0xff,
+		0xff, 0xe0, 0x3c, 0x07, 0xff, 0xff, 0xff, 0xff, 0xfe, 0x03, 0xc0, 0x7f, 0xff, 0xff, 0xff, 0xff,
+		0xe0, 0x3c, 0x07, 0xff, 0xff, 0xff, 0xff, 0xfe, 0x03, 0xc0, 0x7f, 0xff, 0xff, 0xff, 0xff, 0xe0,
+		0x3c, 0x07, 0xff, 0xff, 0xff, 0xff, 0xfe, 0x03, 0xc0, 0x7f, 0xff, 0xff, 0xff, 0xff, 0xe0, 0x3c,
+		0x07, 0xff, 0xff, 0xff, 0xff, 0xfe, 0x03, 0xc0, 0x7f, 0xff, 0xff, 0xff, 0xff, 0xe0, 0x3c, 0x07,
+		0xff, 0xff, 0xff, 0xff, 0xfe, 0x03, 0xc0, 0x7f, 0xff, 0xff, 0xff, 0xff, 0xe0, 0x3c, 0x07, 0xff,
+		0xff, 0xff, 0xff, 0xfe, 0x03, 0xc0, 0x7f, 0xff, 0xff, 0xff, 0xff, 0xe0, 0x3c, 0x07, 0xff, 0xe0,
+		0x00, 0x7f, 0xfe, 0x03, 0xc0, 0x7f, 0xfe, 0x00, 0x07, 0xff, 0xe0, 0x3c, 0x07, 0xff, 0xe0, 0x00,
+		0x7f, 0xfe, 0x03, 0xc0, 0x7f, 0xfe, 0x00, 0x07, 0xff, 0xe0, 0x3c, 0x07, 0xff, 0xe0, 0x00, 0x7f,
+		0xfe, 0x03, 0xc0, 0x7f, 0xfe, 0x00, 0x07, 0xff, 0xe0, 0x3c, 0x07, 0xff, 0xe0, 0x00, 0x7f, 0xfe,
+		0x03, 0xc0, 0x7f, 0xfe, 0x00, 0x07, 0xff, 0xe0, 0x3c, 0x07, 0xff, 0xe0, 0x00, 0x7f, 0xfe, 0x03,
+		0xc0, 0x7f, 0xfe, 0x00, 0x07, 0xff, 0xe0, 0x3c, 0x07, 0xff, 0xe0, 0x00, 0x7f, 0xfe, 0x03, 0xc0,
+		0x7f, 0xfe, 0x00, 0x07, 0xff, 0xe0, 0x3c, 0x07, 0xff, 0xe0, 0x00, 0x7f, 0xfe, 0x03, 0xc0, 0x7f,
+		0xfe, 0x00, 0x07, 0xff, 0xe0, 0x3c, 0x07, 0xff, 0xff, 0xff, 0xff, 0xfe, 0x03, 0xc0, 0x7f, 0xff,
+		0xff, 0xff, 0xff, 0xe0, 0x3c, 0x07, 0xff, 0xff, 0xff, 0xff, 0xfe, 0x03, 0xc0, 0x7f, 0xff, 0xff,
+		0xff, 0xff, 0xe0, 0x3c, 0x07, 0xff, 0xff, 0xff, 0xff, 0xfe, 0x03, 0xc0, 0x7f, 0xff, 0xff, 0xff,
+		0xff, 0xe0, 0x3c, 0x07, 0xff, 0xff, 0xff, 0xff, 0xfe, 0x03, 0xc0, 0x7f, 0xff, 0xff, 0xff, 0xff,
+		0xe0, 0x3c, 0x07, 0xff, 0xff, 0xff, 0xff, 0xfe, 0x03, 0xc0, 0x7f, 0xff, 0xff, 0xff, 0xff, 0xe0,
+		0x3c, 0x07, 0xff, 0xff, 0xff, 0xff, 0xfe, 0x03, 0xc0, 0x7f, 0xff, 0xff, 0xff, 0xff, 0xe0, 0x3c,
+		0x07, 0xff, 0xff, 0xff, 0xff, 0xfe, 0x03, 0xc0, 0x7f, 0xff, 0xff, 0xff, 0xff, 0xe0, 0x3c, 0x00,
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x03, 0xc0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x3c, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0x00, 0x03, 0xc0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x3c, 0x00, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0x03, 0xc0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x3c, 0x00, 0x00, 0x00, 0x00,
+		0x00, 0x00, 0x03, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+		0xff, 0xff,
+	};
+
+	inline constexpr uint8_t guide_horizontal_light[] = {
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	};
+
+	inline constexpr uint8_t guide_vertical_light[] = {
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	};
+
+	inline constexpr uint8_t anchor_dark[] = {
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x3f,
+		0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xc3, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xfc, 0x3f, 0xff,
+		0xff, 0xff, 0xff, 0xff, 0xff, 0xc3, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xfc, 0x3f, 0xff, 0xff,
+		0xff, 0xff, 0xff, 0xff, 0xc3, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xfc, 0x3f, 0xff, 0xff, 0xff,
+		0xff, 0xff, 0xff, 0xc3, 0xf8, 0x00, 0x00, 0x00, 0x00, 0x01, 0xfc, 0x3f, 0x80, 0x00, 0x00, 0x00,
+		0x00, 0x1f, 0xc3, 0xf8, 0x00, 0x00, 0x00, 0x00, 0x01, 0xfc, 0x3f, 0x80, 0x00, 0x00, 0x00, 0x00,
+		0x1f, 0xc3, 0xf8, 0x00, 0x00, 0x00, 0x00, 0x01, 0xfc, 0x3f, 0x80, 0x00, 0x00, 0x00, 0x00, 0x1f,
+		0xc3, 0xf8, 0x00, 0x00, 0x00, 0x00, 0x01, 0xfc, 0x3f, 0x80, 0xff, 0xff, 0xff, 0xf0, 0x1f, 0xc3,
+		0xf8, 0x0f, 0xff, 0xff, 0xff, 0x01, 0xfc, 0x3f, 0x80, 0xff, 0xff, 0xff, 0xf0, 0x1f, 0xc3, 0xf8,
+		0x0f, 0xff, 0xff, 0xff, 0x01, 0xfc, 0x3f, 0x80, 0xff, 0xff, 0xff, 0xf0, 0x1f, 0xc3, 0xf8, 0x0f,
+		0xff, 0xff, 0xff, 0x01, 0xfc, 0x3f, 0x80, 0xff, 0xff, 0xff, 0xf0, 0x1f, 0xc3, 0xf8, 0x0f, 0xff,
+		0xff, 0xff, 0x01, 0xfc, 0x3f, 0x80, 0xff, 0xff, 0xff, 0xf0, 0x1f, 0xc3, 0xf8, 0x0f, 0xff, 0xff,
+		0xff, 0x01, 0xfc, 0x3f, 0x80, 0xff, 0xff, 0xff, 0xf0, 0x1f, 0xc3, 0xf8, 0x0f, 0xff, 0xff, 0xff,
+		0x01, 0xfc, 0x3f, 0x80, 0xff, 0xff, 0xff, 0xf0, 0x1f, 0xc3, 0xf8, 0x0f, 0xff, 0xff, 0xff, 0x01,
+		0xfc, 0x3f, 0x80, 0xff, 0xff, 0xff, 0xf0, 0x1f, 0xc3, 0xf8, 0x0f, 0xff, 0xff, 0xff, 0x01, 0xfc,
+		0x3f, 0x80, 0xff, 0xff, 0xff, 0xf0, 0x1f, 0xc3, 0xf8, 0x0f, 0xff, 0xff, 0xff, 0x01, 0xfc, 0x3f,
+		0x80, 0xff, 0xff, 0xff, 0xf0, 0x1f, 0xc3, 0xf8, 0x0f, 0xff, 0xff, 0xff, 0x01, 0xfc, 0x3f, 0x80,
+		0xff, 0xff, 0xff, 0xf0, 0x1f, 0xc3, 0xf8, 0x0f, 0xff, 0xff, 0xff, 0x01, 0xfc, 0x3f, 0x80, 0xff,
+		0xff, 0xff, 0xf0, 0x1f, 0xc3, 0xf8, 0x0f, 0xff, 0xff, 0xff, 0x01, 0xfc, 0x3f, 0x80, 0xff, 0xff,
+		0xff, 0xf0, 0x1f, 0xc3, 0xf8, 0x0f, 0xff, 0xff, 0xff, 0x01, 0xfc, 0x3f, 0x80, 0xff, 0xff, 0xff,
+		0xf0, 0x1f, 0xc3, 0xf8, 0x0f, 0xff, 0xff, 0xff, 0x01, 0xfc, 0x3f, 0x80, 0x00, 0x00, 0x00, 0x00,
+		0x1f, 0xc3, 0xf8, 0x00, 0x00, 0x00, 0x00, 0x01, 0xfc, 0x3f, 0x80, 0x00, 0x00, 0x00, 0x00, 0x1f,
+		0xc3, 0xf8, 0x00, 0x00, 0x00, 0x00, 0x01, 0xfc, 0x3f, 0x80, 0x00, 0x00, 0x00, 0x00, 0x1f, 0xc3,
+		0xf8, 0x00, 0x00, 0x00, 0x00, 0x01, 0xfc, 0x3f, 0x80, 0x00, 0x00, 0x00, 0x00, 0x1f, 0xc3, 0xff,
+		0xff, 0xff, 0xff, 0xff, 0xff, 0xfc, 0x3f, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xc3, 0xff, 0xff,
+		0xff, 0xff, 0xff, 0xff, 0xfc, 0x3f, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xc3, 0xff, 0xff, 0xff,
+		0xff, 0xff, 0xff, 0xfc, 0x3f, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xc3, 0xff, 0xff, 0xff, 0xff,
+		0xff, 0xff, 0xfc, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		0x00, 0x00,
+	};
+
+	inline constexpr uint8_t anchor_secondary_dark[] = {
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x3f,
+		0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xc3, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xfc, 0x3f, 0xff,
+		0xff, 0xff, 0xff, 0xff, 0xff, 0xc3, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xfc, 0x3f, 0xff, 0xff,
+		0xff, 0xff, 0xff, 0xff, 0xc3, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xfc, 0x3f, 0xff, 0xff, 0xff,
+		0xff, 0xff, 0xff, 0xc3, 0xf8, 0x00, 0x00, 0x00, 0x00, 0x01, 0xfc, 0x3f, 0x80, 0x00, 0x00, 0x00,
+		0x00, 0x1f, 0xc3, 0xf8, 0x00, 0x00, 0x00, 0x00, 0x01, 0xfc, 0x3f, 0x80, 0x00, 0x00, 0x00, 0x00,
+		0x1f, 0xc3, 0xf8, 0x00, 0x00, 0x00, 0x00, 0x01, 0xfc, 0x3f, 0x80, 0x00, 0x00, 0x00, 0x00, 0x1f,
+		0xc3, 0xf8, 0x00, 0x00, 0x00, 0x00, 0x01, 0xfc, 0x3f, 0x80, 0x00, 0x00, 0x00, 0x00, 0x1f, 0xc3,
+		0xf8, 0x00, 0x00, 0x00, 0x00, 0x01, 0xfc, 0x3f, 0x80, 0x00, 0x00, 0x00, 0x00, 0x1f, 0xc3, 0xf8,
+		0x00, 0x00, 0x00, 0x00, 0x01, 0xfc, 0x3f, 0x80, 0x00, 0x00, 0x00, 0x00, 0x1f, 0xc3, 0xf8, 0x00,
+		0x00, 0x00, 0x00, 0x01, 0xfc, 0x3f, 0x80, 0x00, 0x00, 0x00, 0x00, 0x1f, 0xc3, 0xf8, 0x00, 0x1f,
+		0xff, 0x80, 0x01, 0xfc, 0x3f, 0x80, 0x01, 0xff, 0xf8, 0x00, 0x1f, 0xc3, 0xf8, 0x00, 0x1f, 0xff,
+		0x80, 0x01, 0xfc, 0x3f, 0x80, 0x01, 0xff, 0xf8, 0x00, 0x1f, 0xc3, 0xf8, 0x00, 0x1f, 0xff, 0x80,
+		0x01, 0xfc, 0x3f, 0x80, 0x01, 0xff, 0xf8, 0x00, 0x1f, 0xc3, 0xf8, 0x00, 0x1f, 0xff, 0x80, 0x01,
+		0xfc, 0x3f, 0x80, 0x01, 0xff, 0xf8, 0x00, 0x1f, 0xc3, 0xf8, 0x00, 0x1f, 0xff, 0x80, 0x01, 0xfc,
+		0x3f, 0x80, 0x01, 0xff, 0xf8, 0x00, 0x1f, 0xc3, 0xf8, 0x00, 0x1f, 0xff, 0x80, 0x01, 0xfc, 0x3f,
+		0x80, 0x01, 0xff, 0xf8, 0x00, 0x1f, 0xc3, 0xf8, 0x00, 0x1f, 0xff, 0x80, 0x01, 0xfc, 0x3f, 0x80,
+		0x01, 0xff, 0xf8, 0x00, 0x1f, 0xc3, 0xf8, 0x00, 0x00, 0x00, 0x00, 0x01, 0xfc, 0x3f, 0x80, 0x00,
+		0x00, 0x00, 0x00, 0x1f, 0xc3, 0xf8, 0x00, 0x00, 0x00, 0x00, 0x01, 0xfc, 0x3f, 0x80, 0x00, 0x00,
+		0x00, 0x00, 0x1f, 0xc3, 0xf8, 0x00, 0x00, 0x00, 0x00, 0x01, 0xfc, 0x3f, 0x80, 0x00, 0x00, 0x00,
+		0x00, 0x1f, 0xc3, 0xf8, 0x00, 0x00, 0x00, 0x00, 0x01, 0xfc, 0x3f, 0x80, 0x00, 0x00, 0x00, 0x00,
+		0x1f, 0xc3, 0xf8, 0x00, 0x00, 0x00, 0x00, 0x01, 0xfc, 0x3f, 0x80, 0x00, 0x00, 0x00, 0x00, 0x1f,
+		0xc3, 0xf8, 0x00, 0x00, 0x00, 0x00, 0x01, 0xfc, 0x3f, 0x80, 0x00, 0x00, 0x00, 0x00, 0x1f, 0xc3,
+		0xf8, 0x00, 0x00, 0x00, 0x00, 0x01, 0xfc, 0x3f, 0x80, 0x00, 0x00, 0x00, 0x00, 0x1f, 0xc3, 0xff,
+		0xff, 0xff, 0xff, 0xff, 0xff, 0xfc, 0x3f, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xc3, 0xff, 0xff,
+		0xff, 0xff, 0xff, 0xff, 0xfc, 0x3f, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xc3, 0xff, 0xff, 0xff,
+		0xff, 0xff, 0xff, 0xfc, 0x3f, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xc3, 0xff, 0xff, 0xff, 0xff,
+		0xff, 0xff, 0xfc, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		0x00, 0x00,
+	};
+
+	inline constexpr uint8_t guide_horizontal_dark[] = {
+		0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+		0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	};
+
+	inline constexpr uint8_t guide_vertical_dark[] = {
+		0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+		0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	};
+
+	inline constexpr std::array<bitmap, 8> markers = {{
+		{"bitmap/anchor-light.png", 60, 60, anchor_light},
+		{"bitmap/anchor-secondary-light.png", 60, 60, anchor_secondary_light},
+		{"bitmap/guide-horizontal-light.png", 100, 2, guide_horizontal_light},
+		{"bitmap/guide-vertical-light.png", 2, 100, guide_vertical_light},
+		{"bitmap/anchor-dark.png", 60, 60, anchor_dark},
+		{"bitmap/anchor-secondary-dark.png", 60, 60, anchor_secondary_dark},
+		{"bitmap/guide-horizontal-dark.png", 100, 2, guide_horizontal_dark},
+		{"bitmap/guide-vertical-dark.png", 2, 100, guide_vertical_dark},
+	}};
+
+	inline constexpr uint64_t symbols2_masks[] = {
+		0x8cef,
+		0xf38c20,
+		0x8639e,
+		0x1ee6200,
+	};
+	inline constexpr uint64_t symbols2_hashes_dark[] = {
+		0x1ff7310,
+		0x10c73df,
+		0x1f79c61,
+		0x119dff,
+	};
+	inline constexpr uint64_t symbols2_hashes_light[] = {
+		0x8cef,
+		0xf38c20,
+		0x8639e,
+		0x1ee6200,
+	};
+
+	inline constexpr uint64_t symbols4_masks[] = {
+		0x103070f1f3f7f,
+		0x7f3f1f0f07030100,
+		0x80c0e0f0f8fcfe,
+		0xfefcf8f0e0c08000,
+		0xe7e7e70000e7e7e7,
+		0x991818ffff181899,
+		0xc381183c3c1881c3,
+		0xe7e7c3c381810000,
+		0x3f0f030000030f3f,
+		0x30fffff0f0300,
+		0xc0f0fffff0c000,
+		0x181818183c3c7e7e,
+		0x7e7e3c3c18181818,
+		0xffff3c1881c3e7ff,
+		0xf3e3c78f8fc7e3f3,
+		0xe1e1c7c7e3e38787,
+	};
+	inline constexpr uint64_t symbols4_hashes_dark[] = {
+		0xfffefcf8f0e0c080,
+		0x80c0e0f0f8fcfeff,
+		0xff7f3f1f0f070301,
+		0x103070f1f3f7fff,
+		0x181818ffff181818,
+		0x66e7e70000e7e766,
+		0x3c7ee7c3c3e77e3c,
+		0x18183c3c7e7effff,
+		0xc0f0fcfffffcf0c0,
+		0xfffcf00000f0fcff,
+		0xff3f0f00000f3fff,
+		0xe7e7e7e7c3c38181,
+		0x8181c3c3e7e7e7e7,
+		0xc3e77e3c1800,
+		0xc1c387070381c0c,
+		0x1e1e38381c1c7878,
+	};
+	inline constexpr uint64_t symbols4_hashes_light[] = {
+		0x103070f1f3f7f,
+		0x7f3f1f0f07030100,
+		0x80c0e0f0f8fcfe,
+		0xfefcf8f0e0c08000,
+		0xe7e7e70000e7e7e7,
+		0x991818ffff181899,
+		0xc381183c3c1881c3,
+		0xe7e7c3c381810000,
+		0x3f0f030000030f3f,
+		0x30fffff0f0300,
+		0xc0f0fffff0c000,
+		0x181818183c3c7e7e,
+		0x7e7e3c3c18181818,
+		0xffff3c1881c3e7ff,
+		0xf3e3c78f8fc7e3f3,
+		0xe1e1c7c7e3e38787,
+	};
+
+	inline constexpr std::array<symbol_set, 2> symbols = {{
+		{2, 5, 4, symbols2_masks, symbols2_hashes_dark, symbols2_hashes_light},
+		{4, 8, 16, symbols4_masks, symbols4_hashes_dark, symbols4_hashes_light},
+	}};
+
+	constexpr const bitmap* get_marker(std::string_view name)
+	{
+		for (const bitmap& b : markers)
+			if (name == b.name)
+				return &b;
+		return nullptr;
+	}
+
+	constexpr const symbol_set* get_symbols(unsigned symbol_bits)
+	{
+		for (const symbol_set& s : symbols)
+			if (s.symbol_bits == symbol_bits)
+				return &s;
+		return nullptr;
+	}
+}
 }
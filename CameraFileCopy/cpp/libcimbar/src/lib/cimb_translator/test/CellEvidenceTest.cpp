@@ -0,0 +1,84 @@
+/* This code is subject to the terms of the Mozilla Public License, v.2.0. http://mozilla.org/MPL/2.0/. */
+#include "unittest.h"
+
+#include "CellEvidence.h"
+
+#include <array>
+#include <iostream>
+#include <string>
+#include <vector>
+
+TEST_CASE( "CellEvidenceTest/testSingleLook", "[unit]" )
+{
+	CellEvidence ev(3, 4);
+	assertEquals( 3, ev.num_cells() );
+	assertEquals( 4, ev.num_symbols() );
+	assertEquals( 0, ev.looks() );
+
+	std::array<uint8_t, 4> d0 = {10, 2, 30, 40};
+	std::array<uint8_t, 4> d1 = {1, 20, 30, 40};
+	std::array<uint8_t, 4> d2 = {10, 20, 30, 0};
+	ev.add_symbol(0, d0.data());
+	ev.add_symbol(1, d1.data());
+	ev.add_symbol(2, d2.data());
+	ev.add_color(1, 255, 0, 128);
+	ev.mark_look();
+
+	assertEquals( 1, ev.looks() );
+	assertEquals( 1, ev.best_symbol(0) );
+	assertEquals( 0, ev.best_symbol(1) );
+	assertEquals( 3, ev.best_symbol(2) );
+
+	auto [r, g, b] = ev.mean_color(1);
+	assertEquals( 255, r );
+	assertEquals( 0, g );
+	assertEquals( 128, b );
+}
+
+TEST_CASE( "CellEvidenceTest/testCombine", "[unit]" )
+{
+	CellEvidence combined(2, 4);
+
+	// look 1 is confused about cell 0 -- it thinks it's symbol 2
+	CellEvidence look(2, 4);
+	std::array<uint8_t, 4> bad = {9, 20, 8, 30};
+	std::array<uint8_t, 4> good = {0, 20, 25, 30};
+	look.add_symbol(0, bad.data());
+	look.add_symbol(1, good.data());
+	look.add_color(0, 200, 100, 0);
+	look.mark_look();
+	combined.add_look(look);
+	assertEquals( 2, combined.best_symbol(0) );
+
+	// look 2 is clear about it
+	look.clear();
+	look.add_symbol(0, good.data());
+	look.add_symbol(1, good.data());
+	look.add_color(0, 100, 100, 50);
+	look.mark_look();
+	combined.add_look(look);
+
+	assertEquals( 2, combined.looks() );
+	assertEquals( 0, combined.best_symbol(0) );
+	assertEquals( 0, combined.best_symbol(1) );
+
+	auto [r, g, b] = combined.mean_color(0);
+	assertEquals( 150, r );
+	assertEquals( 100, g );
+	assertEquals( 25, b );
+
+	combined.clear();
+	assertEquals( 0, combined.looks() );
+	assertEquals( 0, std::get<0>(combined.mean_color(0)) );
+}
+
+TEST_CASE( "CellEvidenceTest/testMismatch", "[unit]" )
+{
+	// evidence from a different grid is ignored
+	CellEvidence combined(2, 4);
+	CellEvidence look(3, 4);
+	look.mark_look();
+
+	combined.add_look(look);
+	assertEquals( 0, combined.looks() );
+}
@@ -40,3 +40,25 @@ TEST_CASE( "CimbWriterTest/testCustomSize", "[unit]" )
 	assertEquals(1040, img.rows);
 	assertEquals( 0xab00ab02af0abfab, image_hash::average_hash(img) );
 }
+
+TEST_CASE( "CimbWriterTest/testWriteCells", "[unit]" )
+{
+	CimbWriter one(4, 2, true, 1, 1040);
+	CimbWriter all(4, 2, true, 1, 1040);
+
+	std::vector<uint8_t> cells;
+	for (unsigned i = 0; i < one.num_cells(); ++i)
+	{
+		cells.push_back((i * 7) % 64);
+		assertTrue( one.write(cells.back()) );
+	}
+	assertTrue( one.done() );
+
+	// a partial write, then the rest
+	assertEquals( 100, all.write(cells.data(), 100) );
+	assertEquals( cells.size() - 100, all.write(cells.data() + 100, cells.size()) );
+	assertTrue( all.done() );
+	assertEquals( 0, all.write(cells.data(), cells.size()) );
+
+	assertEquals( 0, cv::norm(one.image(), all.image(), cv::NORM_L1) );
+}
@@ -0,0 +1,96 @@
+/* This code is subject to the terms of the Mozilla Public License, v.2.0. http://mozilla.org/MPL/2.0/. */
+#include "unittest.h"
+
+#include "Config.h"
+#include "DecodeGeometry.h"
+
+#include <string>
+#include <thread>
+
+using cimbar::Config;
+
+TEST_CASE( "ConfigTest/testDefault", "[unit]" )
+{
+	assertEquals( std::string("8x8"), Config::grid().name );
+	assertEquals( 8, Config::cell_size() );
+	assertEquals( 4, Config::symbol_bits() );
+	assertEquals( 1024, Config::image_size() );
+	assertEquals( 12400, Config::total_cells() );
+	assertEquals( 9300, Config::capacity() );
+}
+
+TEST_CASE( "ConfigTest/testScope", "[unit]" )
+{
+	{
+		Config::Scope scope(cimbar::Grid5x5);
+		assertEquals( std::string("5x5"), Config::grid().name );
+		assertEquals( 5, Config::cell_size() );
+		assertEquals( 2, Config::symbol_bits() );
+		assertEquals( 40, Config::ecc_bytes() );
+		assertEquals( 988, Config::image_size() );
+		assertEquals( 6, Config::cell_spacing() );
+		assertEquals( 9, Config::corner_padding() );
+		assertEquals( 25920, Config::total_cells() );
+		assertEquals( 12960, Config::capacity() );
+
+		{
+			Config::Scope inner(cimbar::Grid8x8);
+			assertEquals( 8, Config::cell_size() );
+		}
+		assertEquals( 5, Config::cell_size() );
+
+		// other threads don't see our scope
+		unsigned otherCellSize = 0;
+		std::thread([&otherCellSize] () { otherCellSize = Config::cell_size(); }).join();
+		assertEquals( 8, otherCellSize );
+	}
+	assertEquals( 8, Config::cell_size() );
+}
+
+TEST_CASE( "ConfigTest/testSetGrid", "[unit]" )
+{
+	assertFalse( Config::set_grid("7x7") );
+	assertEquals( 8, Config::cell_size() );
+
+	assertTrue( Config::set_grid("5x5") );
+	assertEquals( 5, Config::cell_size() );
+	{
+		// scopes win
+		Config::Scope scope(cimbar::Grid8x8);
+		assertEquals( 8, Config::cell_size() );
+	}
+
+	unsigned otherCellSize = 0;
+	std::thread([&otherCellSize] () { otherCellSize = Config::cell_size(); }).join();
+	assertEquals( 5, otherCellSize );
+
+	assertTrue( Config::set_grid("8x8") );
+	assertEquals( 8, Config::cell_size() );
+}
+
+TEST_CASE( "ConfigTest/testDispatch", "[unit]" )
+{
+	auto cellSize = [] (auto conf) { return decltype(conf)::cell_size; };
+	assertEquals( 8, Config::dispatch(cellSize) );
+	assertEquals( 5, Config::dispatch(cimbar::Grid5x5, cellSize) );
+
+	Config::Scope scope(cimbar::Grid5x5);
+	assertEquals( 5, Config::dispatch(cellSize) );
+}
+
+TEST_CASE( "ConfigTest/testGeometry", "[unit]" )
+{
+	// each grid gets its own cached geometry
+	std::shared_ptr<const DecodeGeometry> geo8 = DecodeGeometry::get();
+	std::shared_ptr<const DecodeGeometry> geo5;
+	{
+		Config::Scope scope(cimbar::Grid5x5);
+		geo5 = DecodeGeometry::get();
+		assertEquals( geo5.get(), DecodeGeometry::get().get() );
+	}
+
+	assertEquals( geo8.get(), DecodeGeometry::get().get() );
+	assertEquals( 12400, geo8->size() );
+	assertEquals( 25920, geo5->size() );
+	assertEquals( 162, geo5->dimensions() );
+}
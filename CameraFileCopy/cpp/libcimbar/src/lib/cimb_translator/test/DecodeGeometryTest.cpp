@@ -0,0 +1,63 @@
+/* This code is subject to the terms of the Mozilla Public License, v.2.0. http://mozilla.org/MPL/2.0/. */
+#include "unittest.h"
+
+#include "DecodeGeometry.h"
+#include "AdjacentCellFinder.h"
+#include "CellPositions.h"
+#include "Interleave.h"
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+TEST_CASE( "DecodeGeometryTest/testShared", "[unit]" )
+{
+	std::shared_ptr<const DecodeGeometry> geo = DecodeGeometry::get(9, 112, 8, 6, 155, 2);
+	assertEquals( geo.get(), DecodeGeometry::get(9, 112, 8, 6, 155, 2).get() );
+	assertTrue( geo.get() != DecodeGeometry::get(9, 112, 8, 6, 0, 1).get() );
+}
+
+TEST_CASE( "DecodeGeometryTest/testPositions", "[unit]" )
+{
+	std::shared_ptr<const DecodeGeometry> geo = DecodeGeometry::get(9, 112, 8, 6);
+	CellPositions::positions_list expected = CellPositions::compute(9, 112, 8, 6);
+
+	assertEquals( 12400, geo->size() );
+	for (unsigned i = 0; i < expected.size(); ++i)
+		assertEquals( expected[i], geo->position(i) );
+}
+
+TEST_CASE( "DecodeGeometryTest/testAdjacent", "[unit]" )
+{
+	std::shared_ptr<const DecodeGeometry> geo = DecodeGeometry::get(9, 112, 8, 6);
+	CellPositions::positions_list positions = CellPositions::compute(9, 112, 8, 6);
+	AdjacentCellFinder finder(positions, 112, 6);
+
+	for (unsigned i = 0; i < positions.size(); ++i)
+	{
+		std::array<int, 4> expected = finder.find(i);
+		for (unsigned d = 0; d < 4; ++d)
+			assertEquals( expected[d] < 0? DecodeGeometry::NONE : expected[d], geo->adjacent(i)[d] );
+	}
+
+	// first row: nothing on top, cell 100 below
+	assertEquals( 1, geo->right(0) );
+	assertEquals( DecodeGeometry::NONE, geo->left(0) );
+	assertEquals( 100, geo->bottom(0) );
+	assertEquals( DecodeGeometry::NONE, geo->top(0) );
+}
+
+TEST_CASE( "DecodeGeometryTest/testInterleave", "[unit]" )
+{
+	std::shared_ptr<const DecodeGeometry> geo = DecodeGeometry::get(9, 112, 8, 6, 155, 2);
+	std::vector<unsigned> forward = Interleave::interleave_indices(12400, 155, 2);
+	std::vector<unsigned> reverse = Interleave::interleave_reverse(12400, 155, 2);
+
+	assertEquals( reverse.size(), geo->interleave_reverse().size() );
+	for (unsigned i = 0; i < forward.size(); ++i)
+	{
+		assertEquals( forward[i], geo->interleave(i) );
+		assertEquals( reverse[i], geo->interleave_reverse()[i] );
+		assertEquals( i, geo->interleave_reverse()[geo->interleave(i)] );
+	}
+}
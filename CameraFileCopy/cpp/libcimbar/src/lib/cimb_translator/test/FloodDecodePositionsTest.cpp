@@ -2,8 +2,10 @@
 #include "unittest.h"
 
 #include "FloodDecodePositions.h"
+#include "legacy_flood_decode_positions.h"
 
 #include <iostream>
+#include <random>
 #include <set>
 #include <string>
 #include <vector>
@@ -128,3 +130,118 @@ TEST_CASE( "FloodDecodePositionsTest/testSimple", "[unit]" )
 	assertEquals(posCount, count);
 	assertEquals(0, remainingPos.size());
 }
+
+TEST_CASE( "FloodDecodePositionsTest/testPriority", "[unit]" )
+{
+	FloodDecodePositions cells(9, 112, 8, 6);
+
+	unsigned i;
+	CellPositions::coordinate xy;
+	CellDrift drift;
+	uint8_t cooldown;
+
+	// seeds. The top right corner (99) gets the best score, top left (0) the worst.
+	// (all worse than the seeds' own 0 and 1, so there's no tie with a seed still in the queue)
+	for (int c = 0; c < 8; ++c)
+	{
+		std::tie(i, xy, drift, cooldown) = cells.next();
+		unsigned error = (i == 99)? 2 : (i == 0)? 4 : 3;
+		cells.update(i, drift, error, cooldown);
+	}
+
+	// 99's neighbors come first...
+	std::set<unsigned> expected = {98, 199};
+	for (int c = 0; c < 2; ++c)
+	{
+		std::tie(i, xy, drift, cooldown) = cells.next();
+		assertEquals( 1, expected.erase(i) );
+		cells.update(i, drift, 5, cooldown);
+	}
+
+	// then the other corners' (3), before 0's (4) or the ones we just queued (5)
+	std::set<unsigned> zeroNeighbors = {1, 100};
+	for (int c = 0; c < 12; ++c)
+	{
+		std::tie(i, xy, drift, cooldown) = cells.next();
+		assertEquals( 0, zeroNeighbors.count(i) );
+		cells.update(i, drift, 6, cooldown);
+	}
+
+	for (int c = 0; c < 2; ++c)
+	{
+		std::tie(i, xy, drift, cooldown) = cells.next();
+		assertEquals( 1, zeroNeighbors.erase(i) );
+	}
+}
+
+TEST_CASE( "FloodDecodePositionsTest/testRequeue", "[unit]" )
+{
+	// a cell that's already queued moves up if it gets a better score, and stays put if it doesn't.
+	FloodDecodePositions cells(9, 112, 8, 6);
+
+	unsigned i;
+	CellPositions::coordinate xy;
+	CellDrift drift;
+	uint8_t cooldown;
+
+	for (int c = 0; c < 8; ++c)
+	{
+		std::tie(i, xy, drift, cooldown) = cells.next();
+		// 0 queues its neighbors (1 and 100) at 6, with some drift. The other corners' neighbors wait at 9.
+		cells.update(i, CellDrift(i == 0? 1 : 0, 0), i == 0? 6 : 9, cooldown);
+	}
+
+	std::tie(i, xy, drift, cooldown) = cells.next();
+	assertTrue( (i == 1 or i == 100) );
+	unsigned other = (i == 1)? 100 : 1;
+	assertEquals( 1, drift.x() );
+
+	// a worse score for 101 (100's right neighbor, 1's bottom neighbor): queued at 7
+	cells.update(i, CellDrift(0, 1), 7, cooldown);
+	// a better one for the same cell, from the other side: requeued at 2, with the new drift
+	std::tie(i, xy, drift, cooldown) = cells.next();
+	assertEquals( other, i );
+	cells.update(i, CellDrift(-1, -1), 2, cooldown);
+
+	std::tie(i, xy, drift, cooldown) = cells.next();
+	assertEquals( 101, i );
+	assertEquals( -1, drift.x() );
+	assertEquals( -1, drift.y() );
+}
+
+TEST_CASE( "FloodDecodePositionsTest/testMatchesLegacyOrder", "[unit]" )
+{
+	// the decode follows the visit order -- drift carries from cell to cell -- so it has to match the original, ties and all.
+	std::shared_ptr<const DecodeGeometry> geometry = DecodeGeometry::get(9, 112, 8, 6);
+	FloodDecodePositions cells(geometry);
+	legacy::FloodDecodePositions legacyCells(geometry);
+
+	for (unsigned seed : {1, 2, 3})
+	{
+		cells.reset();
+		legacyCells.reset();
+		std::mt19937 rng(seed);
+
+		unsigned count = 0;
+		while (!legacyCells.done())
+		{
+			assertFalse( cells.done() );
+			auto [i, xy, drift, cooldown] = cells.next();
+			auto [li, lxy, ldrift, lcooldown] = legacyCells.next();
+			assertEquals( li, i );
+			assertEquals( ldrift.x(), drift.x() );
+			assertEquals( ldrift.y(), drift.y() );
+			assertEquals( lcooldown, cooldown );
+
+			// a handful of error distances, so plenty of ties. Mostly cooldown==4, to get the horizon/vert pushes too
+			unsigned error = rng() % 6;
+			uint8_t nextCooldown = (rng() % 4)? 4 : rng() % 4;
+			drift.updateDrift((int)(rng() % 3) - 1, (int)(rng() % 3) - 1);
+			cells.update(i, drift, error, nextCooldown);
+			legacyCells.update(li, drift, error, nextCooldown);
+			++count;
+		}
+		assertTrue( cells.done() );
+		assertEquals( 12400, count );
+	}
+}
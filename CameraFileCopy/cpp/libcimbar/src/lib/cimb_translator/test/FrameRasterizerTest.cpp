@@ -0,0 +1,70 @@
+/* This code is subject to the terms of the Mozilla Public License, v.2.0. http://mozilla.org/MPL/2.0/. */
+#include "unittest.h"
+
+#include "FrameRasterizer.h"
+
+#include "CimbWriter.h"
+#include "Config.h"
+#include <opencv2/opencv.hpp>
+
+#include <vector>
+
+namespace {
+	CompactFrame make_frame(unsigned num_cells)
+	{
+		CompactFrame frame;
+		frame.symbol_bits = 4;
+		frame.color_bits = 2;
+		for (unsigned i = 0; i < num_cells; ++i)
+			frame.cells.push_back((i * 13) % 64);
+		return frame;
+	}
+
+	cv::Mat write_frame(const CompactFrame& frame, int canvas_size)
+	{
+		CimbWriter cw(frame.symbol_bits, frame.color_bits, frame.dark, frame.color_mode, canvas_size);
+		for (uint8_t c : frame.cells)
+			cw.write(c);
+		return cw.image();
+	}
+}
+
+TEST_CASE( "FrameRasterizerTest/testMat", "[unit]" )
+{
+	CompactFrame frame = make_frame(cimbar::Config::total_cells());
+	assertEquals( 0, cv::norm(write_frame(frame, 1040), FrameRasterizer::rasterize(frame, 1040), cv::NORM_L1) );
+
+	// partial frames are fine too
+	frame.cells.resize(500);
+	assertEquals( 0, cv::norm(write_frame(frame, 0), FrameRasterizer::rasterize(frame), cv::NORM_L1) );
+}
+
+TEST_CASE( "FrameRasterizerTest/testBufferRGB", "[unit]" )
+{
+	CompactFrame frame = make_frame(cimbar::Config::total_cells());
+	cv::Mat expected = write_frame(frame, 0);
+
+	const int size = cimbar::Config::image_size();
+	cv::Mat canvas(size + 30, size + 20, CV_8UC3, cv::Scalar(1, 2, 3));
+	assertTrue( FrameRasterizer::rasterize(frame, canvas.data, canvas.cols, canvas.rows, canvas.step[0], 3, 15, 20) );
+
+	assertEquals( 0, cv::norm(expected, canvas(cv::Rect(15, 20, size, size)), cv::NORM_L1) );
+	assertEquals( cv::Vec3b(1, 2, 3), canvas.at<cv::Vec3b>(0, 0) );
+
+	// doesn't fit
+	assertFalse( FrameRasterizer::rasterize(frame, canvas.data, canvas.cols, canvas.rows, canvas.step[0], 3, 21, 0) );
+	assertFalse( FrameRasterizer::rasterize(frame, canvas.data, canvas.cols, canvas.rows, canvas.step[0], 2) );
+}
+
+TEST_CASE( "FrameRasterizerTest/testBufferRGBA", "[unit]" )
+{
+	CompactFrame frame = make_frame(cimbar::Config::total_cells());
+	cv::Mat expected = write_frame(frame, 0);
+	cv::cvtColor(expected, expected, cv::COLOR_RGB2RGBA);
+
+	const int size = cimbar::Config::image_size();
+	cv::Mat canvas(size, size, CV_8UC4, cv::Scalar(0, 0, 0, 0));
+	assertTrue( FrameRasterizer::rasterize(frame, canvas.data, canvas.cols, canvas.rows, canvas.step[0], 4) );
+
+	assertEquals( 0, cv::norm(expected, canvas, cv::NORM_L1) );
+}
@@ -0,0 +1,40 @@
+/* This code is subject to the terms of the Mozilla Public License, v.2.0. http://mozilla.org/MPL/2.0/. */
+#include "unittest.h"
+
+#include "TileAtlas.h"
+
+#include "cimb_translator/Common.h"
+#include "cimb_translator/Config.h"
+#include <opencv2/opencv.hpp>
+
+TEST_CASE( "TileAtlasTest/testShared", "[unit]" )
+{
+	std::shared_ptr<const TileAtlas> atlas = TileAtlas::get(4, 2);
+	assertEquals( 64, atlas->size() );
+	assertEquals( atlas.get(), TileAtlas::get(4, 2, true, 1).get() );
+
+	assertTrue( atlas.get() != TileAtlas::get(4, 2, false).get() );
+	assertTrue( atlas.get() != TileAtlas::get(4, 2, true, 0).get() );
+	assertTrue( atlas.get() != TileAtlas::get(4, 3).get() );
+}
+
+TEST_CASE( "TileAtlasTest/testTiles", "[unit]" )
+{
+	std::shared_ptr<const TileAtlas> atlas = TileAtlas::get(4, 3, false);
+
+	cv::Mat expected = cimbar::getTile(4, 7, false, 8, 3); // 3*16 + 7 == 55
+	assertEquals( 0, cv::norm(expected, atlas->tile(55), cv::NORM_L1) );
+	assertEquals( 0, cv::norm(expected, atlas->tile(55 + 128), cv::NORM_L1) );
+}
+
+TEST_CASE( "TileAtlasTest/testFrameTemplate", "[unit]" )
+{
+	const cv::Mat& img = TileAtlas::frame_template(true, 0);
+	assertEquals( cimbar::Config::image_size(), img.cols );
+	assertEquals( cimbar::Config::image_size(), img.rows );
+	assertEquals( img.data, TileAtlas::frame_template(true, cimbar::Config::image_size()).data );
+
+	const cv::Mat& big = TileAtlas::frame_template(true, 1040);
+	assertEquals( 1040, big.cols );
+	assertEquals( 0, cv::norm(img, big(cv::Rect(8, 8, img.cols, img.rows)), cv::NORM_L1) );
+}
@@ -0,0 +1,164 @@
+/* This code is subject to the terms of the Mozilla Public License, v.2.0. http://mozilla.org/MPL/2.0/. */
+#pragma once
+
+#include "CellDrift.h"
+#include "CellPositions.h"
+#include "DecodeGeometry.h"
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <tuple>
+#include <vector>
+
+// the original std::priority_queue FloodDecodePositions. Kept around to check the bucket queue's visit order against.
+namespace legacy
+{
+	class FloodDecodePositions
+	{
+	public:
+		using iter = std::tuple<unsigned, CellPositions::coordinate, CellDrift, uint8_t>;
+		using decode_instructions = std::tuple<CellDrift, uint8_t, uint8_t>; // drift, best_prio, cooldown_pos
+		using decode_prio = std::tuple<uint16_t, uint8_t>; // index, prio
+
+		class PrioCompare
+		{
+		public:
+			bool operator()(const decode_prio& a, const decode_prio& b) const
+			{
+				return std::get<1>(a) > std::get<1>(b);
+			}
+		};
+
+	public:
+		FloodDecodePositions(std::shared_ptr<const DecodeGeometry> geometry)
+			: _geometry(std::move(geometry))
+		{
+			reset();
+		}
+
+		size_t size() const
+		{
+			return _geometry->size();
+		}
+
+		void reset()
+		{
+			_count = 0;
+			_remaining.assign(size(), true);
+			_instructions.assign(size(), {CellDrift(), 0xFE, 0xFE});
+			_heap.clear();
+
+			uint16_t smallRowLen = _geometry->dimensions() - (2*_geometry->marker_size());
+			uint16_t lastElem = size()-1;
+			push(0, 0);
+			push(smallRowLen-1, 0);
+			push(lastElem, 0);
+			push(lastElem-(smallRowLen-1), 0);
+
+			uint16_t betweenMarkerBlock = smallRowLen * _geometry->marker_size();
+			push(betweenMarkerBlock, 1);
+			push(betweenMarkerBlock+_geometry->dimensions()-1, 1);
+			push(lastElem-betweenMarkerBlock, 1);
+			push(lastElem-(betweenMarkerBlock+_geometry->dimensions()-1), 1);
+		}
+
+		bool done() const
+		{
+			return _count == size();
+		}
+
+		iter next()
+		{
+			while (!_heap.empty())
+			{
+				std::pop_heap(_heap.begin(), _heap.end(), PrioCompare());
+				auto [i, _] = _heap.back();
+				_heap.pop_back();
+
+				std::vector<bool>::reference needsDecode = _remaining[i];
+				if (!needsDecode)
+					continue;
+
+				needsDecode = false;
+				++_count;
+				auto [drift, __, cooldown] = _instructions[i];
+				return {i, _geometry->position(i), drift, cooldown};
+			}
+
+			return {0, {0, 0}, CellDrift(), 0xFF};
+		}
+
+		int update(unsigned index, const CellDrift& drift, unsigned error_distance, uint8_t cooldown)
+		{
+			const std::array<uint16_t,4>& adj = _geometry->adjacent(index);
+			update_adjacents(adj, drift, error_distance, cooldown);
+
+			auto& [_, prev_error, prev_cooldown] = _instructions[index];
+			if (prev_error < 3 and error_distance < 3 and prev_cooldown == 4 and cooldown == 4)
+			{
+				uint16_t rridx = adj[0];
+				uint16_t llidx = adj[1];
+				if (rridx != DecodeGeometry::NONE and llidx != DecodeGeometry::NONE)
+				{
+					std::array<uint16_t,4> horizon = {DecodeGeometry::NONE, DecodeGeometry::NONE, DecodeGeometry::NONE, DecodeGeometry::NONE};
+					horizon[0] = _geometry->right(rridx);
+					if (horizon[0] != DecodeGeometry::NONE)
+						horizon[1] = _geometry->right(horizon[0]);
+					horizon[2] = _geometry->left(llidx);
+					if (horizon[2] != DecodeGeometry::NONE)
+						horizon[3] = _geometry->left(horizon[2]);
+
+					update_adjacents(horizon, drift, error_distance, cooldown);
+				}
+
+				uint16_t uuidx = adj[3];
+				uint16_t ddidx = adj[2];
+				if (uuidx != DecodeGeometry::NONE and ddidx != DecodeGeometry::NONE)
+				{
+					std::array<uint16_t,4> vert = {DecodeGeometry::NONE, DecodeGeometry::NONE, DecodeGeometry::NONE, DecodeGeometry::NONE};
+					vert[0] = _geometry->top(uuidx);
+					if (vert[0] != DecodeGeometry::NONE)
+						vert[1] = _geometry->top(vert[0]);
+					vert[2] = _geometry->bottom(ddidx);
+					if (vert[2] != DecodeGeometry::NONE)
+						vert[3] = _geometry->bottom(vert[2]);
+
+					update_adjacents(vert, drift, error_distance, cooldown);
+				}
+			}
+
+			prev_error = error_distance;
+			prev_cooldown = cooldown;
+			return 0;
+		}
+
+	protected:
+		void push(uint16_t index, uint8_t prio)
+		{
+			_heap.push_back({index, prio});
+			std::push_heap(_heap.begin(), _heap.end(), PrioCompare());
+		}
+
+		void update_adjacents(const std::array<uint16_t,4>& adj, const CellDrift& drift, unsigned error_distance, uint8_t cooldown)
+		{
+			for (uint16_t next : adj)
+			{
+				if (next == DecodeGeometry::NONE or !_remaining[next])
+					continue;
+				decode_instructions& di = _instructions[next];
+				if (std::get<1>(di) <= error_distance)
+					continue;
+				di = {drift, error_distance, cooldown};
+				push(next, error_distance);
+			}
+		}
+
+	protected:
+		unsigned _count;
+		std::vector<decode_prio> _heap;
+		std::vector<bool> _remaining;
+		std::vector<decode_instructions> _instructions;
+		std::shared_ptr<const DecodeGeometry> _geometry;
+	};
+}
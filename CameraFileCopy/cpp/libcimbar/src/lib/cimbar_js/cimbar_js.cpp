@@ -2,6 +2,7 @@
 #include "cimbar_js.h"
 
 #include "cimb_translator/Config.h"
+#include "encoder/FramePipeline.h"
 #include "encoder/SimpleEncoder.h"
 
 // 平台检测
@@ -40,11 +41,42 @@ namespace {
     int _frameCount = 0;
     uint8_t _encodeId = 109;
 
+    // frames are encoded in the background, a few ahead of what's on screen
+#ifdef __EMSCRIPTEN__
+    FramePipeline _pipeline(1, 0); // no threads
+#else
+    FramePipeline _pipeline(4, std::max(1U, std::thread::hardware_concurrency()/2));
+#endif
+    bool _pipelineStale = true;
+
     // settings
     unsigned _ecc = cimbar::Config::ecc_bytes();
     unsigned _colorBits = cimbar::Config::color_bits();
     int _compressionLevel = cimbar::Config::compression_level();
     bool _legacyMode = true;
+
+    SimpleEncoder make_encoder()
+    {
+        SimpleEncoder enc(_ecc, cimbar::Config::symbol_bits(), _colorBits);
+        if (_legacyMode)
+            enc.set_legacy_mode();
+        enc.set_encode_id(_encodeId);
+        return enc;
+    }
+
+    // (re)start the background encode with the current stream + settings
+    void start_pipeline(int canvas_size)
+    {
+        // we generate 5x the amount of required symbol blocks -- unless everything fits in a single frame.
+        // color blocks will contribute to this total, but only symbols are used for the initial calculation.
+        // ... this way, if the color decode is failing, it won't get "stuck" failing to read a single frame.
+        unsigned required = _fes->blocks_required();
+        if (required > cimbar::Config::fountain_chunks_per_frame(cimbar::Config::symbol_bits(), _legacyMode))
+            required = required*5;
+
+        _pipeline.start(_fes, make_encoder(), required, canvas_size);
+        _pipelineStale = false;
+    }
 }
 
 extern "C" {
@@ -86,7 +118,8 @@ int initialize_GL(int width, int height)
 
 // render() and next_frame() could be put in the same function,
 // but it seems cleaner to split them.
-// in any case, we're concerned with frame pacing (some encodes take longer than others)
+// in any case, we're concerned with frame pacing (some encodes take longer than others) --
+// so the encodes (and the rasterizing) happen on the FramePipeline's threads, and next_frame() just picks up the result.
 int render()
 {
 #ifdef CIMBAR_IOS_PLATFORM
@@ -121,55 +154,37 @@ int next_frame()
     if (!_fes)
         return 0;
 
-    // we generate 5x the amount of required symbol blocks -- unless everything fits in a single frame.
-    // color blocks will contribute to this total, but only symbols are used for the initial calculation.
-    // ... this way, if the color decode is failing, it won't get "stuck" failing to read a single frame.
-    unsigned required = _fes->blocks_required();
-    if (required > cimbar::Config::fountain_chunks_per_frame(cimbar::Config::symbol_bits(), _legacyMode))
-        required = required*5;
-    if (_fes->block_count() > required)
-    {
-        _fes->restart();
-        _frameCount = 0;
-    }
+    if (_pipelineStale)
+        start_pipeline(_current.cols);
 
-    SimpleEncoder enc(_ecc, cimbar::Config::symbol_bits(), _colorBits);
-    if (_legacyMode)
-        enc.set_legacy_mode();
-
-    enc.set_encode_id(_encodeId);
-    _next = enc.encode_next(*_fes, _current.cols);
+    bool restarted = false;
+    _next = _pipeline.next(restarted);
+    if (restarted)
+        _frameCount = 0;
     return ++_frameCount;
 #else
     // 原始GLFW实现
     if (!_window or !_fes)
         return 0;
 
-    // we generate 5x the amount of required symbol blocks -- unless everything fits in a single frame.
-    // color blocks will contribute to this total, but only symbols are used for the initial calculation.
-    // ... this way, if the color decode is failing, it won't get "stuck" failing to read a single frame.
-    unsigned required = _fes->blocks_required();
-    if (required > cimbar::Config::fountain_chunks_per_frame(cimbar::Config::symbol_bits(), _legacyMode))
-        required = required*5;
-    if (_fes->block_count() > required)
+    if (_pipelineStale)
+        start_pipeline(_window->width());
+
+    bool restarted = false;
+    _next = _pipeline.next(restarted);
+    if (restarted)
     {
-        _fes->restart();
         _window->shake(0);
         _frameCount = 0;
     }
-
-    SimpleEncoder enc(_ecc, cimbar::Config::symbol_bits(), _colorBits);
-    if (_legacyMode)
-        enc.set_legacy_mode();
-
-    enc.set_encode_id(_encodeId);
-    _next = enc.encode_next(*_fes, _window->width());
     return ++_frameCount;
 #endif
 }
 
 int encode(unsigned char* buffer, unsigned size, int encode_id)
 {
+    _pipeline.stop();
+    _pipelineStale = true;
     _frameCount = 0;
     if (!FountainInit::init())
         std::cerr << "failed FountainInit :(" << std::endl;
@@ -214,6 +229,8 @@ int configure(unsigned color_bits, unsigned ecc, int compression, bool legacy_mo
         _legacyMode = legacy_mode;
 
         // try to refresh the stream
+        _pipeline.stop();
+        _pipelineStale = true;
         if (_fes)
         {
             unsigned buff_size_new = cimbar::Config::fountain_chunk_size(_ecc, cimbar::Config::symbol_bits() + _colorBits, _legacyMode);
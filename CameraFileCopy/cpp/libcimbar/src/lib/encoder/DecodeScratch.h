@@ -0,0 +1,54 @@
+/* This code is subject to the terms of the Mozilla Public License, v.2.0. http://mozilla.org/MPL/2.0/. */
+#pragma once
+
+#include "ReedSolomon.h"
+#include "bit_file/bitbuffer.h"
+#include "cimb_translator/CimbReader.h"
+#include "cimb_translator/PositionData.h"
+
+#include <memory>
+#include <vector>
+
+// everything a frame decode needs to allocate, kept around for the next frame.
+// after the first frame (per configuration), a decode shouldn't need to touch the heap -- OpenCV internals aside.
+// one per thread: decode workers (thread pool threads, etc) live as long as the pool does, so local() is effectively a per-worker arena.
+struct DecodeScratch
+{
+	CimbReader::Scratch reader;
+	std::vector<PositionData> colorPositions;
+	bitbuffer symbolBits;
+	bitbuffer colorBits;
+
+	static DecodeScratch& local()
+	{
+		static thread_local DecodeScratch scratch;
+		return scratch;
+	}
+
+	char* aligned_buffer(unsigned size)
+	{
+		if (_alignedBuffer.size() < size)
+			_alignedBuffer.resize(size);
+		return _alignedBuffer.data();
+	}
+
+	char* rs_buffer(unsigned size)
+	{
+		if (_rsBuffer.size() < size)
+			_rsBuffer.resize(size);
+		return _rsBuffer.data();
+	}
+
+	// building one of these is a lot of tables (and libcorrect builds more on the first decode), so we hang onto it
+	ReedSolomon& rs(unsigned parity)
+	{
+		if (!_rs or _rs->parity() != parity)
+			_rs = std::make_unique<ReedSolomon>(parity);
+		return *_rs;
+	}
+
+protected:
+	std::vector<char> _alignedBuffer;
+	std::vector<char> _rsBuffer;
+	std::unique_ptr<ReedSolomon> _rs;
+};
@@ -1,17 +1,21 @@
 /* This code is subject to the terms of the Mozilla Public License, v.2.0. http://mozilla.org/MPL/2.0/. */
 #pragma once
 
+#include "DecodeScratch.h"
 #include "reed_solomon_stream.h"
 #include "bit_file/bitbuffer.h"
+#include "cimb_translator/CellEvidence.h"
 #include "cimb_translator/CimbDecoder.h"
 #include "cimb_translator/CimbReader.h"
 #include "cimb_translator/Config.h"
-#include "cimb_translator/Interleave.h"
+#include "cimb_translator/DecodeGeometry.h"
 #include "util/File.h"
 #include "util/null_stream.h"
 
 #include <opencv2/opencv.hpp>
+#include <algorithm>
 #include <functional>
+#include <memory>
 #include <string>
 
 class Decoder
@@ -27,8 +31,18 @@ public:
 
 	unsigned decode(std::string filename, std::string output, unsigned color_mode=1);
 
+	const cimbar::GridSpec& grid() const;
+
 	bool load_ccm(std::string filename);
 	bool save_ccm(std::string filename);
+	// the ccm is per thread, and carries over from one decode to the next. That's what we want for a camera -- the lighting
+	// doesn't change much frame to frame. For a pile of unrelated images, it makes each result depend on what came before.
+	void reset_ccm();
+
+	// multi-frame decoding: failed decode_fountain() attempts of the same frame are summed up and retried.
+	// not thread safe! Intended for the single threaded decoders (cimbar CLI, etc)
+	void set_combine_frames(bool combine=true);
+	unsigned combined_looks() const;
 
 protected:
 	template <typename STREAM>
@@ -37,23 +51,40 @@ protected:
 	template <typename STREAM>
 	unsigned do_decode_coupled(CimbReader& reader, STREAM& ostream);
 
+	template <typename STREAM>
+	unsigned do_decode_fountain(CimbReader& reader, STREAM& ostream, unsigned chunk_size, unsigned color_mode);
+
+	template <typename STREAM>
+	unsigned do_decode_evidence(const CellEvidence& evidence, STREAM& ostream, unsigned color_mode);
+
+	unsigned combine_frame(uint64_t frame_key);
+
 protected:
+	const cimbar::GridSpec* _grid; // the grid we decode. Config::grid() when we were constructed.
 	unsigned _eccBytes;
 	unsigned _eccBlockSize;
 	unsigned _colorBits;
 	unsigned _bitsPerOp;
 	unsigned _interleaveBlocks;
 	unsigned _interleavePartitions;
+	std::shared_ptr<const DecodeGeometry> _geometry;
 	CimbDecoder _decoder;
+
+	bool _combineFrames = false;
+	uint64_t _combinedKey = 0; // fountain (encode_id,size) + the frame's first block_id. 0 == unknown.
+	CellEvidence _frameEvidence;
+	CellEvidence _combinedEvidence;
 };
 
 inline Decoder::Decoder(int ecc_bytes, int color_bits, bool interleave)
-	: _eccBytes(ecc_bytes >= 0? ecc_bytes : cimbar::Config::ecc_bytes())
+	: _grid(&cimbar::Config::grid())
+	, _eccBytes(ecc_bytes >= 0? ecc_bytes : cimbar::Config::ecc_bytes())
 	, _eccBlockSize(cimbar::Config::ecc_block_size())
 	, _colorBits(color_bits >= 0? color_bits : cimbar::Config::color_bits())
 	, _bitsPerOp(cimbar::Config::symbol_bits() + _colorBits)
 	, _interleaveBlocks(interleave? cimbar::Config::interleave_blocks() : 0)
 	, _interleavePartitions(cimbar::Config::interleave_partitions())
+	, _geometry(DecodeGeometry::get(_interleaveBlocks, _interleavePartitions))
 	, _decoder(cimbar::Config::symbol_bits(), _colorBits, cimbar::Config::dark(), 0xFF)
 {
 }
@@ -76,38 +107,44 @@ inline unsigned Decoder::do_decode(CimbReader& reader, STREAM& ostream, bool leg
 	if (legacy_mode)
 		return do_decode_coupled(reader, ostream);
 
-	std::vector<unsigned> interleaveLookup = Interleave::interleave_reverse(reader.num_reads(), _interleaveBlocks, _interleavePartitions);
-	std::vector<PositionData> colorPositions;
-	colorPositions.resize(reader.num_reads()); // the number of cells == reader.num_reads(). Can we calculate this from config at compile time? Do we care?
+	DecodeScratch& scratch = DecodeScratch::local();
+	const std::vector<uint16_t>& interleaveLookup = _geometry->interleave_reverse();
+	std::vector<PositionData>& colorPositions = scratch.colorPositions;
+	colorPositions.assign(reader.num_reads(), PositionData()); // the number of cells == reader.num_reads(). Can we calculate this from config at compile time? Do we care?
 
 	unsigned bitsPerSymbol = cimbar::Config::symbol_bits();
 	{
-		bitbuffer symbolBits(cimbar::Config::capacity(bitsPerSymbol));
-		// read symbols first
-		while (!reader.done())
-		{
-			// reader is in charge of the cell index (i) calculation
-			// we can compute the bitindex ('index') here, but only the reader will know the right cell index...
-			PositionData pos;
-			unsigned bits = reader.read(pos);
-
-			unsigned bitPos = interleaveLookup[pos.i] * bitsPerSymbol; // bitspersymbol, *iff* we're in the new mode
-			symbolBits.write(bits, bitPos, bitsPerSymbol);
-
-			// TODO: simplify this function by not storing colorPositions?
-			// this is how it was originally done (see `do_decode_coupled()`), but we should be able to calculate them on the fly now
-			colorPositions[pos.i] = {interleaveLookup[pos.i] * _colorBits, pos.x, pos.y};
-		}
+		bitbuffer& symbolBits = scratch.symbolBits;
+		symbolBits.reset(cimbar::Config::capacity(bitsPerSymbol));
+		// read symbols first. The symbol width is fixed per grid, so the bit writes can be too
+		cimbar::Config::dispatch(*_grid, [&](auto conf) {
+			constexpr unsigned SYMBOLBITS = decltype(conf)::symbol_bits;
+			while (!reader.done())
+			{
+				// reader is in charge of the cell index (i) calculation
+				// we can compute the bitindex ('index') here, but only the reader will know the right cell index...
+				PositionData pos;
+				unsigned bits = reader.read(pos);
+
+				unsigned bitPos = interleaveLookup[pos.i] * bitsPerSymbol; // bitspersymbol, *iff* we're in the new mode
+				symbolBits.write<SYMBOLBITS>(bits, bitPos);
+
+				// TODO: simplify this function by not storing colorPositions?
+				// this is how it was originally done (see `do_decode_coupled()`), but we should be able to calculate them on the fly now
+				colorPositions[pos.i] = {interleaveLookup[pos.i] * _colorBits, pos.x, pos.y};
+			}
+		});
 
 		// flush symbols
-		reed_solomon_stream rss(ostream, _eccBytes, _eccBlockSize);
+		reed_solomon_stream rss(ostream, scratch.rs(_eccBytes), _eccBlockSize, scratch.rs_buffer(_eccBlockSize));
 		symbolBits.flush(rss);
 	}
 
 	// do color correction init, now that we (hopefully) have some fountain headers from the symbol decode
 	reader.init_ccm(_colorBits, _interleaveBlocks, _interleavePartitions, cimbar::Config::fountain_chunks_per_frame(_bitsPerOp, legacy_mode));
 
-	bitbuffer colorBits(cimbar::Config::capacity(_colorBits));
+	bitbuffer& colorBits = scratch.colorBits;
+	colorBits.reset(cimbar::Config::capacity(_colorBits));
 	// then decode colors.
 	for (const PositionData& p : colorPositions)
 	{
@@ -115,7 +152,7 @@ inline unsigned Decoder::do_decode(CimbReader& reader, STREAM& ostream, bool leg
 		colorBits.write(bits, p.i, _colorBits);
 	}
 
-	reed_solomon_stream rss(ostream, _eccBytes, _eccBlockSize);
+	reed_solomon_stream rss(ostream, scratch.rs(_eccBytes), _eccBlockSize, scratch.rs_buffer(_eccBlockSize));
 	// flush() will return the (good) cumulative bytes written to the underlying stream
 	return colorBits.flush(rss);
 }
@@ -125,10 +162,12 @@ inline unsigned Decoder::do_decode_coupled(CimbReader& reader, STREAM& ostream)
 {
 	// the legacy decoder function. Symbol and color bits are grouped together (an individual cell is treated as ex:6 bits),
 	// and the decode is done in two passes only for performance benefits (caching).
-	bitbuffer bb(cimbar::Config::capacity(_bitsPerOp));
-	std::vector<unsigned> interleaveLookup = Interleave::interleave_reverse(reader.num_reads(), _interleaveBlocks, _interleavePartitions);
-	std::vector<PositionData> colorPositions;
-	colorPositions.resize(reader.num_reads());
+	DecodeScratch& scratch = DecodeScratch::local();
+	bitbuffer& bb = scratch.symbolBits;
+	bb.reset(cimbar::Config::capacity(_bitsPerOp));
+	const std::vector<uint16_t>& interleaveLookup = _geometry->interleave_reverse();
+	std::vector<PositionData>& colorPositions = scratch.colorPositions;
+	colorPositions.assign(reader.num_reads(), PositionData());
 
 	// read symbols first
 	while (!reader.done())
@@ -152,24 +191,146 @@ inline unsigned Decoder::do_decode_coupled(CimbReader& reader, STREAM& ostream)
 		bb.write(bits, p.i, _colorBits);
 	}
 
-	reed_solomon_stream rss(ostream, _eccBytes, _eccBlockSize);
+	reed_solomon_stream rss(ostream, scratch.rs(_eccBytes), _eccBlockSize, scratch.rs_buffer(_eccBlockSize));
 	return bb.flush(rss);
 }
 
 template <typename MAT, typename STREAM>
 inline unsigned Decoder::decode(const MAT& img, STREAM& ostream, unsigned color_mode, bool should_preprocess, int color_correction)
 {
-	CimbReader reader(img, _decoder, color_mode, should_preprocess, color_correction);
+	cimbar::Config::Scope scope(*_grid);
+	CimbReader reader(img, _decoder, color_mode, should_preprocess, color_correction, &DecodeScratch::local().reader);
 	return do_decode(reader, ostream, color_mode==0);
 }
 
+template <typename STREAM>
+inline unsigned Decoder::do_decode_evidence(const CellEvidence& evidence, STREAM& ostream, unsigned color_mode)
+{
+	// same bit layout as do_decode() (or do_decode_coupled()), but we get our bits from the summed-up evidence
+	// instead of a CimbReader.
+	const std::vector<uint16_t>& interleaveLookup = _geometry->interleave_reverse();
+	unsigned bitsPerSymbol = cimbar::Config::symbol_bits();
+
+	auto best_color = [&] (unsigned i) {
+		if (!_colorBits)
+			return 0U;
+		auto [r, g, b] = evidence.mean_color(i);
+		return _decoder.get_best_color(r, g, b, color_mode);
+	};
+
+	DecodeScratch& scratch = DecodeScratch::local();
+	if (color_mode == 0)
+	{
+		bitbuffer& bb = scratch.symbolBits;
+		bb.reset(cimbar::Config::capacity(_bitsPerOp));
+		for (unsigned i = 0; i < evidence.num_cells(); ++i)
+		{
+			unsigned bits = evidence.best_symbol(i) | (best_color(i) << bitsPerSymbol);
+			bb.write(bits, interleaveLookup[i] * _bitsPerOp, _bitsPerOp);
+		}
+
+		reed_solomon_stream rss(ostream, scratch.rs(_eccBytes), _eccBlockSize, scratch.rs_buffer(_eccBlockSize));
+		return bb.flush(rss);
+	}
+
+	{
+		bitbuffer& symbolBits = scratch.symbolBits;
+		symbolBits.reset(cimbar::Config::capacity(bitsPerSymbol));
+		for (unsigned i = 0; i < evidence.num_cells(); ++i)
+			symbolBits.write(evidence.best_symbol(i), interleaveLookup[i] * bitsPerSymbol, bitsPerSymbol);
+
+		reed_solomon_stream rss(ostream, scratch.rs(_eccBytes), _eccBlockSize, scratch.rs_buffer(_eccBlockSize));
+		symbolBits.flush(rss);
+	}
+
+	bitbuffer& colorBits = scratch.colorBits;
+	colorBits.reset(cimbar::Config::capacity(_colorBits));
+	for (unsigned i = 0; i < evidence.num_cells(); ++i)
+		colorBits.write(best_color(i), interleaveLookup[i] * _colorBits, _colorBits);
+
+	reed_solomon_stream rss(ostream, scratch.rs(_eccBytes), _eccBlockSize, scratch.rs_buffer(_eccBlockSize));
+	return colorBits.flush(rss);
+}
+
+inline unsigned Decoder::combine_frame(uint64_t frame_key)
+{
+	// frames we couldn't identify (no good fountain headers) are assumed to be more of the same.
+	// if they aren't, the RS check will keep the garbage out of the output stream.
+	if (frame_key and _combinedKey and frame_key != _combinedKey)
+		_combinedEvidence.clear();
+	if (frame_key)
+		_combinedKey = frame_key;
+
+	if (_combinedEvidence.num_cells() != _frameEvidence.num_cells())
+		_combinedEvidence.reset(_frameEvidence.num_cells(), _frameEvidence.num_symbols());
+	_combinedEvidence.add_look(_frameEvidence);
+	return _combinedEvidence.looks();
+}
+
+template <typename STREAM>
+inline unsigned Decoder::do_decode_fountain(CimbReader& reader, STREAM& ostream, unsigned chunk_size, unsigned color_mode)
+{
+	bool legacy_mode = color_mode == 0;
+	if (!_combineFrames)
+	{
+		// small enough for std::function to keep inline (a std::bind isn't)
+		auto update_md_fun = [&reader] (char* buff, unsigned len) { reader.update_metadata(buff, len); };
+		aligned_stream aligner(ostream, chunk_size, 0, update_md_fun, DecodeScratch::local().aligned_buffer(chunk_size));
+		return do_decode(reader, aligner, legacy_mode);
+	}
+
+	// to match up frames, we need the block_id of the first fountain chunk in the frame.
+	// ... which is the first good chunk we see, minus how many chunks came before it.
+	uint64_t frameKey = 0;
+	unsigned chunkIndex = 0;
+	auto update_md_fun = [&] (char* buff, unsigned len) {
+		reader.update_metadata(buff, len);
+		if (!frameKey and len >= FountainMetadata::md_size)
+		{
+			FountainMetadata md(buff, len);
+			frameKey = ((uint64_t)md.id() << 16) | static_cast<uint16_t>(md.block_id() - chunkIndex);
+		}
+		++chunkIndex;
+	};
+
+	reader.capture_evidence(&_frameEvidence);
+	aligned_stream aligner(ostream, chunk_size, 0, update_md_fun);
+	unsigned bytes = do_decode(reader, aligner, legacy_mode);
+	if (!reader.good())
+		return bytes;
+	_frameEvidence.mark_look();
+
+	unsigned perfectBytes = cimbar::Config::capacity(_bitsPerOp) * (_eccBlockSize - _eccBytes) / _eccBlockSize;
+	perfectBytes -= perfectBytes % chunk_size;
+	if (bytes >= perfectBytes)
+	{
+		// nothing to improve on. And whatever we had saved up is probably for this frame, so it's done too.
+		_combinedEvidence.clear();
+		_combinedKey = 0;
+		return bytes;
+	}
+
+	if (combine_frame(frameKey) < 2)
+		return bytes;
+
+	// the fountain sink won't mind seeing the chunks we already got a second time
+	aligned_stream combinedAligner(ostream, chunk_size);
+	unsigned combinedBytes = do_decode_evidence(_combinedEvidence, combinedAligner, color_mode);
+	if (combinedBytes >= perfectBytes)
+	{
+		_combinedEvidence.clear();
+		_combinedKey = 0;
+	}
+	return std::max(bytes, combinedBytes);
+}
+
 template <typename MAT, typename FOUNTAINSTREAM>
 inline unsigned Decoder::decode_fountain(const MAT& img, FOUNTAINSTREAM& ostream,  unsigned color_mode, bool should_preprocess, int color_correction)
 {
-	CimbReader reader(img, _decoder, color_mode, should_preprocess, color_correction);
+	cimbar::Config::Scope scope(*_grid);
+	CimbReader reader(img, _decoder, color_mode, should_preprocess, color_correction, &DecodeScratch::local().reader);
 	bool legacy_mode = color_mode == 0;
 	unsigned chunk_size = cimbar::Config::fountain_chunk_size(_eccBytes, _bitsPerOp, legacy_mode);
-	auto update_md_fun = std::bind(&CimbReader::update_metadata, &reader, std::placeholders::_1, std::placeholders::_2);
 
 	// we don't want to feed the fountain stream bad data, so we eat the decode if we have a mismatch
 	// we still might succeed the decode, in which case (hopefully) the positive bytes we return will
@@ -177,12 +338,10 @@ inline unsigned Decoder::decode_fountain(const MAT& img, FOUNTAINSTREAM& ostream
 	if (ostream.chunk_size() != chunk_size)
 	{
 		null_stream devnull;
-		aligned_stream aligner(devnull, chunk_size, 0, update_md_fun);
-		return do_decode(reader, aligner, legacy_mode);
+		return do_decode_fountain(reader, devnull, chunk_size, color_mode);
 	}
 
-	aligned_stream aligner(ostream, ostream.chunk_size(), 0, update_md_fun);
-	return do_decode(reader, aligner, legacy_mode);
+	return do_decode_fountain(reader, ostream, ostream.chunk_size(), color_mode);
 }
 
 inline unsigned Decoder::decode(std::string filename, std::string output, unsigned color_mode)
@@ -194,6 +353,23 @@ inline unsigned Decoder::decode(std::string filename, std::string output, unsign
 	return decode(img, f, color_mode, false);
 }
 
+inline const cimbar::GridSpec& Decoder::grid() const
+{
+	return *_grid;
+}
+
+inline void Decoder::set_combine_frames(bool combine)
+{
+	_combineFrames = combine;
+	_combinedEvidence.clear();
+	_combinedKey = 0;
+}
+
+inline unsigned Decoder::combined_looks() const
+{
+	return _combinedEvidence.looks();
+}
+
 inline bool Decoder::load_ccm(std::string filename)
 {
 	File f(filename);
@@ -207,6 +383,11 @@ inline bool Decoder::load_ccm(std::string filename)
 	return true;
 }
 
+inline void Decoder::reset_ccm()
+{
+	_decoder.reset_color_correction();
+}
+
 inline bool Decoder::save_ccm(std::string filename)
 {
 	if (not _decoder.get_ccm().active())
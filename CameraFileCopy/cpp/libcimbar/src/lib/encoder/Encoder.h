@@ -4,22 +4,88 @@
 #include "SimpleEncoder.h"
 #include "cimb_translator/Config.h"
 #include "serialize/format.h"
+#include "util/byte_istream.h"
 
 #include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <fstream>
 #include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
 
 class Encoder : public SimpleEncoder
 {
 public:
 	using SimpleEncoder::SimpleEncoder;
 
+	// fountain encodes render this many frames at once. 0 == one per core
+	void set_threads(unsigned threads);
+	// [0-9]. -1 == opencv's default
+	void set_png_compression(int level);
+	// write uncompressed .ppm files instead of .png
+	void set_ppm_output(bool ppm=true);
+
 	unsigned encode(const std::string& filename, std::string output_prefix);
+	unsigned encode(const std::string& filename, const std::function<bool(const cv::Mat&, unsigned)>& on_frame);
 	unsigned encode_fountain(const std::string& filename, std::string output_prefix, int compression_level=16, double redundancy=1.2, int canvas_size=0);
+	// with set_threads(>1), on_frame is called from several threads at once, and frames can arrive out of order
 	unsigned encode_fountain(const std::string& filename, const std::function<bool(const cv::Mat&, unsigned)>& on_frame, int compression_level=16, double redundancy=4.0, int canvas_size=0);
+
+	bool write_frame(const cv::Mat& frame, const std::string& output_prefix, unsigned i) const;
+
+protected:
+	template <typename FSTREAM>
+	unsigned encode_fountain_frames(FSTREAM& fes, const std::function<bool(const cv::Mat&, unsigned)>& on_frame, double redundancy, int canvas_size);
+
+protected:
+	unsigned _threads = 1;
+	int _pngCompression = -1;
+	bool _ppm = false;
 };
 
+inline void Encoder::set_threads(unsigned threads)
+{
+	_threads = threads? threads : std::max(1U, std::thread::hardware_concurrency());
+}
+
+inline void Encoder::set_png_compression(int level)
+{
+	_pngCompression = std::min(level, 9);
+}
+
+inline void Encoder::set_ppm_output(bool ppm)
+{
+	_ppm = ppm;
+}
+
+inline bool Encoder::write_frame(const cv::Mat& frame, const std::string& output_prefix, unsigned i) const
+{
+	// imwrite expects BGR
+	cv::Mat bgr;
+	cv::cvtColor(frame, bgr, cv::COLOR_RGB2BGR);
+
+	if (_ppm)
+		return cv::imwrite(fmt::format("{}_{}.ppm", output_prefix, i), bgr);
+
+	std::vector<int> params;
+	if (_pngCompression >= 0)
+		params = {cv::IMWRITE_PNG_COMPRESSION, _pngCompression};
+	return cv::imwrite(fmt::format("{}_{}.png", output_prefix, i), bgr, params);
+}
+
 inline unsigned Encoder::encode(const std::string& filename, std::string output_prefix)
+{
+	return encode(filename, [this, output_prefix] (const cv::Mat& frame, unsigned i) {
+		write_frame(frame, output_prefix, i);
+		return true;
+	});
+}
+
+inline unsigned Encoder::encode(const std::string& filename, const std::function<bool(const cv::Mat&, unsigned)>& on_frame)
 {
 	std::ifstream f(filename);
 
@@ -30,10 +96,8 @@ inline unsigned Encoder::encode(const std::string& filename, std::string output_
 		if (!frame)
 			break;
 
-		std::string output = fmt::format("{}_{}.png", output_prefix, i);
-		// imwrite expects BGR
-		cv::cvtColor(*frame, *frame, cv::COLOR_RGB2BGR);
-		cv::imwrite(output, *frame);
+		if (!on_frame(*frame, i))
+			break;
 		++i;
 	}
 	return i;
@@ -42,39 +106,98 @@ inline unsigned Encoder::encode(const std::string& filename, std::string output_
 inline unsigned Encoder::encode_fountain(const std::string& filename, const std::function<bool(const cv::Mat&, unsigned)>& on_frame, int compression_level, double redundancy, int canvas_size)
 {
 	std::ifstream infile(filename);
+	infile.seekg(0, std::ios::end);
+	std::streamoff fileSize = infile.tellg();
+	infile.seekg(0, std::ios::beg);
+
+	// too big for the fountain header (even before compression)? Split it up.
+	if (fileSize > (std::streamoff)FountainMetadata::max_file_size)
+	{
+		fountain_segmented_encoder_stream::ptr fes = create_segmented_fountain_encoder(std::make_shared<std::ifstream>(filename, std::ios::binary), compression_level);
+		if (!fes)
+			return 0;
+		fes->set_redundancy(redundancy);
+		return encode_fountain_frames(*fes, on_frame, redundancy, canvas_size);
+	}
+
 	fountain_encoder_stream::ptr fes = create_fountain_encoder(infile, compression_level);
 	if (!fes)
 		return 0;
+	return encode_fountain_frames(*fes, on_frame, redundancy, canvas_size);
+}
 
+template <typename FSTREAM>
+inline unsigned Encoder::encode_fountain_frames(FSTREAM& fes, const std::function<bool(const cv::Mat&, unsigned)>& on_frame, double redundancy, int canvas_size)
+{
 	// ex: with ecc = 30 and 155 byte blocks, we have 60 rs blocks * 125 bytes per block == 7500 bytes to work with.
 	// if fountain_chunks_per_frame() is 10, the fountain_chunk_size will be 750.
 	// we calculate requiredFrames based only on symbol bits, to avoid the situation where the color decode is failing while we're
 	// refusing to generate additional frames...
-	unsigned requiredFrames = fes->blocks_required() * redundancy / cimbar::Config::fountain_chunks_per_frame(_bitsPerSymbol, _coupled and _colorMode==0);
+	unsigned requiredFrames = fes.blocks_required() * redundancy / cimbar::Config::fountain_chunks_per_frame(_bitsPerSymbol, _coupled and _colorMode==0);
 	if (requiredFrames == 0)
 		requiredFrames = 1;
 
-	unsigned i = 0;
-	while (i < requiredFrames)
+	if (_threads <= 1)
 	{
-		auto frame = encode_next(*fes, canvas_size);
-		if (!frame)
-			break;
+		unsigned i = 0;
+		while (i < requiredFrames)
+		{
+			auto frame = encode_next(fes, canvas_size);
+			if (!frame)
+				break;
 
-		if (!on_frame(*frame, i))
-			break;
-		++i;
+			if (!on_frame(*frame, i))
+				break;
+			++i;
+		}
+		return i;
 	}
-	return i;
+
+	// the fountain stream is deterministic, so frame i is always the i-th frame's worth of bytes.
+	// workers take turns pulling bytes off the stream (in order), then render + save in parallel.
+	std::mutex mutex;
+	unsigned next = 0;
+	unsigned failed = requiredFrames; // the first frame we couldn't make. Everything before it is good.
+
+	auto work = [&, this]() {
+		SimpleEncoder enc = *this;
+		std::string buff(fountain_frame_size(), '\0');
+		while (true)
+		{
+			unsigned i;
+			unsigned bytes;
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				if (next >= failed)
+					return;
+				i = next++;
+				fes.read(buff.data(), buff.size());
+				bytes = fes.gcount();
+			}
+
+			cimbar::byte_istream bis(buff.data(), bytes);
+			std::optional<cv::Mat> frame = bytes? enc.encode_next(bis, canvas_size) : std::nullopt;
+			if (!frame or !on_frame(*frame, i))
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				failed = std::min(failed, i);
+			}
+		}
+	};
+
+	std::list<std::thread> threads;
+	for (unsigned t = 1; t < std::min(_threads, requiredFrames); ++t)
+		threads.push_back( std::thread(work) );
+	work();
+	for (std::thread& t : threads)
+		t.join();
+	return failed;
 }
 
 inline unsigned Encoder::encode_fountain(const std::string& filename, std::string output_prefix, int compression_level, double redundancy, int canvas_size)
 {
-	std::function<bool(const cv::Mat&, unsigned)> fun = [output_prefix] (const cv::Mat& frame, unsigned i) {
-		std::string output = fmt::format("{}_{}.png", output_prefix, i);
-		cv::Mat bgr;
-		cv::cvtColor(frame, bgr, cv::COLOR_RGB2BGR);
-		return cv::imwrite(output, bgr);
+	std::function<bool(const cv::Mat&, unsigned)> fun = [this, output_prefix] (const cv::Mat& frame, unsigned i) {
+		return write_frame(frame, output_prefix, i);
 	};
 	return encode_fountain(filename, fun, compression_level, redundancy, canvas_size);
 }
@@ -0,0 +1,264 @@
+/* This code is subject to the terms of the Mozilla Public License, v.2.0. http://mozilla.org/MPL/2.0/. */
+#pragma once
+
+#include "SimpleEncoder.h"
+#include "cimb_translator/CompactFrame.h"
+#include "cimb_translator/FrameRasterizer.h"
+#include "fountain/fountain_encoder_stream.h"
+#include "util/byte_istream.h"
+
+#include <opencv2/opencv.hpp>
+#include <condition_variable>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+// encodes frames ahead of time, so whoever is drawing them just has to pick up the next one.
+// workers take turns pulling a frame's worth of bytes off the fountain stream (in order), then encode *and rasterize*
+// them in parallel -- so next() is a handoff, not a 1024x1024 draw on the render thread. (that's num_frames rendered
+// images sitting in the ring, ~3MB each.)
+// with num_threads == 0, next() does the work itself. (e.g. for wasm builds without threads)
+class FramePipeline
+{
+protected:
+	struct slot
+	{
+		CompactFrame frame;
+		cv::Mat image;
+		uint64_t seq = 0;
+		bool ready = false;
+		bool restarted = false;
+	};
+
+public:
+	FramePipeline(unsigned num_frames=4, unsigned num_threads=2);
+	~FramePipeline();
+
+	// max_blocks: once the stream has produced this many blocks, restart it from the beginning. 0 == never.
+	void start(std::shared_ptr<fountain_encoder_stream> fes, const SimpleEncoder& enc, unsigned max_blocks=0, int canvas_size=0);
+	void stop();
+
+	bool running() const;
+	unsigned num_threads() const;
+	unsigned ready() const;
+
+	// the next frame, in stream order. Waits if it isn't done yet.
+	// restarted == true if the fountain stream looped back to the start for this frame.
+	std::optional<cv::Mat> next(bool& restarted);
+	std::optional<CompactFrame> next_compact(bool& restarted);
+
+protected:
+	void run();
+	bool take(bool& restarted, CompactFrame& frame, cv::Mat& image);
+	unsigned read_frame(std::string& buff, bool& restarted);
+	std::optional<CompactFrame> encode_frame(const std::string& buff, unsigned bytes) const;
+
+protected:
+	std::vector<slot> _slots;
+	unsigned _numThreads;
+	std::list<std::thread> _threads;
+
+	mutable std::mutex _mutex;
+	std::condition_variable _notifyProducer;
+	std::condition_variable _notifyConsumer;
+	bool _running = false;
+	uint64_t _nextSeq = 0; // next frame a worker will claim
+	uint64_t _readSeq = 0; // next frame next() will hand out
+
+	std::shared_ptr<fountain_encoder_stream> _fes;
+	SimpleEncoder _encoder;
+	unsigned _maxBlocks = 0;
+	int _canvasSize = 0;
+};
+
+inline FramePipeline::FramePipeline(unsigned num_frames, unsigned num_threads)
+	: _slots(std::max(1U, num_frames))
+	, _numThreads(num_threads)
+{
+}
+
+inline FramePipeline::~FramePipeline()
+{
+	stop();
+}
+
+inline void FramePipeline::start(std::shared_ptr<fountain_encoder_stream> fes, const SimpleEncoder& enc, unsigned max_blocks, int canvas_size)
+{
+	stop();
+
+	_fes = fes;
+	_encoder = enc;
+	_maxBlocks = max_blocks;
+	_canvasSize = canvas_size;
+
+	_nextSeq = _readSeq = 0;
+	for (slot& s : _slots)
+		s = slot();
+	_running = true;
+
+	for (unsigned i = 0; i < _numThreads; ++i)
+		_threads.push_back( std::thread(&FramePipeline::run, this) );
+}
+
+inline void FramePipeline::stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_running = false;
+	}
+	_notifyProducer.notify_all();
+	_notifyConsumer.notify_all();
+
+	for (std::thread& t : _threads)
+		if (t.joinable())
+			t.join();
+	_threads.clear();
+}
+
+inline bool FramePipeline::running() const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _running;
+}
+
+inline unsigned FramePipeline::num_threads() const
+{
+	return _numThreads;
+}
+
+inline unsigned FramePipeline::ready() const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	unsigned count = 0;
+	for (const slot& s : _slots)
+		count += s.ready;
+	return count;
+}
+
+// call with _mutex held -- the fountain stream isn't thread safe, and the order matters
+inline unsigned FramePipeline::read_frame(std::string& buff, bool& restarted)
+{
+	restarted = false;
+	if (!_fes)
+		return 0;
+
+	if (_maxBlocks and _fes->block_count() > _maxBlocks)
+	{
+		_fes->restart();
+		restarted = true;
+	}
+
+	buff.resize(_encoder.fountain_frame_size());
+	_fes->read(buff.data(), buff.size());
+	return _fes->gcount();
+}
+
+inline std::optional<CompactFrame> FramePipeline::encode_frame(const std::string& buff, unsigned bytes) const
+{
+	if (!bytes)
+		return std::nullopt;
+
+	SimpleEncoder enc = _encoder;
+	cimbar::byte_istream bis(buff.data(), bytes);
+	return enc.encode_next_compact(bis);
+}
+
+inline void FramePipeline::run()
+{
+	std::string buff;
+	while (true)
+	{
+		uint64_t seq;
+		bool restarted;
+		unsigned bytes;
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_notifyProducer.wait(lock, [this]() { return !_running or _nextSeq < _readSeq + _slots.size(); });
+			if (!_running)
+				return;
+
+			seq = _nextSeq++;
+			bytes = read_frame(buff, restarted);
+		}
+
+		std::optional<CompactFrame> frame = encode_frame(buff, bytes);
+		cv::Mat image;
+		if (frame)
+			image = FrameRasterizer::rasterize(*frame, _canvasSize);
+
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			slot& s = _slots[seq % _slots.size()];
+			s.frame = frame? std::move(*frame) : CompactFrame();
+			s.image = image;
+			s.seq = seq;
+			s.restarted = restarted;
+			s.ready = true;
+		}
+		_notifyConsumer.notify_all();
+	}
+}
+
+inline std::optional<cv::Mat> FramePipeline::next(bool& restarted)
+{
+	if (_threads.empty())
+	{
+		std::optional<CompactFrame> frame = next_compact(restarted);
+		if (!frame)
+			return std::nullopt;
+		return FrameRasterizer::rasterize(*frame, _canvasSize);
+	}
+
+	CompactFrame frame;
+	cv::Mat image;
+	if (!take(restarted, frame, image) or image.empty())
+		return std::nullopt;
+	return image;
+}
+
+inline std::optional<CompactFrame> FramePipeline::next_compact(bool& restarted)
+{
+	restarted = false;
+	if (_threads.empty())
+	{
+		if (!_running)
+			return std::nullopt;
+
+		std::string buff;
+		unsigned bytes = read_frame(buff, restarted);
+		return encode_frame(buff, bytes);
+	}
+
+	CompactFrame frame;
+	cv::Mat image;
+	if (!take(restarted, frame, image) or frame.cells.empty())
+		return std::nullopt;
+	return frame;
+}
+
+// the next slot, in order. Waits for a worker to fill it.
+inline bool FramePipeline::take(bool& restarted, CompactFrame& frame, cv::Mat& image)
+{
+	restarted = false;
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		slot& s = _slots[_readSeq % _slots.size()];
+		_notifyConsumer.wait(lock, [this, &s]() { return !_running or (s.ready and s.seq == _readSeq); });
+		if (!_running)
+			return false;
+
+		frame = std::move(s.frame);
+		image = s.image;
+		restarted = s.restarted;
+		s.frame = CompactFrame();
+		s.image = cv::Mat();
+		s.ready = false;
+		++_readSeq;
+	}
+	_notifyProducer.notify_all();
+	return true;
+}
@@ -0,0 +1,217 @@
+/* This code is subject to the terms of the Mozilla Public License, v.2.0. http://mozilla.org/MPL/2.0/. */
+#pragma once
+
+#include "serialize/format.h"
+#include <opencv2/opencv.hpp>
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// streams RGB frames out as uncompressed video, for piping into ffmpeg/mpv/etc:
+//   y4m: YUV4MPEG2, 4:4:4, full range. The header has the size + frame rate.
+//   rgb: raw rgb24. No header -- whoever reads it needs to be told the size and rate.
+// double buffered: write() converts the next frame while a background thread is still writing the last one.
+// path "-" == stdout
+class RawVideoWriter
+{
+public:
+	enum Format { Y4M, RGB };
+
+	static constexpr char Y4M_FRAME[] = "FRAME\n";
+
+public:
+	RawVideoWriter(std::string path, Format format=Y4M, unsigned fps=15);
+	~RawVideoWriter();
+
+	bool good() const;
+	unsigned frames_written() const;
+
+	// every frame must be the same size as the first
+	bool write(const cv::Mat& frame);
+	void close();
+
+	std::string header(int width, int height) const;
+
+protected:
+	void run();
+	void convert(const cv::Mat& frame, std::vector<uint8_t>& buff) const;
+
+protected:
+	FILE* _fp = nullptr;
+	bool _closeFp = false;
+	Format _format;
+	unsigned _fps;
+
+	int _width = 0;
+	int _height = 0;
+	bool _headerDone = false;
+	unsigned _framesWritten = 0;
+
+	// _back is ours (the producer's), _pending is handed off, the writer thread owns _front
+	std::vector<uint8_t> _back;
+	std::vector<uint8_t> _pending;
+	std::vector<uint8_t> _front;
+	bool _hasPending = false;
+	bool _running = true;
+	bool _failed = false;
+
+	mutable std::mutex _mutex;
+	std::condition_variable _cv;
+	std::thread _thread;
+};
+
+inline RawVideoWriter::RawVideoWriter(std::string path, Format format, unsigned fps)
+	: _format(format)
+	, _fps(std::max(1U, fps))
+{
+	if (path == "-")
+		_fp = stdout;
+	else
+	{
+		_fp = fopen(path.c_str(), "wb");
+		_closeFp = true;
+	}
+
+	if (_fp)
+		_thread = std::thread(&RawVideoWriter::run, this);
+}
+
+inline RawVideoWriter::~RawVideoWriter()
+{
+	close();
+}
+
+inline bool RawVideoWriter::good() const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _fp and !_failed;
+}
+
+inline unsigned RawVideoWriter::frames_written() const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _framesWritten;
+}
+
+inline std::string RawVideoWriter::header(int width, int height) const
+{
+	if (_format != Y4M)
+		return "";
+	return fmt::format("YUV4MPEG2 W{} H{} F{}:1 Ip A1:1 C444 XCOLORRANGE=FULL\n", width, height, _fps);
+}
+
+inline bool RawVideoWriter::write(const cv::Mat& frame)
+{
+	if (!good() or frame.empty())
+		return false;
+
+	if (!_width)
+	{
+		_width = frame.cols;
+		_height = frame.rows;
+	}
+	else if (frame.cols != _width or frame.rows != _height)
+		return false;
+
+	_back.clear();
+	if (!_headerDone)
+	{
+		std::string hdr = header(_width, _height);
+		_back.insert(_back.end(), hdr.begin(), hdr.end());
+		_headerDone = true;
+	}
+	convert(frame, _back);
+
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		_cv.wait(lock, [this]() { return !_hasPending or _failed; });
+		if (_failed)
+			return false;
+		std::swap(_back, _pending);
+		_hasPending = true;
+	}
+	_cv.notify_all();
+	return true;
+}
+
+inline void RawVideoWriter::close()
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_running = false;
+	}
+	_cv.notify_all();
+	if (_thread.joinable())
+		_thread.join();
+
+	if (_fp)
+	{
+		fflush(_fp);
+		if (_closeFp)
+			fclose(_fp);
+		_fp = nullptr;
+	}
+}
+
+inline void RawVideoWriter::convert(const cv::Mat& frame, std::vector<uint8_t>& buff) const
+{
+	size_t planeSize = (size_t)_width * _height;
+	size_t offset = buff.size();
+
+	if (_format == RGB)
+	{
+		buff.resize(offset + planeSize*3);
+		cv::Mat out(_height, _width, CV_8UC3, buff.data() + offset);
+		frame.copyTo(out);
+		return;
+	}
+
+	buff.insert(buff.end(), Y4M_FRAME, Y4M_FRAME + sizeof(Y4M_FRAME) - 1);
+	offset = buff.size();
+	buff.resize(offset + planeSize*3);
+
+	// y4m wants planar Y, then Cb, then Cr -- full range BT.601, since that's what the header promises.
+	// (not COLOR_RGB2YUV: that's analog YUV, and its V clips on exactly the saturated colors we encode with)
+	// opencv hands them back as Y, Cr, Cb.
+	cv::Mat ycrcb;
+	cv::cvtColor(frame, ycrcb, cv::COLOR_RGB2YCrCb);
+	uint8_t* y = buff.data() + offset;
+	std::vector<cv::Mat> planes = {
+		cv::Mat(_height, _width, CV_8UC1, y),
+		cv::Mat(_height, _width, CV_8UC1, y + planeSize*2),
+		cv::Mat(_height, _width, CV_8UC1, y + planeSize)
+	};
+	cv::split(ycrcb, planes);
+}
+
+inline void RawVideoWriter::run()
+{
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_cv.wait(lock, [this]() { return _hasPending or !_running; });
+			if (!_hasPending)
+				return;
+			std::swap(_pending, _front);
+			_hasPending = false;
+		}
+		_cv.notify_all();
+
+		bool ok = fwrite(_front.data(), 1, _front.size(), _fp) == _front.size();
+
+		std::lock_guard<std::mutex> lock(_mutex);
+		if (!ok)
+		{
+			_failed = true;
+			_cv.notify_all();
+			return;
+		}
+		++_framesWritten;
+	}
+}
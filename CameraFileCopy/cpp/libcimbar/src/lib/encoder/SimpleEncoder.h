@@ -4,13 +4,18 @@
 #include "reed_solomon_stream.h"
 #include "bit_file/bitreader.h"
 #include "bit_file/bitbuffer.h"
-#include "cimb_translator/CimbWriter.h"
+#include "cimb_translator/CompactFrame.h"
 #include "cimb_translator/Config.h"
+#include "cimb_translator/FrameRasterizer.h"
 #include "compression/zstd_compressor.h"
 #include "fountain/fountain_encoder_stream.h"
+#include "fountain/fountain_segmented_encoder_stream.h"
 
 #include <opencv2/opencv.hpp>
+#include <istream>
+#include <memory>
 #include <optional>
+#include <sstream>
 #include <string>
 
 class SimpleEncoder
@@ -23,14 +28,34 @@ public:
 	template <typename STREAM>
 	std::optional<cv::Mat> encode_next(STREAM& stream, int canvas_size=0);
 
+	// the same frame, as tile indices. Draw it later (or never) with FrameRasterizer.
+	template <typename STREAM>
+	std::optional<CompactFrame> encode_next_compact(STREAM& stream);
+
 	template <typename STREAM>
 	fountain_encoder_stream::ptr create_fountain_encoder(STREAM& stream, int compression_level=6);
 
+	// for files over FountainMetadata::max_file_size. segment_size=0 picks one for us.
+	// segments are read from `source` (and compressed) as they're needed, so it has to be seekable.
+	fountain_segmented_encoder_stream::ptr create_segmented_fountain_encoder(std::shared_ptr<std::istream> source, int compression_level=6, unsigned segment_size=0);
+
+	unsigned fountain_chunk_size() const;
+	unsigned fountain_frame_size() const; // fountain bytes that go into one frame
+
+	const cimbar::GridSpec& grid() const;
+
 protected:
+
+	template <typename STREAM>
+	bool compress_for_fountain(STREAM& stream, int compression_level, std::stringstream& ss);
+
 	template <typename STREAM>
-	std::optional<cv::Mat> encode_next_coupled(STREAM& stream, int canvas_size=0);
+	std::optional<CompactFrame> encode_next_coupled(STREAM& stream);
+
+	CompactFrame make_frame() const;
 
 protected:
+	const cimbar::GridSpec* _grid; // the grid we encode for. Config::grid() when we were constructed.
 	unsigned _eccBytes;
 	unsigned _eccBlockSize;
 	unsigned _bitsPerSymbol;
@@ -42,7 +67,8 @@ protected:
 };
 
 inline SimpleEncoder::SimpleEncoder(int ecc_bytes, unsigned bits_per_symbol, int bits_per_color)
-	: _eccBytes(ecc_bytes >= 0? ecc_bytes : cimbar::Config::ecc_bytes())
+	: _grid(&cimbar::Config::grid())
+	, _eccBytes(ecc_bytes >= 0? ecc_bytes : cimbar::Config::ecc_bytes())
 	, _eccBlockSize(cimbar::Config::ecc_block_size())
 	, _bitsPerSymbol(bits_per_symbol? bits_per_symbol : cimbar::Config::symbol_bits())
 	, _bitsPerColor(bits_per_color >= 0? bits_per_color : cimbar::Config::color_bits())
@@ -66,16 +92,26 @@ inline void SimpleEncoder::set_encode_id(uint8_t encode_id)
 template <typename STREAM>
 inline std::optional<cv::Mat> SimpleEncoder::encode_next(STREAM& stream, int canvas_size)
 {
+	std::optional<CompactFrame> frame = encode_next_compact(stream);
+	if (!frame)
+		return std::nullopt;
+	return FrameRasterizer::rasterize(*frame, canvas_size);
+}
+
+template <typename STREAM>
+inline std::optional<CompactFrame> SimpleEncoder::encode_next_compact(STREAM& stream)
+{
+	cimbar::Config::Scope scope(*_grid);
 	if (_coupled)
-		return encode_next_coupled(stream, canvas_size);
+		return encode_next_coupled(stream);
 
 	if (!stream.good())
 		return std::nullopt;
 
 	unsigned bits_per_op = _bitsPerColor + _bitsPerSymbol;
-	CimbWriter writer(_bitsPerSymbol, _bitsPerColor, _dark, _colorMode, canvas_size);
+	CompactFrame frame = make_frame();
 
-	unsigned numCells = writer.num_cells();
+	unsigned numCells = cimbar::Config::total_cells();
 	bitbuffer bb(cimbar::Config::capacity(bits_per_op));
 
 	unsigned bitPos = 0;
@@ -115,19 +151,15 @@ inline std::optional<cv::Mat> SimpleEncoder::encode_next(STREAM& stream, int can
 		}
 	}
 
-	// dump whatever we have to image
+	// dump whatever we have to the frame
+	frame.cells.reserve(numCells);
 	for (bitPos = 0; bitPos < endBitPos; bitPos+=bits_per_op)
-	{
-		unsigned bits = bb.read(bitPos, bits_per_op);
-		writer.write(bits);
-	}
-
-	// return what we've got
-	return writer.image();
+		frame.cells.push_back(bb.read(bitPos, bits_per_op));
+	return frame;
 }
 
 template <typename STREAM>
-inline std::optional<cv::Mat> SimpleEncoder::encode_next_coupled(STREAM& stream, int canvas_size)
+inline std::optional<CompactFrame> SimpleEncoder::encode_next_coupled(STREAM& stream)
 {
 	// the old way. Symbol and color bits are mixed together, limiting the color correction possibilities
 	// but potentially allowing a lack of errors in one channel to correct errors in the other.
@@ -138,7 +170,9 @@ inline std::optional<cv::Mat> SimpleEncoder::encode_next_coupled(STREAM& stream,
 		return std::nullopt;
 
 	unsigned bits_per_op = _bitsPerColor + _bitsPerSymbol;
-	CimbWriter writer(_bitsPerSymbol, _bitsPerColor, _dark, _colorMode, canvas_size);
+	unsigned numCells = cimbar::Config::total_cells();
+	CompactFrame frame = make_frame();
+	frame.cells.reserve(numCells);
 
 	reed_solomon_stream rss(stream, _eccBytes, _eccBlockSize);
 	bitreader br;
@@ -151,29 +185,55 @@ inline std::optional<cv::Mat> SimpleEncoder::encode_next_coupled(STREAM& stream,
 		while (!br.empty())
 		{
 			unsigned bits = br.read(bits_per_op);
-			if (!br.partial())
-				writer.write(bits);
+			if (!br.partial() and frame.cells.size() < numCells)
+				frame.cells.push_back(bits);
 		}
-		if (writer.done())
-			return writer.image();
+		if (frame.cells.size() >= numCells)
+			return frame;
 	}
 	// we don't have a full frame, but return what we've got
-	return writer.image();
+	return frame;
 }
 
-template <typename STREAM>
-inline fountain_encoder_stream::ptr SimpleEncoder::create_fountain_encoder(STREAM& stream, int compression_level)
+inline CompactFrame SimpleEncoder::make_frame() const
 {
-	unsigned chunk_size = cimbar::Config::fountain_chunk_size(_eccBytes, _bitsPerColor + _bitsPerSymbol, (_colorMode==0 and _coupled));
+	CompactFrame frame;
+	frame.symbol_bits = _bitsPerSymbol;
+	frame.color_bits = _bitsPerColor;
+	frame.dark = _dark;
+	frame.color_mode = _colorMode;
+	frame.grid = _grid;
+	return frame;
+}
 
-	std::stringstream ss;
+inline unsigned SimpleEncoder::fountain_chunk_size() const
+{
+	cimbar::Config::Scope scope(*_grid);
+	return cimbar::Config::fountain_chunk_size(_eccBytes, _bitsPerColor + _bitsPerSymbol, (_colorMode==0 and _coupled));
+}
+
+inline unsigned SimpleEncoder::fountain_frame_size() const
+{
+	bool legacy = (_colorMode==0 and _coupled);
+	return fountain_chunk_size() * cimbar::Config::fountain_chunks_per_frame(_bitsPerColor + _bitsPerSymbol, legacy);
+}
+
+inline const cimbar::GridSpec& SimpleEncoder::grid() const
+{
+	return *_grid;
+}
+
+template <typename STREAM>
+inline bool SimpleEncoder::compress_for_fountain(STREAM& stream, int compression_level, std::stringstream& ss)
+{
+	unsigned chunk_size = fountain_chunk_size();
 	if (compression_level <= 0)
 		ss << stream.rdbuf();
 	else
 	{
 		cimbar::zstd_compressor<std::stringstream> f;
 		if (!f.compress(stream))
-			return nullptr;
+			return false;
 
 		// find size of compressed zstd stream, and pad it if necessary.
 		size_t compressedSize = f.size();
@@ -181,7 +241,31 @@ inline fountain_encoder_stream::ptr SimpleEncoder::create_fountain_encoder(STREA
 			f.pad(chunk_size - compressedSize + 1);
 		ss = std::move(f);
 	}
+	return true;
+}
 
-	return fountain_encoder_stream::create(ss, chunk_size, _encodeId);
+template <typename STREAM>
+inline fountain_encoder_stream::ptr SimpleEncoder::create_fountain_encoder(STREAM& stream, int compression_level)
+{
+	std::stringstream ss;
+	if (!compress_for_fountain(stream, compression_level, ss))
+		return nullptr;
+	return fountain_encoder_stream::create(ss, fountain_chunk_size(), _encodeId);
 }
 
+inline fountain_segmented_encoder_stream::ptr SimpleEncoder::create_segmented_fountain_encoder(std::shared_ptr<std::istream> source, int compression_level, unsigned segment_size)
+{
+	fountain_segmented_encoder_stream::packer pack = nullptr;
+	if (compression_level > 0)
+		// each segment is its own run of zstd frames. Put back to back, they decompress as one file
+		pack = [compression_level](std::string&& raw) {
+			cimbar::zstd_compressor<std::stringstream> f;
+			f.set_compression_level(compression_level);
+			if (!f.write(raw.data(), raw.size()))
+				return std::string();
+			raw.clear();
+			raw.shrink_to_fit();
+			return f.str();
+		};
+	return fountain_segmented_encoder_stream::create(source, fountain_chunk_size(), _encodeId, segment_size, pack);
+}
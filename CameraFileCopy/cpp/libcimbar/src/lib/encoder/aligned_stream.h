@@ -8,9 +8,11 @@ template <typename STREAM>
 class aligned_stream
 {
 public:
-	aligned_stream(STREAM& stream, unsigned align_increment, unsigned align_offset=0, const std::function<void(char*,size_t)>& on_flush=nullptr)
+	// buffer: optional, caller owned, at least align_increment bytes. Otherwise we allocate our own.
+	aligned_stream(STREAM& stream, unsigned align_increment, unsigned align_offset=0, const std::function<void(char*,size_t)>& on_flush=nullptr, char* buffer=nullptr)
 		: _stream(stream)
-		, _buffer(align_increment, 0)
+		, _ownBuffer(buffer? 0 : align_increment, 0)
+		, _buffer(buffer? buffer : _ownBuffer.data())
 		, _offset(0)
 		, _alignOffset(align_offset)
 		, _alignIncrement(align_increment)
@@ -75,7 +77,7 @@ public:
 				{
 					// we could do two writes here, but fountain_decoder_stream would like a contiguous buffer.
 					// and since that's our primary use case, we'll give it one.
-					std::copy(data, data+writeLen, _buffer.data()+_offset);
+					std::copy(data, data+writeLen, _buffer+_offset);
 					_offset += writeLen;
 					flush();
 				}
@@ -87,7 +89,7 @@ public:
 
 			// if we need to store it for later
 			unsigned writeLen = length;
-			std::copy(data, data+writeLen, _buffer.data()+_offset);
+			std::copy(data, data+writeLen, _buffer+_offset);
 			_offset += writeLen;
 			length = 0;
 		}
@@ -107,9 +109,9 @@ public:
 	{
 		if (_offset > 0)
 		{
-			_stream.write(_buffer.data(), _offset);
+			_stream.write(_buffer, _offset);
 			if (_onFlush)
-				_onFlush(_buffer.data(), _offset);
+				_onFlush(_buffer, _offset);
 			// notify callback w/ header bytes!
 		}
 		_totalCount += _offset;
@@ -119,7 +121,8 @@ public:
 
 protected:
 	STREAM& _stream;
-	std::vector<char> _buffer;
+	std::vector<char> _ownBuffer;
+	char* _buffer;
 	unsigned _offset;
 	unsigned _alignOffset;
 	unsigned _alignIncrement;
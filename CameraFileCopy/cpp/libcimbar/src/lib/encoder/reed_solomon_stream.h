@@ -4,6 +4,7 @@
 #include "ReedSolomon.h"
 #include "encoder/aligned_stream.h"
 #include <fstream>
+#include <memory>
 #include <sstream>
 #include <vector>
 
@@ -12,11 +13,25 @@ class reed_solomon_stream
 {
 public:
 	reed_solomon_stream(STREAM& stream, unsigned ecc, unsigned buffer_size)
-		: _stream(stream)
-		, _rs(ecc)
+		: _ownBuffer(buffer_size, 0)
+		, _buffer(_ownBuffer.data())
+		, _bufferSize(buffer_size)
+		, _stream(stream)
+		, _ownRs(std::make_unique<ReedSolomon>(ecc))
+		, _rs(*_ownRs)
+		, _good(stream.good())
+	{
+	}
+
+	// borrow a (long lived) ReedSolomon and buffer, so we don't build new ones every frame.
+	// buffer must be at least buffer_size bytes.
+	reed_solomon_stream(STREAM& stream, ReedSolomon& rs, unsigned buffer_size, char* buffer)
+		: _buffer(buffer)
+		, _bufferSize(buffer_size)
+		, _stream(stream)
+		, _rs(rs)
 		, _good(stream.good())
 	{
-		_buffer.resize(buffer_size, 0);
 	}
 
 	bool good() const
@@ -32,9 +47,9 @@ public:
 	std::streamsize readsome(char* data=NULL, unsigned length=0)
 	{
 		if (!data)
-			data = _buffer.data();
+			data = _buffer;
 		if (!length)
-			length = _buffer.size();
+			length = _bufferSize;
 
 		_stream.read(data, length - _rs.parity());
 		std::streamsize bytes = _stream.gcount();
@@ -48,7 +63,7 @@ public:
 
 		// else
 		_rs.encode(data, bytes, data);
-		return _buffer.size();
+		return _bufferSize;
 	}
 
 	reed_solomon_stream& write(const char* data, unsigned length)
@@ -62,29 +77,32 @@ public:
 		}
 
 		// else
-		while (length >= _buffer.size())
+		while (length >= _bufferSize)
 		{
-			ssize_t bytes = _rs.decode(data, _buffer.size(), _buffer.data());
+			ssize_t bytes = _rs.decode(data, _bufferSize, _buffer);
 			if (bytes <= 0)
-				_stream << ReedSolomon::BadChunk(_buffer.size() - _rs.parity());
+				_stream << ReedSolomon::BadChunk(_bufferSize - _rs.parity());
 			else
-				_stream.write(_buffer.data(), bytes);
+				_stream.write(_buffer, bytes);
 
-			length -= _buffer.size();
-			data += _buffer.size();
+			length -= _bufferSize;
+			data += _bufferSize;
 		}
 		return *this;
 	}
 
 	const char* buffer() const
 	{
-		return _buffer.data();
+		return _buffer;
 	}
 
 protected:
-	std::vector<char> _buffer;
+	std::vector<char> _ownBuffer;
+	char* _buffer;
+	unsigned _bufferSize;
 	STREAM& _stream;
-	ReedSolomon _rs;
+	std::unique_ptr<ReedSolomon> _ownRs;
+	ReedSolomon& _rs;
 	bool _good;
 };
 
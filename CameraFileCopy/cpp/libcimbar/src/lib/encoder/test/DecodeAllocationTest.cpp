@@ -0,0 +1,165 @@
+/* This code is subject to the terms of the Mozilla Public License, v.2.0. http://mozilla.org/MPL/2.0/. */
+#include "unittest.h"
+#include "TestHelpers.h"
+
+#include "encoder/Decoder.h"
+#include "encoder/Encoder.h"
+
+#include <cstdlib>
+#include <fstream>
+#include <new>
+#include <string>
+
+// count every operator new on this thread, while we're looking.
+namespace {
+	thread_local bool countAllocations = false;
+	thread_local size_t numAllocations = 0;
+}
+
+void* operator new(std::size_t size)
+{
+	if (countAllocations)
+		++numAllocations;
+	if (void* p = std::malloc(size? size : 1))
+		return p;
+	throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+	std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+	std::free(p);
+}
+
+namespace {
+	class chunk_counter
+	{
+	public:
+		chunk_counter(unsigned chunk_size)
+			: _chunkSize(chunk_size)
+		{}
+
+		chunk_counter& write(const char*, unsigned length)
+		{
+			_count += length;
+			return *this;
+		}
+
+		bool good() const
+		{
+			return true;
+		}
+
+		long tellp() const
+		{
+			return _count;
+		}
+
+		unsigned chunk_size() const
+		{
+			return _chunkSize;
+		}
+
+	protected:
+		unsigned _chunkSize;
+		long _count = 0;
+	};
+
+	// the one thing we don't count: cv::Mat buffers (and their UMatData header, which OpenCV news up).
+	// the CimbReader's preprocessing and the ccm solve are OpenCV's business, and that's where those come from.
+	// everything else decode_fountain() does -- positions, symbol/color reads, bitbuffers, ecc, chunking -- counts.
+	class uncounted_mat_allocator : public cv::MatAllocator
+	{
+	public:
+		// Mats we allocate (the thread local scratch, say) can outlive the test, so this never goes away
+		static uncounted_mat_allocator* get()
+		{
+			static uncounted_mat_allocator* alloc = new uncounted_mat_allocator();
+			return alloc;
+		}
+
+		cv::UMatData* allocate(int dims, const int* sizes, int type, void* data, size_t* step, cv::AccessFlag flags, cv::UMatUsageFlags usageFlags) const override
+		{
+			pause p;
+			cv::UMatData* u = _std->allocate(dims, sizes, type, data, step, flags, usageFlags);
+			if (u)
+				u->currAllocator = u->prevAllocator = this;
+			return u;
+		}
+
+		bool allocate(cv::UMatData* u, cv::AccessFlag accessFlags, cv::UMatUsageFlags usageFlags) const override
+		{
+			pause p;
+			return _std->allocate(u, accessFlags, usageFlags);
+		}
+
+		void deallocate(cv::UMatData* u) const override
+		{
+			pause p;
+			_std->deallocate(u);
+		}
+
+	protected:
+		struct pause
+		{
+			pause() : _was(countAllocations) { countAllocations = false; }
+			~pause() { countAllocations = _was; }
+			bool _was;
+		};
+
+		cv::MatAllocator* _std = cv::Mat::getStdAllocator();
+	};
+
+	struct uncounted_mats
+	{
+		uncounted_mats() { cv::Mat::setDefaultAllocator(uncounted_mat_allocator::get()); }
+		~uncounted_mats() { cv::Mat::setDefaultAllocator(_prev); }
+		cv::MatAllocator* _prev = cv::Mat::getDefaultAllocator();
+	};
+
+	unsigned countedDecode(Decoder& dec, const cv::Mat& img, size_t& allocations)
+	{
+		unsigned chunkSize = cimbar::Config::fountain_chunk_size(30, cimbar::Config::symbol_bits() + cimbar::Config::color_bits(), false);
+		chunk_counter sink(chunkSize);
+
+		numAllocations = 0;
+		countAllocations = true;
+		unsigned bytes = dec.decode_fountain(img, sink, 1, false, 1);
+		countAllocations = false;
+
+		allocations = numAllocations;
+		return bytes;
+	}
+}
+
+TEST_CASE( "DecodeAllocationTest/testSteadyState", "[unit]" )
+{
+	std::ifstream infile(TestCimbar::getProjectDir() + "/LICENSE");
+	Encoder enc(30, 4, 2);
+	fountain_encoder_stream::ptr fes = enc.create_fountain_encoder(infile);
+	assertTrue( fes );
+
+	std::optional<cv::Mat> frame = enc.encode_next(*fes);
+	assertTrue( frame );
+
+	uncounted_mats matScope;
+	Decoder dec(30);
+	size_t allocations = 0;
+
+	// first frame: the (thread local) scratch buffers get built, if an earlier test hasn't already
+	assertEquals( 7500, countedDecode(dec, *frame, allocations) );
+
+	// after that, nothing
+	for (int i = 0; i < 3; ++i)
+	{
+		frame = enc.encode_next(*fes);
+		assertTrue( frame );
+
+		assertEquals( 7500, countedDecode(dec, *frame, allocations) );
+		assertEquals( 0, allocations );
+	}
+}
@@ -6,14 +6,22 @@
 #include "encoder/Encoder.h"
 
 #include "compression/zstd_decompressor.h"
+#include "fountain/concurrent_fountain_decoder_sink.h"
 #include "fountain/fountain_decoder_sink.h"
 #include "image_hash/average_hash.h"
 #include "serialize/format.h"
 #include "util/File.h"
 #include "util/MakeTempDirectory.h"
 
+#include <atomic>
+#include <experimental/filesystem>
 #include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
 #include <string>
+#include <thread>
+#include <vector>
 
 TEST_CASE( "EncoderRoundTripTest/testFountain.Pad", "[unit]" )
 {
@@ -122,3 +130,217 @@ TEST_CASE( "EncoderRoundTripTest/testStreaming", "[unit]" )
 	assertEquals( 16727, decodedContents.size() );
 	assertStringContains( "Mozilla Public License Version 2.0", decodedContents );
 }
+
+TEST_CASE( "EncoderRoundTripTest/testFountain.Parallel", "[unit]" )
+{
+	// the same frames, decoded one at a time and on 4 threads (a Decoder each, one shared sink), should recover the same file.
+	// that's what `cimbar --threads` promises.
+	MakeTempDirectory tempdir;
+
+	// incompressible, so it takes a few frames
+	std::string input(30000, 0);
+	std::mt19937 rng(42);
+	for (char& c : input)
+		c = rng() & 0xFF;
+	std::stringstream instream(input);
+
+	Encoder enc(30, 4, 2);
+	fountain_encoder_stream::ptr fes = enc.create_fountain_encoder(instream);
+	assertTrue( fes );
+
+	std::vector<cv::Mat> frames;
+	for (int i = 0; i < 10; ++i)
+	{
+		std::optional<cv::Mat> frame = enc.encode_next(*fes);
+		assertTrue( frame );
+		frames.push_back(*frame);
+	}
+	// a couple of bad ones, so not every frame gets a clean ccm of its own
+	for (unsigned i : {1, 4})
+		frames[i](cv::Rect(0, frames[i].rows/3, frames[i].cols, frames[i].rows/3)) = cv::Scalar(0, 0, 0);
+
+	unsigned chunkSize = cimbar::Config::fountain_chunk_size(30, 6, false);
+	std::string serialDir = tempdir.path() / "serial";
+	std::string parallelDir = tempdir.path() / "parallel";
+	std::experimental::filesystem::create_directory(serialDir);
+	std::experimental::filesystem::create_directory(parallelDir);
+
+	std::vector<std::string> serialDone;
+	{
+		// like `cimbar --threads 1`: the bad frames borrow the ccm from the frame before them
+		Decoder dec(30);
+		fountain_decoder_sink<cimbar::zstd_decompressor<std::ofstream>> fds(serialDir, chunkSize);
+		for (const cv::Mat& frame : frames)
+			dec.decode_fountain(frame, fds, 1);
+		serialDone = fds.get_done();
+	}
+
+	std::vector<std::string> parallelDone;
+	{
+		concurrent_fountain_decoder_sink<cimbar::zstd_decompressor<std::ofstream>> fds(parallelDir, chunkSize);
+		fds.set_lossless();
+
+		// like `cimbar --threads 4`: every frame does its own color correction
+		std::atomic<unsigned> next = 0;
+		std::vector<std::thread> workers;
+		for (unsigned t = 0; t < 4; ++t)
+			workers.emplace_back([&]() {
+				Decoder dec(30);
+				for (unsigned i = next++; i < frames.size(); i = next++)
+				{
+					dec.reset_ccm();
+					dec.decode_fountain(frames[i], fds, 1);
+				}
+			});
+		for (std::thread& t : workers)
+			t.join();
+		fds.stop();
+
+		assertEquals( 0, fds.dropped() );
+		parallelDone = fds.get_done();
+	}
+
+	assertEquals( 1, serialDone.size() );
+	assertEquals( serialDone, parallelDone );
+
+	std::string serialContents = File(serialDir + "/" + serialDone.front()).read_all();
+	std::string parallelContents = File(parallelDir + "/" + parallelDone.front()).read_all();
+	assertEquals( input.size(), serialContents.size() );
+	assertTrue( input == serialContents );
+	assertTrue( serialContents == parallelContents );
+}
+
+TEST_CASE( "EncoderRoundTripTest/testSegmented", "[unit]" )
+{
+	MakeTempDirectory tempdir;
+
+	// tiny segments, so LICENSE gets a few. Each one is compressed on its own, and they decompress back to back
+	Encoder enc(30, 4, 2);
+	fountain_segmented_encoder_stream::ptr fes = enc.create_segmented_fountain_encoder(
+		std::make_shared<std::ifstream>(TestCimbar::getProjectDir() + "/LICENSE"), 6, 4096);
+	assertTrue( fes );
+	assertTrue( fes->good() );
+	assertEquals( 5, fes->num_segments() );
+
+	unsigned chunkSize = enc.fountain_chunk_size();
+	fountain_decoder_sink<cimbar::zstd_decompressor<std::ofstream>> fds(tempdir.path(), chunkSize);
+
+	std::vector<char> buff(chunkSize);
+	for (unsigned i = 0; i < 1000 and fds.num_done() == 0; ++i)
+	{
+		assertEquals( chunkSize, fes->readsome(buff.data(), buff.size()) );
+		fds.decode_frame(buff.data(), buff.size());
+	}
+
+	assertEquals( 1, fds.num_done() );
+	std::string decodedContents = File(tempdir.path() / fds.get_done().front()).read_all();
+	assertEquals( File(TestCimbar::getProjectDir() + "/LICENSE").read_all(), decodedContents );
+}
+
+TEST_CASE( "EncoderRoundTripTest/testStreaming.5x5", "[unit]" )
+{
+	MakeTempDirectory tempdir;
+
+	std::ifstream infile(TestCimbar::getProjectDir() + "/LICENSE");
+
+	// the encoder and decoder remember the grid they were made with...
+	std::unique_ptr<Encoder> enc;
+	std::unique_ptr<Decoder> dec;
+	unsigned chunkSize;
+	{
+		cimbar::Config::Scope scope(cimbar::Grid5x5);
+		enc = std::make_unique<Encoder>();
+		dec = std::make_unique<Decoder>();
+		chunkSize = cimbar::Config::fountain_chunk_size(40, 4, false);
+	}
+	assertEquals( 1320, chunkSize );
+	assertEquals( chunkSize, enc->fountain_chunk_size() );
+
+	fountain_encoder_stream::ptr fes = enc->create_fountain_encoder(infile);
+	assertTrue( fes );
+	fountain_decoder_sink<cimbar::zstd_decompressor<std::ofstream>> fds(tempdir.path(), chunkSize);
+
+	// ... so the default (8x8) grid out here doesn't matter
+	for (int i = 0; i < 100; ++i)
+	{
+		std::optional<cv::Mat> frame = enc->encode_next(*fes);
+		assertTrue( frame );
+		assertEquals( 988, frame->cols );
+
+		unsigned bytesDecoded = dec->decode_fountain(*frame, fds, 1);
+		assertEquals( 10560, bytesDecoded );
+
+		if (fds.num_done())
+			break;
+	}
+
+	assertEquals( 1, fds.num_done() );
+	std::string decodedContents = File(tempdir.path() / fds.get_done().front()).read_all();
+	assertStringContains( "Mozilla Public License Version 2.0", decodedContents );
+
+	// and an 8x8 decoder in the same process doesn't care what we just did
+	assertEquals( 8, Decoder().grid().cell_size );
+}
+
+TEST_CASE( "EncoderRoundTripTest/testFountain.CombineFrames", "[unit]" )
+{
+	MakeTempDirectory tempdir;
+
+	std::ifstream infile(TestCimbar::getProjectDir() + "/LICENSE");
+	Encoder enc(30, 4, 2);
+	fountain_encoder_stream::ptr fes = enc.create_fountain_encoder(infile);
+	assertTrue( fes );
+
+	std::optional<cv::Mat> frame = enc.encode_next(*fes);
+	assertTrue( frame );
+
+	// two bad looks at the same frame, each missing a different half.
+	// every reed solomon block is spread across the whole frame, so half a frame isn't enough to get any of them back
+	cv::Mat top = frame->clone();
+	top(cv::Rect(0, 0, top.cols, top.rows/2)) = cv::Scalar(0, 0, 0);
+	cv::Mat bottom = frame->clone();
+	bottom(cv::Rect(0, bottom.rows/2, bottom.cols, bottom.rows/2)) = cv::Scalar(0, 0, 0);
+
+	unsigned chunkSize = cimbar::Config::fountain_chunk_size(30, 6, false);
+	std::string aloneDir = tempdir.path() / "alone";
+	std::string combinedDir = tempdir.path() / "combined";
+	std::experimental::filesystem::create_directory(aloneDir);
+	std::experimental::filesystem::create_directory(combinedDir);
+
+	// on their own, neither look gets us the file -- in any order
+	{
+		Decoder dec(30);
+		fountain_decoder_sink<cimbar::zstd_decompressor<std::ofstream>> fds(aloneDir, chunkSize);
+		assertTrue( dec.decode_fountain(top, fds, 1) < 7500 );
+		assertTrue( dec.decode_fountain(bottom, fds, 1) < 7500 );
+		assertTrue( dec.decode_fountain(top, fds, 1) < 7500 );
+		assertEquals( 0, fds.num_done() );
+		assertEquals( 0, dec.combined_looks() );
+	}
+
+	// together, they're a whole frame. (where one look is black, the other look's evidence wins)
+	Decoder dec(30);
+	dec.set_combine_frames();
+	fountain_decoder_sink<cimbar::zstd_decompressor<std::ofstream>> fds(combinedDir, chunkSize);
+
+	assertTrue( dec.decode_fountain(top, fds, 1) < 7500 );
+	assertEquals( 1, dec.combined_looks() );
+	assertEquals( 0, fds.num_done() );
+
+	assertEquals( 7500, dec.decode_fountain(bottom, fds, 1) );
+	assertEquals( 1, fds.num_done() );
+	std::string decodedContents = File(combinedDir + "/" + fds.get_done().front()).read_all();
+	assertStringContains( "Mozilla Public License Version 2.0", decodedContents );
+	// a perfect (combined) decode means we're done with this frame
+	assertEquals( 0, dec.combined_looks() );
+
+	// a clean frame doesn't need any help
+	assertEquals( 7500, dec.decode_fountain(*frame, fds, 1) );
+	assertEquals( 0, dec.combined_looks() );
+
+	// turning it off throws away what we had
+	dec.decode_fountain(top, fds, 1);
+	assertEquals( 1, dec.combined_looks() );
+	dec.set_combine_frames(false);
+	assertEquals( 0, dec.combined_looks() );
+}
@@ -83,6 +83,45 @@ TEST_CASE( "EncoderTest/testFountain.B", "[unit]" )
 	}
 }
 
+TEST_CASE( "EncoderTest/testFountain.Threads", "[unit]" )
+{
+	MakeTempDirectory tempdir;
+
+	std::string inputFile = TestCimbar::getProjectDir() + "/LICENSE";
+	std::string outPrefix = tempdir.path() / "encoder.fountain";
+
+	// same frames as the serial encode, even if they're finished out of order
+	Encoder enc(40, 4, 2);
+	enc.set_threads(4);
+	assertEquals( 4, enc.encode_fountain(inputFile, outPrefix, 0) );
+
+	std::vector<uint64_t> hashes = {0xcf09eb067c876ea6, 0x4697a76025a40c43, 0x666aaca0ec8d6d43, 0xe6e44ca8ec33a260};
+	for (unsigned i = 0; i < hashes.size(); ++i)
+	{
+		DYNAMIC_SECTION( "are we correct? : " << i )
+		{
+			std::string path = fmt::format("{}_{}.png", outPrefix, i);
+			cv::Mat img = cv::imread(path);
+			assertEquals( hashes[i], image_hash::average_hash(img) );
+		}
+	}
+}
+
+TEST_CASE( "EncoderTest/testFountain.Ppm", "[unit]" )
+{
+	MakeTempDirectory tempdir;
+
+	std::string inputFile = TestCimbar::getProjectDir() + "/LICENSE";
+	std::string outPrefix = tempdir.path() / "encoder.fountain";
+
+	Encoder enc(40, 4, 2);
+	enc.set_ppm_output();
+	assertEquals( 4, enc.encode_fountain(inputFile, outPrefix, 0) );
+
+	cv::Mat img = cv::imread(fmt::format("{}_0.ppm", outPrefix));
+	assertEquals( 0xcf09eb067c876ea6, image_hash::average_hash(img) );
+}
+
 TEST_CASE( "EncoderTest/testFountain.Compress", "[unit]" )
 {
 	MakeTempDirectory tempdir;
@@ -0,0 +1,91 @@
+/* This code is subject to the terms of the Mozilla Public License, v.2.0. http://mozilla.org/MPL/2.0/. */
+#include "unittest.h"
+#include "TestHelpers.h"
+
+#include "encoder/FramePipeline.h"
+#include "encoder/SimpleEncoder.h"
+#include "image_hash/average_hash.h"
+#include "util/byte_istream.h"
+#include "util/File.h"
+
+#include <string>
+#include <vector>
+
+namespace {
+	std::vector<uint64_t> sequential_hashes(const std::string& contents, unsigned num_frames, unsigned max_blocks)
+	{
+		SimpleEncoder enc(30, 4, 2);
+		cimbar::byte_istream bis(contents.data(), contents.size());
+		fountain_encoder_stream::ptr fes = enc.create_fountain_encoder(bis);
+
+		std::vector<uint64_t> hashes;
+		for (unsigned i = 0; i < num_frames; ++i)
+		{
+			if (fes->block_count() > max_blocks)
+				fes->restart();
+			std::optional<cv::Mat> frame = enc.encode_next(*fes);
+			hashes.push_back(frame? image_hash::average_hash(*frame) : 0);
+		}
+		return hashes;
+	}
+
+	std::vector<uint64_t> pipeline_hashes(const std::string& contents, unsigned num_frames, unsigned max_blocks, unsigned num_threads, unsigned& restarts)
+	{
+		SimpleEncoder enc(30, 4, 2);
+		cimbar::byte_istream bis(contents.data(), contents.size());
+		fountain_encoder_stream::ptr fes = enc.create_fountain_encoder(bis);
+
+		FramePipeline pipeline(3, num_threads);
+		pipeline.start(fes, enc, max_blocks);
+
+		restarts = 0;
+		std::vector<uint64_t> hashes;
+		for (unsigned i = 0; i < num_frames; ++i)
+		{
+			bool restarted;
+			std::optional<cv::Mat> frame = pipeline.next(restarted);
+			restarts += restarted;
+			hashes.push_back(frame? image_hash::average_hash(*frame) : 0);
+		}
+		return hashes;
+	}
+}
+
+TEST_CASE( "FramePipelineTest/testMatchesSequential", "[unit]" )
+{
+	std::string contents = File(TestCimbar::getProjectDir() + "/LICENSE").read_all();
+	std::vector<uint64_t> expected = sequential_hashes(contents, 10, 30);
+
+	for (unsigned threads : {0, 1, 4})
+	{
+		DYNAMIC_SECTION( "threads : " << threads )
+		{
+			unsigned restarts;
+			assertEquals( expected, pipeline_hashes(contents, 10, 30, threads, restarts) );
+			assertTrue( restarts > 0 );
+		}
+	}
+}
+
+TEST_CASE( "FramePipelineTest/testStop", "[unit]" )
+{
+	std::string contents = File(TestCimbar::getProjectDir() + "/LICENSE").read_all();
+
+	SimpleEncoder enc(30, 4, 2);
+	cimbar::byte_istream bis(contents.data(), contents.size());
+	fountain_encoder_stream::ptr fes = enc.create_fountain_encoder(bis);
+
+	FramePipeline pipeline(4, 2);
+	assertFalse( pipeline.running() );
+
+	pipeline.start(fes, enc);
+	assertTrue( pipeline.running() );
+
+	bool restarted;
+	assertTrue( pipeline.next(restarted) );
+	assertFalse( restarted );
+
+	pipeline.stop();
+	assertFalse( pipeline.running() );
+	assertFalse( pipeline.next(restarted) );
+}
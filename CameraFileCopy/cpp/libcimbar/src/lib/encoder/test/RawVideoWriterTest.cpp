@@ -0,0 +1,102 @@
+/* This code is subject to the terms of the Mozilla Public License, v.2.0. http://mozilla.org/MPL/2.0/. */
+#include "unittest.h"
+
+#include "encoder/RawVideoWriter.h"
+#include "util/File.h"
+#include "util/MakeTempDirectory.h"
+
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+TEST_CASE( "RawVideoWriterTest/testY4m", "[unit]" )
+{
+	MakeTempDirectory tempdir;
+	std::string path = tempdir.path() / "out.y4m";
+
+	cv::Mat white(2, 4, CV_8UC3, cv::Scalar(0xFF, 0xFF, 0xFF));
+	cv::Mat black(2, 4, CV_8UC3, cv::Scalar(0, 0, 0));
+	{
+		RawVideoWriter vw(path, RawVideoWriter::Y4M, 30);
+		assertTrue( vw.write(white) );
+		assertTrue( vw.write(black) );
+		assertFalse( vw.write(cv::Mat(4, 4, CV_8UC3)) ); // wrong size
+		vw.close();
+		assertEquals( 2, vw.frames_written() );
+	}
+
+	std::string header = "YUV4MPEG2 W4 H2 F30:1 Ip A1:1 C444 XCOLORRANGE=FULL\n";
+	std::string contents = File(path).read_all();
+	assertEquals( header.size() + 2*(6 + 4*2*3), contents.size() );
+	assertEquals( header, contents.substr(0, header.size()) );
+
+	// first frame: Y is 255, U and V sit in the middle
+	std::string frame = contents.substr(header.size(), 6 + 4*2*3);
+	assertEquals( "FRAME\n", frame.substr(0, 6) );
+	assertEquals( std::string(8, '\xFF'), frame.substr(6, 8) );
+	assertEquals( std::string(8, '\x80'), frame.substr(14, 8) );
+	assertEquals( std::string(8, '\x80'), frame.substr(22, 8) );
+
+	// second frame: all black
+	assertEquals( std::string(8, '\0'), contents.substr(header.size() + frame.size() + 6, 8) );
+}
+
+TEST_CASE( "RawVideoWriterTest/testY4mColors", "[unit]" )
+{
+	MakeTempDirectory tempdir;
+	std::string path = tempdir.path() / "out.y4m";
+
+	// the saturated colors are the ones that go wrong if we get the color space wrong
+	std::vector<cv::Vec3b> colors = {
+		{255, 0, 0}, {0, 255, 0}, {0, 0, 255}, {255, 0, 255},
+		{0, 255, 255}, {255, 255, 0}, {255, 128, 0}, {40, 90, 200}
+	};
+	cv::Mat img(2, 4, CV_8UC3);
+	for (unsigned i = 0; i < colors.size(); ++i)
+		img.at<cv::Vec3b>(i/4, i%4) = colors[i];
+	{
+		RawVideoWriter vw(path, RawVideoWriter::Y4M, 30);
+		assertTrue( vw.write(img) );
+	}
+
+	std::string contents = File(path).read_all();
+	std::string frame = contents.substr(contents.find("FRAME\n") + 6);
+	assertEquals( 4*2*3, frame.size() );
+
+	// what a y4m reader will do with it: full range BT.601 back to RGB
+	for (unsigned i = 0; i < colors.size(); ++i)
+	{
+		double y = (uint8_t)frame[i];
+		double cb = (uint8_t)frame[8 + i] - 128.0;
+		double cr = (uint8_t)frame[16 + i] - 128.0;
+		double r = y + 1.402*cr;
+		double g = y - 0.344136*cb - 0.714136*cr;
+		double b = y + 1.772*cb;
+
+		DYNAMIC_SECTION( "color " << i )
+		{
+			assertInRange( colors[i][0] - 2, std::clamp(r, 0.0, 255.0), colors[i][0] + 2 );
+			assertInRange( colors[i][1] - 2, std::clamp(g, 0.0, 255.0), colors[i][1] + 2 );
+			assertInRange( colors[i][2] - 2, std::clamp(b, 0.0, 255.0), colors[i][2] + 2 );
+		}
+	}
+}
+
+TEST_CASE( "RawVideoWriterTest/testRgb", "[unit]" )
+{
+	MakeTempDirectory tempdir;
+	std::string path = tempdir.path() / "out.rgb";
+
+	cv::Mat img(2, 4, CV_8UC3, cv::Scalar(1, 2, 3));
+	{
+		RawVideoWriter vw(path, RawVideoWriter::RGB);
+		for (unsigned i = 0; i < 3; ++i)
+			assertTrue( vw.write(img) );
+	}
+
+	// no header, no frame markers
+	std::string contents = File(path).read_all();
+	assertEquals( 3*4*2*3, contents.size() );
+	assertEquals( "\x01\x02\x03\x01\x02\x03", contents.substr(0, 6) );
+}
@@ -5,17 +5,18 @@
 #include "wirehair/wirehair.h"
 #include <array>
 #include <optional>
-#include <set>
 #include <vector>
 #include <iostream>
 
-// will need to split large files
+// one codec per file (or per segment -- see FountainManifest.h)
 
 class FountainDecoder
 {
 public:
 	FountainDecoder(size_t length, size_t packet_size)
 	    : _length(length)
+	    , _packetSize(packet_size)
+	    , _seenBlocks(blocks_required(), false)
 	{
 		FountainInit::init();
 		_codec = wirehair_decoder_create(nullptr, length, packet_size);
@@ -28,7 +29,12 @@ public:
 
 	unsigned progress() const
 	{
-		return _seenBlocks.size();
+		return _numSeen;
+	}
+
+	unsigned blocks_required() const
+	{
+		return (_length / _packetSize) + 1;
 	}
 
 	size_t length() const
@@ -36,6 +42,12 @@ public:
 		return _length;
 	}
 
+	// what wirehair has allocated for us, plus our own bookkeeping
+	size_t memory_usage() const
+	{
+		return wirehair_allocated_bytes(_codec) + (_seenBlocks.capacity() / 8);
+	}
+
 	bool good() const
 	{
 		return _codec != nullptr;
@@ -46,21 +58,73 @@ public:
 		return _res;
 	}
 
-	std::optional<std::vector<uint8_t>> decode(unsigned block_num, uint8_t* data, size_t length)
+	// returns true once we have enough blocks to recover the message
+	bool decode_block(unsigned block_num, const uint8_t* data, size_t length)
 	{
-		auto pear = _seenBlocks.insert(block_num);
-		if (!pear.second)
-			return std::nullopt;
+		if (_res == Wirehair_Success)
+			return true;
+
+		if (block_num >= _seenBlocks.size())
+			_seenBlocks.resize(block_num + 1, false);
+		if (_seenBlocks[block_num])
+			return false;
+		_seenBlocks[block_num] = true;
+		++_numSeen;
 
 		_res = wirehair_decode(_codec, block_num, data, length);
+		return _res == Wirehair_Success;
+	}
+
+	// recover into a contiguous buffer (e.g. a mmap'd output file). dst must hold length() bytes.
+	bool recover(uint8_t* dst, size_t length)
+	{
+		if (_res != Wirehair_Success or length < _length)
+			return false;
+		return wirehair_recover(_codec, dst, _length) == Wirehair_Success;
+	}
+
+	// recover one block at a time, so we never hold a second full copy of the file.
+	template <typename STREAM>
+	bool recover(STREAM& out)
+	{
 		if (_res != Wirehair_Success)
+			return false;
+
+		std::vector<uint8_t> buff(_packetSize);
+		unsigned numBlocks = (_length + _packetSize - 1) / _packetSize;
+		for (unsigned block = 0; block < numBlocks; ++block)
+		{
+			uint32_t bytes = 0;
+			if (wirehair_recover_block(_codec, block, buff.data(), &bytes) != Wirehair_Success)
+				return false;
+			out.write((const char*)buff.data(), bytes);
+		}
+		return true;
+	}
+
+	// just the start of the first block. Enough to read a header.
+	bool peek(uint8_t* dst, size_t length)
+	{
+		if (_res != Wirehair_Success or length > _packetSize)
+			return false;
+
+		std::vector<uint8_t> buff(_packetSize);
+		uint32_t bytes = 0;
+		if (wirehair_recover_block(_codec, 0, buff.data(), &bytes) != Wirehair_Success or bytes < length)
+			return false;
+		std::copy(buff.data(), buff.data() + length, dst);
+		return true;
+	}
+
+	std::optional<std::vector<uint8_t>> decode(unsigned block_num, const uint8_t* data, size_t length)
+	{
+		if (!decode_block(block_num, data, length))
 			return std::nullopt;
 
 		// or, we're theoretically done
 		std::vector<uint8_t> bytes;
 		bytes.resize(_length);
-		_res = wirehair_recover(_codec, bytes.data(), bytes.size());
-		if (_res != Wirehair_Success)
+		if (!recover(bytes.data(), bytes.size()))
 			return std::nullopt; // :(
 
 		return bytes;
@@ -68,7 +132,9 @@ public:
 
 protected:
 	WirehairCodec _codec;
-	WirehairResult _res;
+	WirehairResult _res = Wirehair_NeedMore;
 	size_t _length;
-	std::set<unsigned> _seenBlocks; // giving wirehair_decode the same block too many times can make it very, very upset
+	size_t _packetSize;
+	std::vector<bool> _seenBlocks; // giving wirehair_decode the same block too many times can make it very, very upset
+	unsigned _numSeen = 0;
 };
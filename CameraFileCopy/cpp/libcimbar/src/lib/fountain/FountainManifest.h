@@ -0,0 +1,157 @@
+/* This code is subject to the terms of the Mozilla Public License, v.2.0. http://mozilla.org/MPL/2.0/. */
+#pragma once
+
+#include "FountainMetadata.h"
+#include <algorithm>
+#include <array>
+#include <cstdint>
+
+// files too big for one fountain stream get split into segments. Each segment is its own fountain stream
+// (with its own encode_id), and its payload starts with one of these -- a small manifest describing the whole transfer.
+// sizes are of the original file: segment i is bytes [i*segment size, (i+1)*segment size) of it, packed (compressed) on its own.
+// so the payload length -- what's left after packing -- varies, and gets its own field.
+// layout (big endian, like FountainMetadata):
+// [0-3] magic, [4] version, [5] encode_id of the first segment, [6] segment index, [7] segment count,
+// [8-15] total size, [16-19] segment size, [20-23] payload length
+class FountainManifest
+{
+protected:
+	static constexpr std::array<uint8_t, 4> _magic = {'C', 'F', 'S', 'G'};
+	static constexpr uint8_t _version = 2;
+
+	static void put_int(uint64_t val, unsigned len, uint8_t* arr)
+	{
+		for (unsigned i = 0; i < len; ++i)
+			arr[i] = (val >> ((len-i-1) * 8)) & 0xFF;
+	}
+
+	uint64_t get_int(unsigned offset, unsigned len) const
+	{
+		uint64_t res = 0;
+		for (unsigned i = 0; i < len; ++i)
+			res = (res << 8) | _data[offset+i];
+		return res;
+	}
+
+public:
+	static constexpr unsigned md_size = 24;
+	static constexpr unsigned max_segments = 128; // encode_ids are 7 bits
+	static constexpr unsigned default_segment_size = 8*1024*1024;
+	// leaves room under FountainMetadata::max_file_size for the header, and for zstd's worst case (incompressible input grows a little)
+	static constexpr unsigned max_segment_size = 30*1024*1024;
+
+	static unsigned segment_count(uint64_t total_size, uint32_t segment_size)
+	{
+		if (!segment_size)
+			return 0;
+		return std::max<uint64_t>(1, (total_size + segment_size - 1) / segment_size);
+	}
+
+	// 0 if the file is too big to send at all
+	static uint32_t pick_segment_size(uint64_t total_size)
+	{
+		uint64_t segSize = std::max<uint64_t>(default_segment_size, (total_size + max_segments - 1) / max_segments);
+		if (segSize > max_segment_size)
+			return 0;
+		return segSize;
+	}
+
+public:
+	FountainManifest()
+	{
+		_data.fill(0);
+	}
+
+	FountainManifest(uint8_t encode_id, uint64_t total_size, uint32_t segment_size, uint8_t index, uint32_t payload_length=0)
+	{
+		uint8_t* d = _data.data();
+		std::copy(_magic.begin(), _magic.end(), d);
+		d[4] = _version;
+		d[5] = encode_id & 0x7F;
+		d[6] = index;
+		d[7] = segment_count(total_size, segment_size) & 0xFF;
+		put_int(total_size, 8, d+8);
+		put_int(segment_size, 4, d+16);
+		put_int(payload_length, 4, d+20);
+	}
+
+	explicit FountainManifest(const char* buff, unsigned len)
+		: FountainManifest()
+	{
+		if (len > md_size)
+			len = md_size;
+		std::copy(buff, buff+len, _data.data());
+	}
+
+	bool good() const
+	{
+		if (!std::equal(_magic.begin(), _magic.end(), _data.begin()) or _data[4] != _version)
+			return false;
+		unsigned count = segment_count(total_size(), segment_size());
+		return count > 0 and count <= max_segments and (count & 0xFF) == _data[7] and index() < count
+			and payload_length() <= FountainMetadata::max_file_size - md_size;
+	}
+
+	uint8_t encode_id() const
+	{
+		return _data[5];
+	}
+
+	uint8_t index() const
+	{
+		return _data[6];
+	}
+
+	unsigned segment_count() const
+	{
+		return segment_count(total_size(), segment_size());
+	}
+
+	uint64_t total_size() const
+	{
+		return get_int(8, 8);
+	}
+
+	uint32_t segment_size() const
+	{
+		return get_int(16, 4);
+	}
+
+	// bytes of (packed) segment that follow the manifest. Anything after that is padding.
+	uint32_t payload_length() const
+	{
+		return get_int(20, 4);
+	}
+
+	uint64_t segment_offset(unsigned index) const
+	{
+		return (uint64_t)index * segment_size();
+	}
+
+	uint32_t segment_length(unsigned index) const
+	{
+		uint64_t offset = segment_offset(index);
+		if (offset >= total_size())
+			return 0;
+		return std::min<uint64_t>(segment_size(), total_size() - offset);
+	}
+
+	// identifies the transfer, independent of which segment we're looking at
+	uint64_t key() const
+	{
+		return ((uint64_t)encode_id() << 56) | (total_size() & 0xFFFFFFFFFFFFFFULL);
+	}
+
+	uint8_t* data()
+	{
+		return _data.data();
+	}
+
+	const uint8_t* data() const
+	{
+		return _data.data();
+	}
+
+protected:
+	std::array<uint8_t, md_size> _data;
+};
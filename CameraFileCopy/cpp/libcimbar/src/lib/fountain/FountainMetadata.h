@@ -14,6 +14,7 @@ protected:
 
 public:
 	static const unsigned md_size = 6;
+	static const unsigned max_file_size = (1 << 25) - 1; // 24 bits + 1 borrowed from encode_id. Bigger files are segmented.
 
 	static void to_uint8_arr(uint8_t encode_id, unsigned size, uint16_t block_id, uint8_t* arr)
 	{
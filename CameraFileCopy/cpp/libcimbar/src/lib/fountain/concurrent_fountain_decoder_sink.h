@@ -4,15 +4,62 @@
 #include "fountain_decoder_sink.h"
 
 #include "concurrentqueue/concurrentqueue.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
 #include <mutex>
+#include <thread>
 
+// decode workers write() chunks in, a single consumer thread owns the fountain_decoder_sink.
+// writers never wait on the fountain decode, wirehair recovery, or file io -- they copy into a pooled buffer and move on.
+// (unless we're lossless, and out of buffers. Then they sleep until the consumer hands one back.)
 template <typename OUTSTREAM>
 class concurrent_fountain_decoder_sink
 {
+protected:
+	struct chunk
+	{
+		std::vector<char> data;
+		unsigned size = 0;
+	};
+
+	struct status
+	{
+		std::vector<std::string> done;
+		std::vector<double> progress;
+	};
+
 public:
-	concurrent_fountain_decoder_sink(std::string data_dir, unsigned chunk_size)
-	    : _decoder(data_dir, chunk_size)
+	concurrent_fountain_decoder_sink(std::string data_dir, unsigned chunk_size, unsigned num_buffers=256, bool log_writes=false)
+	    : _decoder(data_dir, chunk_size, log_writes)
+	    , _chunks(num_buffers)
+	    , _free(num_buffers)
+	    , _work(num_buffers)
+	    , _status(std::make_shared<const status>())
+	{
+		for (unsigned i = 0; i < _chunks.size(); ++i)
+		{
+			_chunks[i].data.resize(chunk_size);
+			_free.enqueue(i);
+		}
+		_consumer = std::thread(&concurrent_fountain_decoder_sink::run, this);
+	}
+
+	~concurrent_fountain_decoder_sink()
 	{
+		stop();
+	}
+
+	// finishes whatever is already queued up
+	void stop()
+	{
+		if (!_running.exchange(false))
+			return;
+		_notify.notify_one();
+		wake_writers(true);
+		if (_consumer.joinable())
+			_consumer.join();
 	}
 
 	bool good() const
@@ -20,6 +67,30 @@ public:
 		return true;
 	}
 
+	// see fountain_decoder_sink. Call it before the first write()
+	void set_checkpoint(bool checkpoint=true)
+	{
+		_decoder.set_checkpoint(checkpoint);
+	}
+
+	// see fountain_decoder_sink. Same deal: call them before the first write()
+	void set_max_streams(unsigned max_streams)
+	{
+		_decoder.set_max_streams(max_streams);
+	}
+
+	void set_memory_budget(size_t budget)
+	{
+		_decoder.set_memory_budget(budget);
+	}
+
+	// the camera doesn't care about a dropped chunk -- there'll be another frame along in a moment.
+	// a batch decode of a pile of images does. Lossless writers wait for a buffer instead of dropping.
+	void set_lossless(bool lossless=true)
+	{
+		_lossless = lossless;
+	}
+
 	unsigned chunk_size() const
 	{
 		return _decoder.chunk_size();
@@ -27,69 +98,179 @@ public:
 
 	unsigned num_streams() const
 	{
-		return _decoder.num_streams();
+		return _numStreams;
 	}
 
 	unsigned num_done() const
 	{
-		return _decoder.num_done();
+		return _numDone;
+	}
+
+	// streams the decoder gave up on, to stay under its limits
+	unsigned num_evicted() const
+	{
+		return _numEvicted;
+	}
+
+	size_t memory_usage() const
+	{
+		return _memoryUsage;
+	}
+
+	// chunks waiting on the consumer thread
+	unsigned backlog() const
+	{
+		return _backlog;
+	}
+
+	// chunks we had no buffer for
+	unsigned dropped() const
+	{
+		return _dropped;
 	}
 
 	std::vector<std::string> get_done() const
 	{
-		std::lock_guard<std::mutex> lock(_readMutex);
-		return _done;
+		return std::atomic_load(&_status)->done;
 	}
 
 	std::vector<double> get_progress() const
 	{
-		std::lock_guard<std::mutex> lock(_readMutex);
-		return _progress;
+		return std::atomic_load(&_status)->progress;
 	}
 
-	void update_status()
+	// fountain chunks are self-describing, so if someone hands us more than one at a time we can split them up
+	bool write(const char* data, unsigned length)
 	{
-		// we call this under the writeMutex+readMutex. The `const`s are only under readMutex.
-		// just thought you ought to know
-		std::lock_guard<std::mutex> lock(_readMutex);
-		_done = _decoder.get_done();
-		_progress = _decoder.get_progress();
+		bool res = true;
+		while (length > 0)
+		{
+			unsigned len = std::min(length, chunk_size());
+			unsigned idx;
+			bool haveBuffer = _free.try_dequeue(idx);
+			if (!haveBuffer and _lossless)
+				haveBuffer = wait_for_buffer(idx);
+
+			if (haveBuffer)
+			{
+				chunk& c = _chunks[idx];
+				std::copy(data, data+len, c.data.data());
+				c.size = len;
+				++_backlog;
+				_work.enqueue(idx);
+			}
+			else
+			{
+				// the consumer is way behind. Fountain codes are fine with a little loss.
+				++_dropped;
+				res = false;
+			}
+			data += len;
+			length -= len;
+		}
+		_notify.notify_one();
+		return res;
 	}
 
-	void process()
+	concurrent_fountain_decoder_sink& operator<<(const std::string& buffer)
+	{
+		write(buffer.data(), buffer.size());
+		return *this;
+	}
+
+protected:
+	bool wait_for_buffer(unsigned& idx)
+	{
+		// the consumer might be napping. It's the only one who can help us
+		_notify.notify_one();
+
+		bool haveBuffer = false;
+		std::unique_lock<std::mutex> lock(_freeMutex);
+		_bufferFreed.wait(lock, [&]() {
+			haveBuffer = _free.try_dequeue(idx);
+			return haveBuffer or !_running;
+		});
+		return haveBuffer;
+	}
+
+	// the consumer takes the lock before notifying, so a writer can't check _free, miss our buffer, *then* start waiting
+	void wake_writers(bool all=false)
 	{
-		if (_writeMutex.try_lock())
 		{
-			// maybe a 2nd mutex for retrieving _decoder.has_file()??
-			std::string buff;
-			while (_backlog.try_dequeue(buff))
-				_decoder << buff;
+			std::lock_guard<std::mutex> lock(_freeMutex);
+		}
+		if (all)
+			_bufferFreed.notify_all();
+		else
+			_bufferFreed.notify_one();
+	}
 
-			update_status();
-			_writeMutex.unlock();
+	void run()
+	{
+		while (_running)
+		{
+			{
+				// we don't make writers take the lock to notify us, so a wakeup can slip by. The timeout covers it.
+				std::unique_lock<std::mutex> lock(_notifyMutex);
+				_notify.wait_for(lock, std::chrono::milliseconds(10), [this]() { return _backlog > 0 or !_running; });
+			}
+			process();
 		}
+		process();
 	}
 
-	bool write(const char* data, unsigned length)
+	void process()
 	{
-		std::string buffer(data, length);
-		operator<<(buffer);
-		return true;
+		bool dirty = false;
+		unsigned idx;
+		while (_work.try_dequeue(idx))
+		{
+			chunk& c = _chunks[idx];
+			_decoder.decode_frame(c.data.data(), c.size);
+			_free.enqueue(idx);
+			--_backlog;
+			if (_lossless)
+				wake_writers();
+			dirty = true;
+		}
+
+		if (dirty)
+			update_status();
 	}
 
-	concurrent_fountain_decoder_sink& operator<<(const std::string& buffer)
+	void update_status()
 	{
-		_backlog.enqueue(buffer);
-		process();
-		return *this;
+		std::shared_ptr<status> st = std::make_shared<status>();
+		st->done = _decoder.get_done();
+		st->progress = _decoder.get_progress();
+		std::atomic_store(&_status, std::shared_ptr<const status>(st));
+
+		_numStreams = _decoder.num_streams();
+		_numDone = _decoder.num_done();
+		_numEvicted = _decoder.num_evicted();
+		_memoryUsage = _decoder.memory_usage();
 	}
 
 protected:
-	std::mutex _writeMutex;
-	mutable std::mutex _readMutex;
-	fountain_decoder_sink<OUTSTREAM> _decoder;
-	moodycamel::ConcurrentQueue< std::string > _backlog;
+	fountain_decoder_sink<OUTSTREAM> _decoder; // consumer thread only!
+
+	std::vector<chunk> _chunks;
+	moodycamel::ConcurrentQueue<unsigned> _free;
+	moodycamel::ConcurrentQueue<unsigned> _work;
+
+	std::atomic<unsigned> _backlog = 0;
+	std::atomic<unsigned> _dropped = 0;
+	std::atomic<unsigned> _numStreams = 0;
+	std::atomic<unsigned> _numDone = 0;
+	std::atomic<unsigned> _numEvicted = 0;
+	std::atomic<size_t> _memoryUsage = 0;
+	std::shared_ptr<const status> _status;
 
-	std::vector<std::string> _done;
-	std::vector<double> _progress;
+	std::atomic<bool> _running = true;
+	std::atomic<bool> _lossless = false;
+	std::mutex _freeMutex;
+	std::condition_variable _bufferFreed; // lossless writers wait on this
+	std::mutex _notifyMutex;
+	std::condition_variable _notify;
+	std::thread _consumer;
 };
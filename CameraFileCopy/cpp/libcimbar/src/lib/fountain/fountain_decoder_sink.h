@@ -2,10 +2,15 @@
 #pragma once
 
 #include "fountain_decoder_stream.h"
+#include "FountainManifest.h"
 #include "FountainMetadata.h"
 #include "serialize/format.h"
 
 #include <cstdio>
+#include <deque>
+#include <fstream>
+#include <list>
+#include <map>
 #include <set>
 #include <string>
 #include <unordered_map>
@@ -15,6 +20,36 @@
 template <typename OUTSTREAM>
 class fountain_decoder_sink
 {
+protected:
+	// writes the recovered segment minus its FountainManifest header (and any padding)
+	template <typename STREAM>
+	class segment_writer
+	{
+	public:
+		segment_writer(STREAM& stream, uint64_t length)
+			: _stream(stream)
+			, _remaining(length)
+		{}
+
+		void write(const char* data, size_t length)
+		{
+			unsigned skip = std::min<size_t>(_skip, length);
+			_skip -= skip;
+			data += skip;
+			length -= skip;
+
+			length = std::min<uint64_t>(length, _remaining);
+			_remaining -= length;
+			if (length)
+				_stream.write(data, length);
+		}
+
+	protected:
+		STREAM& _stream;
+		unsigned _skip = FountainManifest::md_size;
+		uint64_t _remaining;
+	};
+
 public:
 	fountain_decoder_sink(std::string data_dir, unsigned chunk_size, bool log_writes=false)
 		: _dataDir(data_dir)
@@ -23,6 +58,57 @@ public:
 	{
 	}
 
+	// how many files we'll work on at once. Past that, the least recently seen one gets dropped.
+	void set_max_streams(unsigned max_streams)
+	{
+		_maxStreams = std::max(1U, max_streams);
+		enforce_limits(0);
+	}
+
+	// in bytes, as reported by wirehair. 0 == no limit. We'll always keep at least one stream.
+	void set_memory_budget(size_t budget)
+	{
+		_memoryBudget = budget;
+		enforce_limits(0);
+	}
+
+	// journal received blocks to the data dir, so a restarted receiver can resume partial transfers
+	void set_checkpoint(bool checkpoint=true)
+	{
+		_checkpoint = checkpoint;
+	}
+
+	// how many finished ids (and segmented files) we remember, so we can ignore their stragglers
+	void set_max_done(unsigned max_done)
+	{
+		_maxDone = std::max(1U, max_done);
+		age_done();
+	}
+
+	unsigned max_streams() const
+	{
+		return _maxStreams;
+	}
+
+	size_t memory_budget() const
+	{
+		return _memoryBudget;
+	}
+
+	size_t memory_usage() const
+	{
+		size_t total = 0;
+		for (auto&& [id, s] : _streams)
+			total += s.memory_usage();
+		return total;
+	}
+
+	// streams we gave up on to make room for newer ones
+	unsigned num_evicted() const
+	{
+		return _evicted;
+	}
+
 	bool good() const
 	{
 		return true;
@@ -33,22 +119,86 @@ public:
 		return _chunkSize;
 	}
 
-	bool store(const FountainMetadata& md, const std::vector<uint8_t>& data)
+	bool store(const FountainMetadata& md, fountain_decoder_stream& s)
 	{
+		FountainManifest manifest;
+		if (s.peek(manifest.data(), FountainManifest::md_size) and manifest.good()
+			and md.file_size() >= FountainManifest::md_size + manifest.payload_length())
+			return store_segment(md, manifest, s);
+
 		std::string file_path = fmt::format("{}/{}", _dataDir, get_filename(md));
 		OUTSTREAM f(file_path);
-		f.write((char*)data.data(), data.size());
+		// streamed out block by block -- wirehair already holds the only full copy of the file
+		if (!s.recover(f))
+			return false;
 		if (_logWrites)
 			printf("%s\n", file_path.c_str());
 		return true;
 	}
 
+	// segments get parked in the data dir until we have all of them
+	bool store_segment(const FountainMetadata& md, const FountainManifest& manifest, fountain_decoder_stream& s)
+	{
+		_segments.insert(md.id());
+		// a straggler from a file we've already put back together
+		if (_assembled.find(get_filename(manifest)) != _assembled.end())
+			return true;
+
+		{
+			std::ofstream f(part_path(manifest, manifest.index()));
+			segment_writer<std::ofstream> w(f, manifest.payload_length());
+			if (!s.recover(w))
+			{
+				_segments.erase(md.id());
+				return false;
+			}
+		}
+
+		std::set<unsigned>& parts = _parts[manifest.key()];
+		parts.insert(manifest.index());
+		if (parts.size() == manifest.segment_count())
+			assemble(manifest);
+		return true;
+	}
+
+	void assemble(const FountainManifest& manifest)
+	{
+		std::string file_path = fmt::format("{}/{}", _dataDir, get_filename(manifest));
+		{
+			OUTSTREAM f(file_path);
+			std::vector<char> buff(0x10000);
+			for (unsigned i = 0; i < manifest.segment_count(); ++i)
+			{
+				std::string part = part_path(manifest, i);
+				{
+					std::ifstream in(part);
+					while (in)
+					{
+						in.read(buff.data(), buff.size());
+						if (in.gcount() > 0)
+							f.write(buff.data(), in.gcount());
+					}
+				}
+				std::remove(part.c_str());
+			}
+		}
+		if (_logWrites)
+			printf("%s\n", file_path.c_str());
+
+		_parts.erase(manifest.key());
+		if (_assembled.insert(get_filename(manifest)).second)
+			_assembledOrder.push_back(get_filename(manifest));
+		age_done();
+	}
+
 	void mark_done(const FountainMetadata& md)
 	{
-		_done.insert(md.id());
-		auto it = _streams.find(stream_slot(md));
-		if (it != _streams.end())
-			_streams.erase(it);
+		if (_done.insert(md.id()).second)
+			_doneOrder.push_back(md.id());
+		age_done();
+
+		erase_journal(md.id());
+		remove_stream(md.id());
 	}
 
 	unsigned num_streams() const
@@ -56,23 +206,27 @@ public:
 		return _streams.size();
 	}
 
+	// segments of a larger file don't count until the whole thing is put back together
 	unsigned num_done() const
 	{
-		return _done.size();
+		return _done.size() - _segments.size() + _assembled.size();
 	}
 
 	std::vector<std::string> get_done() const
 	{
 		std::vector<std::string> done;
 		for (uint32_t id : _done)
-			done.push_back( get_filename(FountainMetadata(id)) );
+			if (_segments.find(id) == _segments.end())
+				done.push_back( get_filename(FountainMetadata(id)) );
+		for (const std::string& name : _assembled)
+			done.push_back(name);
 		return done;
 	}
 
 	std::vector<double> get_progress() const
 	{
 		std::vector<double> progress;
-		for (auto&& [slot, s] : _streams)
+		for (auto&& [id, s] : _streams)
 		{
 			unsigned br = s.blocks_required();
 			if (br)
@@ -100,16 +254,31 @@ public:
 			return false;
 
 		// find or create
-		auto p = _streams.try_emplace(stream_slot(md), md.file_size(), _chunkSize);
+		auto p = _streams.try_emplace(md.id(), md.file_size(), _chunkSize, md.id());
 		fountain_decoder_stream& s = p.first->second;
-		if (s.data_size() != md.file_size())
+		if (!s.good())
+		{
+			remove_stream(md.id());
 			return false;
+		}
+
+		touch(md.id());
+		if (p.second)
+		{
+			if (_checkpoint)
+				s.resume(std::make_unique<fountain_journal>(journal_path(md), md.file_size(), s.block_size()));
+			enforce_limits(md.id());
+		}
 
-		auto finished = s.write(data, size);
-		if (!finished)
+		if (!s.write(data, size))
+		{
+			// streams grow as their blocks come in, not just when they're created. So the budget needs another look.
+			if (_memoryBudget)
+				enforce_limits(md.id());
 			return false;
+		}
 
-		if (store(md, *finished))
+		if (store(md, s))
 			mark_done(md);
 		return true;
 	}
@@ -126,10 +295,62 @@ public:
 	}
 
 protected:
-	// streams is limited to at most 8 decoders at a time. Currently, we just use the lower bits of the encode_id.
-	uint8_t stream_slot(const FountainMetadata& md) const
+	// most recently used at the front
+	void touch(uint32_t id)
+	{
+		if (!_lru.empty() and _lru.front() == id)
+			return;
+		_lru.remove(id);
+		_lru.push_front(id);
+	}
+
+	// finished or given up on -- either way, a journal would only get in the way of the next transfer with this name
+	void erase_journal(uint32_t id)
+	{
+		auto it = _streams.find(id);
+		if (it != _streams.end() and it->second.journal())
+			it->second.journal()->erase();
+	}
+
+	void remove_stream(uint32_t id)
+	{
+		_streams.erase(id);
+		_lru.remove(id);
+	}
+
+	// evict least recently used streams until we're under our limits. `keep` is safe.
+	void enforce_limits(uint32_t keep)
 	{
-		return md.encode_id() & 0x7;
+		while (_streams.size() > 1)
+		{
+			bool overCount = _streams.size() > _maxStreams;
+			bool overBudget = _memoryBudget and memory_usage() > _memoryBudget;
+			if (!overCount and !overBudget)
+				break;
+
+			uint32_t victim = _lru.back();
+			if (victim == keep)
+				victim = *std::next(_lru.rbegin());
+			erase_journal(victim);
+			remove_stream(victim);
+			++_evicted;
+		}
+	}
+
+	void age_done()
+	{
+		while (_doneOrder.size() > _maxDone)
+		{
+			uint32_t id = _doneOrder.front();
+			_doneOrder.pop_front();
+			_done.erase(id);
+			_segments.erase(id);
+		}
+		while (_assembledOrder.size() > _maxDone)
+		{
+			_assembled.erase(_assembledOrder.front());
+			_assembledOrder.pop_front();
+		}
 	}
 
 	std::string get_filename(const FountainMetadata& md) const
@@ -137,15 +358,42 @@ protected:
 		return fmt::format("{}.{}", md.encode_id(), md.file_size());
 	}
 
+	std::string get_filename(const FountainManifest& manifest) const
+	{
+		return fmt::format("{}.{}", manifest.encode_id(), manifest.total_size());
+	}
+
+	std::string journal_path(const FountainMetadata& md) const
+	{
+		return fmt::format("{}/.{}.journal", _dataDir, get_filename(md));
+	}
+
+	std::string part_path(const FountainManifest& manifest, unsigned index) const
+	{
+		return fmt::format("{}/.{}.part{}", _dataDir, get_filename(manifest), index);
+	}
+
 protected:
 	std::string _dataDir;
 	unsigned _chunkSize;
 
-	// maybe instead of unordered_map+set, something where we can "age out" old streams?
-	// e.g. most recent 16/8, or something?
-	// question is what happens to _done/_streams when we wrap for continuous data streaming...
-	std::unordered_map<uint8_t, fountain_decoder_stream> _streams;
-	// track the uint32_t combo of (encode_id,size) to avoid redundant work
+	// keyed by the uint32_t combo of (encode_id,size). Aged out LRU style.
+	std::unordered_map<uint32_t, fountain_decoder_stream> _streams;
+	std::list<uint32_t> _lru;
+	unsigned _maxStreams = 8;
+	size_t _memoryBudget = 0;
+	unsigned _evicted = 0;
+
+	// track the finished ids to avoid redundant work. Oldest are forgotten first.
 	std::set<uint32_t> _done;
+	std::deque<uint32_t> _doneOrder;
+	unsigned _maxDone = 4096;
 	bool _logWrites;
+	bool _checkpoint = false;
+
+	// segmented transfers. (manifest key) -> segments on disk
+	std::map<uint64_t, std::set<unsigned>> _parts;
+	std::set<uint32_t> _segments; // ids in _done that were only part of a file
+	std::set<std::string> _assembled; // aged out with _done
+	std::deque<std::string> _assembledOrder;
 };
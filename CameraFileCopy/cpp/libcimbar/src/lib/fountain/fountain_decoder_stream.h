@@ -2,9 +2,12 @@
 #pragma once
 
 #include "FountainDecoder.h"
+#include "fountain_journal.h"
 #include <iostream>
-#include <optional>
+#include <memory>
 #include <string>
+#include <utility>
+#include <vector>
 
 class fountain_decoder_stream
 {
@@ -12,12 +15,19 @@ public:
 	static const unsigned _headerSize = 6;
 
 public:
-	fountain_decoder_stream(unsigned data_size, unsigned buffer_size)
+	fountain_decoder_stream(unsigned data_size, unsigned buffer_size, uint32_t id=0)
 	    : _buffer(buffer_size, 0)
 	    , _decoder(data_size, block_size())
+	    , _id(id)
 	{
 	}
 
+	// the FountainMetadata id we're decoding. The sink sets this, we just hold on to it.
+	uint32_t id() const
+	{
+		return _id;
+	}
+
 	unsigned progress() const
 	{
 		return _decoder.progress();
@@ -43,21 +53,74 @@ public:
 		return _decoder.good();
 	}
 
-	std::optional<std::vector<uint8_t>> decode()
+	size_t memory_usage() const
+	{
+		return _decoder.memory_usage() + _buffer.capacity() + _pending.size() * block_size();
+	}
+
+	bool done() const
+	{
+		return _done;
+	}
+
+	// once write() returns true, the decoded file can be pulled out with one of these
+	bool recover(uint8_t* dst, size_t length)
+	{
+		return _decoder.recover(dst, length);
+	}
+
+	template <typename STREAM>
+	bool recover(STREAM& out)
+	{
+		return _decoder.recover(out);
+	}
+
+	bool peek(uint8_t* dst, size_t length)
+	{
+		return _decoder.peek(dst, length);
+	}
+
+	// keep the journal up to date with new blocks -- and, once we know it's for the same data we're getting now,
+	// replay whatever it already had. Returns the number of blocks waiting on that.
+	unsigned resume(std::unique_ptr<fountain_journal> journal)
+	{
+		unsigned count = journal->open();
+		_journal = std::move(journal);
+		_journalChecked = !count;
+		return count;
+	}
+
+	fountain_journal* journal() const
+	{
+		return _journal.get();
+	}
+
+	bool decode()
 	{
 		// if we're full
 		_buffIndex = 0;
 		// we ignore the first 4 bytes. It's the sink's job to make sure we're getting the right stuff.
 		// we may, at some point, sanity check if data_size == [1]+[2]+[3]
 		unsigned blockId = (unsigned)(_buffer[4]) << 8 | _buffer[5];
-		return _decoder.decode(blockId, _buffer.data() + _headerSize, block_size());
+		const uint8_t* block = _buffer.data() + _headerSize;
+		unsigned seen = progress();
+		_done = _decoder.decode_block(blockId, block, block_size());
+		if (!_journal or _done)
+			return _done;
+
+		bool isNew = progress() > seen;
+		if (!_journalChecked)
+			check_journal(blockId, block, isNew);
+		else if (isNew)
+			_journal->append(blockId, block);
+		return _done;
 	}
 
 	// we need to track either:
 	// 1. all packet header locations + current location in frame buffer to correlate
 	// 2. current location in frame buffer to see if we're at a packet header location
 	// 3. special case of #2, where we just roll forward every _bufferSize bytes?
-	std::optional<std::vector<uint8_t>> write(const char* data, unsigned length)
+	bool write(const char* data, unsigned length)
 	{
 		while (length > 0 and good())
 		{
@@ -71,16 +134,51 @@ public:
 
 			if (_buffIndex == _buffer.size())
 			{
-				auto res = decode();
-				if (res)
-					return res;
+				if (decode())
+					return true;
 			}
 		}
-		return std::nullopt;
+		return false;
+	}
+
+protected:
+	// a journal with the same (encode_id,size) could still be left over from some other transfer.
+	// so until a live block matches one it has, the blocks we get are held here instead of being added to it.
+	void check_journal(uint16_t block_id, const uint8_t* block, bool isNew)
+	{
+		int res = _journal->check(block_id, block);
+		if (res == 0)
+		{
+			if (isNew)
+				_pending.emplace_back(block_id, std::vector<uint8_t>(block, block + block_size()));
+			return;
+		}
+
+		_journalChecked = true;
+		if (res > 0)
+			_journal->replay([this](uint16_t id, const uint8_t* data) {
+				_done = _decoder.decode_block(id, data, block_size());
+			});
+		else
+		{
+			_journal->discard();
+			if (isNew)
+				_pending.emplace_back(block_id, std::vector<uint8_t>(block, block + block_size()));
+		}
+
+		for (auto&& [id, data] : _pending)
+			_journal->append(id, data.data());
+		_pending.clear();
+		_pending.shrink_to_fit();
 	}
 
 protected:
 	std::vector<uint8_t> _buffer;
 	FountainDecoder _decoder;
+	uint32_t _id;
+	std::unique_ptr<fountain_journal> _journal;
+	bool _journalChecked = true;
+	std::vector<std::pair<uint16_t, std::vector<uint8_t>>> _pending; // see check_journal()
 	unsigned _buffIndex = 0;
+	bool _done = false;
 };
@@ -18,7 +18,7 @@ protected:
 
 protected:
 	fountain_encoder_stream(std::string&& data, unsigned buffer_size, uint8_t encode_id)
-		: _data(data)
+		: _data(std::move(data))
 		, _buffer(buffer_size, 0)
 		, _encodeId(encode_id)
 		, _encoder((uint8_t*)_data.data(), _data.size(), block_size())
@@ -40,6 +40,12 @@ public:
 		return fountain_encoder_stream::ptr( new fountain_encoder_stream(buffs.str(), buffer_size, encode_id & 0x7F) );
 	}
 
+	// for when we already have it in memory. Saves a copy
+	static fountain_encoder_stream::ptr create(std::string&& data, unsigned buffer_size, uint8_t encode_id=0)
+	{
+		return fountain_encoder_stream::ptr( new fountain_encoder_stream(std::move(data), buffer_size, encode_id & 0x7F) );
+	}
+
 	// this resets the stream!
 	// but you might need to do if you change other parameters
 	// ex: different ECC settings => different payload size => different fountain buffer size
@@ -56,12 +62,13 @@ public:
 
 	bool good() const
 	{
-		return _encoder.good() and _data.size() > _encoder.packet_size();
+		return _encoder.good() and _data.size() > _encoder.packet_size() and _data.size() <= FountainMetadata::max_file_size;
 	}
 
-	void restart()
+	// `block` to pick up where an earlier stream over the same data left off
+	void restart(unsigned block=0)
 	{
-		_block = 0;
+		_block = block;
 		_buffIndex = ~0U;
 		_lastRead = 0;
 	}
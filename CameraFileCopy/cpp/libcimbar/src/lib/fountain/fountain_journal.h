@@ -0,0 +1,305 @@
+/* This code is subject to the terms of the Mozilla Public License, v.2.0. http://mozilla.org/MPL/2.0/. */
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#if defined(_WIN32)
+	#include <io.h>
+#else
+	#include <unistd.h>
+#endif
+
+// append-only record of the fountain blocks we've received for one stream, so a killed receiver can pick up where it left off.
+// layout: [magic(4)][data_size(4)][block_size(4)][first_id(2)][first_hash(8)], then repeated [block_id(2)][block payload(block_size)].
+// Big endian, like everything else. A torn record at the end (we died mid-write) is dropped.
+//
+// (encode_id,size) isn't much of a name -- the id is only 7 bits -- so a journal could be left over from some other transfer.
+// first_id/first_hash are the first block we recorded, and are what check() compares a live block against.
+// open() reads what's on disk, but nothing gets handed out until the caller decides it's ours and calls replay().
+class fountain_journal
+{
+protected:
+	static constexpr std::array<uint8_t, 4> _magic = {'C', 'F', 'J', '2'};
+	static constexpr unsigned _headerSize = 22;
+
+public:
+	fountain_journal(std::string path, unsigned data_size, unsigned block_size, unsigned sync_every=16)
+		: _path(path)
+		, _dataSize(data_size)
+		, _blockSize(block_size)
+		, _syncEvery(sync_every)
+		, _record(2 + block_size)
+	{
+	}
+
+	~fountain_journal()
+	{
+		close();
+	}
+
+	bool good() const
+	{
+		return _fp != nullptr;
+	}
+
+	const std::string& path() const
+	{
+		return _path;
+	}
+
+	// the records already on disk. Anything that isn't for a stream like ours (or is torn) is thrown away.
+	// returns the number of records. If there aren't any, we're ready to append().
+	unsigned open()
+	{
+		if (_opened)
+			return _records;
+		_opened = true;
+
+		bool torn = false;
+		FILE* fp = fopen(_path.c_str(), "rb");
+		if (fp)
+		{
+			std::array<uint8_t, _headerSize> header;
+			if (fread(header.data(), 1, header.size(), fp) == header.size() and read_header(header.data()))
+			{
+				while (true)
+				{
+					size_t bytes = fread(_record.data(), 1, _record.size(), fp);
+					if (bytes != _record.size())
+					{
+						torn = bytes > 0;
+						break;
+					}
+					uint16_t blockId = (uint16_t)(_record[0] << 8) | _record[1];
+					_index.emplace(blockId, _records++);
+				}
+			}
+			fclose(fp);
+		}
+
+		if (!_records)
+		{
+			open_fresh();
+			return 0;
+		}
+
+		// if the tail got chopped off, copying the good records out is the portable way to truncate
+		if (torn)
+			rewrite(_records);
+		return _records;
+	}
+
+	// does a block we just got agree with the journal? 1 == yes, -1 == no (it's from some other transfer), 0 == can't tell
+	int check(uint16_t block_id, const uint8_t* data)
+	{
+		if (!_records)
+			return 0;
+		if (block_id == _firstId)
+			return hash(data) == _firstHash? 1 : -1;
+
+		auto it = _index.find(block_id);
+		if (it == _index.end())
+			return 0;
+
+		bool same = false;
+		FILE* fp = fopen(_path.c_str(), "rb");
+		if (fp)
+		{
+			if (fseek(fp, _headerSize + it->second * _record.size(), SEEK_SET) == 0
+				and fread(_record.data(), 1, _record.size(), fp) == _record.size())
+				same = std::equal(data, data + _blockSize, _record.data() + 2);
+			fclose(fp);
+		}
+		return same? 1 : -1;
+	}
+
+	// hands every record on disk to fun(block_id, payload), then opens the journal for appending.
+	// returns the number of records replayed.
+	template <typename FUN>
+	unsigned replay(const FUN& fun)
+	{
+		if (!open())
+			return 0;
+
+		unsigned count = 0;
+		FILE* fp = fopen(_path.c_str(), "rb");
+		if (fp)
+		{
+			fseek(fp, _headerSize, SEEK_SET);
+			while (fread(_record.data(), 1, _record.size(), fp) == _record.size())
+			{
+				uint16_t blockId = (uint16_t)(_record[0] << 8) | _record[1];
+				fun(blockId, _record.data() + 2);
+				++count;
+			}
+			fclose(fp);
+		}
+		_fp = fopen(_path.c_str(), "ab");
+		return count;
+	}
+
+	// not ours after all. Start over.
+	void discard()
+	{
+		close();
+		_opened = true;
+		open_fresh();
+	}
+
+	bool append(uint16_t block_id, const uint8_t* data)
+	{
+		if (!good())
+			return false;
+
+		// the first record names the journal
+		if (!_records)
+		{
+			_firstId = block_id;
+			_firstHash = hash(data);
+			std::array<uint8_t, _headerSize> header;
+			make_header(header.data());
+			if (fwrite(header.data(), 1, header.size(), _fp) != header.size())
+				return false;
+		}
+
+		_record[0] = (block_id >> 8) & 0xFF;
+		_record[1] = block_id & 0xFF;
+		std::copy(data, data + _blockSize, _record.data() + 2);
+		if (fwrite(_record.data(), 1, _record.size(), _fp) != _record.size())
+			return false;
+		_index.emplace(block_id, _records++);
+
+		// fsync is the slow part, so we batch it
+		if (++_unsynced >= _syncEvery)
+			sync();
+		return true;
+	}
+
+	void sync()
+	{
+		if (!good())
+			return;
+		fflush(_fp);
+#if defined(_WIN32)
+		_commit(_fileno(_fp));
+#else
+		fsync(fileno(_fp));
+#endif
+		_unsynced = 0;
+	}
+
+	void close()
+	{
+		if (!good())
+			return;
+		sync();
+		fclose(_fp);
+		_fp = nullptr;
+	}
+
+	// we're done with it
+	void erase()
+	{
+		close();
+		std::remove(_path.c_str());
+	}
+
+protected:
+	// FNV-1a. We're telling transfers apart, not fending off anyone
+	uint64_t hash(const uint8_t* data) const
+	{
+		uint64_t h = 0xcbf29ce484222325ULL;
+		for (unsigned i = 0; i < _blockSize; ++i)
+			h = (h ^ data[i]) * 0x100000001b3ULL;
+		return h;
+	}
+
+	bool read_header(const uint8_t* header)
+	{
+		std::array<uint8_t, _headerSize> expected;
+		make_header(expected.data());
+		if (!std::equal(expected.begin(), expected.begin() + 12, header))
+			return false;
+
+		_firstId = (uint16_t)(header[12] << 8) | header[13];
+		_firstHash = 0;
+		for (unsigned i = 0; i < 8; ++i)
+			_firstHash = (_firstHash << 8) | header[14+i];
+		return true;
+	}
+
+	void make_header(uint8_t* header) const
+	{
+		std::copy(_magic.begin(), _magic.end(), header);
+		for (unsigned i = 0; i < 4; ++i)
+		{
+			header[4+i] = (_dataSize >> (24 - i*8)) & 0xFF;
+			header[8+i] = (_blockSize >> (24 - i*8)) & 0xFF;
+		}
+		header[12] = (_firstId >> 8) & 0xFF;
+		header[13] = _firstId & 0xFF;
+		for (unsigned i = 0; i < 8; ++i)
+			header[14+i] = (_firstHash >> (56 - i*8)) & 0xFF;
+	}
+
+	// the header goes in with the first record, since that's what it describes
+	bool open_fresh()
+	{
+		_index.clear();
+		_records = 0;
+		_fp = fopen(_path.c_str(), "wb");
+		return _fp != nullptr;
+	}
+
+	void rewrite(unsigned count)
+	{
+		std::string tempPath = _path + ".tmp";
+		FILE* in = fopen(_path.c_str(), "rb");
+		FILE* out = fopen(tempPath.c_str(), "wb");
+		if (in and out)
+		{
+			std::array<uint8_t, _headerSize> header;
+			make_header(header.data());
+			fwrite(header.data(), 1, header.size(), out);
+
+			fseek(in, _headerSize, SEEK_SET);
+			for (unsigned i = 0; i < count; ++i)
+			{
+				if (fread(_record.data(), 1, _record.size(), in) != _record.size())
+					break;
+				fwrite(_record.data(), 1, _record.size(), out);
+			}
+		}
+		if (in)
+			fclose(in);
+		if (out)
+		{
+			fclose(out);
+			std::remove(_path.c_str()); // rename() won't clobber on windows
+			std::rename(tempPath.c_str(), _path.c_str());
+		}
+	}
+
+protected:
+	std::string _path;
+	unsigned _dataSize;
+	unsigned _blockSize;
+	unsigned _syncEvery;
+	std::vector<uint8_t> _record;
+
+	FILE* _fp = nullptr;
+	unsigned _unsynced = 0;
+	bool _opened = false;
+
+	// what's on disk: block id -> record number
+	std::unordered_map<uint16_t, unsigned> _index;
+	unsigned _records = 0;
+	uint16_t _firstId = 0;
+	uint64_t _firstHash = 0;
+};
@@ -0,0 +1,278 @@
+/* This code is subject to the terms of the Mozilla Public License, v.2.0. http://mozilla.org/MPL/2.0/. */
+#pragma once
+
+#include "FountainManifest.h"
+#include "fountain_encoder_stream.h"
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <future>
+#include <istream>
+#include <memory>
+#include <string>
+#include <vector>
+
+// for files too big (or too slow) for a single fountain_encoder_stream.
+// the file is cut into segments, each with a FountainManifest header and its own encode_id.
+// we send one segment at a time -- blocks_required() chunks of it -- then move on to the next, and eventually wrap around.
+// so the receiver only needs to be working on a segment or two at once.
+//
+// and so do we: segments are read (and packed -- i.e. compressed) from the source when it's their turn, and thrown away
+// when it isn't. Memory goes with the segment size, not the file size -- two segments' worth, since the next one
+// is packed in the background while we send the current one. (so read() doesn't stall on zstd when we switch)
+//
+// each visit to a segment is blocks_required() * redundancy of its chunks. That way the extra chunks are spread
+// across the segments, and a lost one can be made up for before we move on -- not a full wrap later.
+class fountain_segmented_encoder_stream
+{
+public:
+	using ptr = std::shared_ptr<fountain_segmented_encoder_stream>;
+	// raw segment in, what goes over the wire out. Empty == failure. Called from a background thread.
+	using packer = std::function<std::string(std::string&&)>;
+
+protected:
+	struct prepared
+	{
+		fountain_encoder_stream::ptr segment;
+		uint64_t payloadSize = 0;
+	};
+
+protected:
+	fountain_segmented_encoder_stream(std::shared_ptr<std::istream> source, uint64_t size, unsigned buffer_size, uint8_t encode_id, uint32_t segment_size, packer pack)
+		: _source(source)
+		, _pack(pack)
+		, _manifest(encode_id, size, segment_size, 0)
+		, _bufferSize(buffer_size)
+		, _encodeId(encode_id)
+		, _blocks(_manifest.segment_count(), 0)
+		, _payloadSizes(_manifest.segment_count(), 0)
+	{
+		load(0);
+	}
+
+public:
+	~fountain_segmented_encoder_stream()
+	{
+		drop_prefetch();
+	}
+
+	// `source` needs to be seekable, and stick around for as long as we do -- hence the shared_ptr
+	static fountain_segmented_encoder_stream::ptr create(std::shared_ptr<std::istream> source, unsigned buffer_size, uint8_t encode_id=0, uint32_t segment_size=0, packer pack=nullptr)
+	{
+		if (!source or !*source)
+			return nullptr;
+		source->seekg(0, std::ios::end);
+		std::streamoff size = source->tellg();
+		source->seekg(0, std::ios::beg);
+		if (size < 0)
+			return nullptr;
+
+		if (!segment_size)
+			segment_size = FountainManifest::pick_segment_size(size);
+		if (!segment_size or segment_size > FountainManifest::max_segment_size
+			or FountainManifest::segment_count(size, segment_size) > FountainManifest::max_segments)
+			return nullptr;
+		return fountain_segmented_encoder_stream::ptr( new fountain_segmented_encoder_stream(source, size, buffer_size, encode_id & 0x7F, segment_size, pack) );
+	}
+
+	bool good() const
+	{
+		return _segment and _segment->good();
+	}
+
+	// how many times over we send each segment's blocks_required(), per visit. >= 1
+	void set_redundancy(double redundancy)
+	{
+		_redundancy = std::max(1.0, redundancy);
+	}
+
+	void restart()
+	{
+		drop_prefetch();
+		_segment = nullptr;
+		std::fill(_blocks.begin(), _blocks.end(), 0);
+		load(0);
+		_chunkIndex = 0;
+		_chunks = 0;
+		_lastRead = 0;
+	}
+
+	unsigned num_segments() const
+	{
+		return _manifest.segment_count();
+	}
+
+	unsigned block_count() const
+	{
+		unsigned total = 0;
+		for (unsigned i = 0; i < _blocks.size(); ++i)
+			total += (i == _current and _segment)? _segment->block_count() : _blocks[i];
+		return total;
+	}
+
+	// an estimate, until we've packed every segment at least once.
+	// the ones we haven't seen yet are assumed to pack as well as the ones we have.
+	unsigned blocks_required() const
+	{
+		uint64_t packed = 0;
+		uint64_t raw = 0;
+		for (unsigned i = 0; i < _payloadSizes.size(); ++i)
+			if (_payloadSizes[i])
+			{
+				packed += _payloadSizes[i];
+				raw += _manifest.segment_length(i);
+			}
+
+		unsigned blockSize = _bufferSize - FountainMetadata::md_size;
+		unsigned total = 0;
+		for (unsigned i = 0; i < _payloadSizes.size(); ++i)
+		{
+			uint64_t size = _payloadSizes[i];
+			if (!size)
+				size = raw? FountainManifest::md_size + _manifest.segment_length(i) * packed / raw : _manifest.segment_length(i);
+			total += (size / blockSize) + 1;
+		}
+		return total;
+	}
+
+	// we only switch segments on a chunk boundary
+	fountain_segmented_encoder_stream& read(char* data, unsigned length)
+	{
+		std::streamsize totalRead = 0;
+		while (length > 0 and good())
+		{
+			fountain_encoder_stream& seg = *_segment;
+			unsigned readLen = std::min(length, _bufferSize - _chunkIndex);
+			std::streamsize bytes = seg.readsome(data, readLen);
+			if (bytes <= 0)
+				break;
+
+			totalRead += bytes;
+			data += bytes;
+			length -= bytes;
+			_chunkIndex += bytes;
+
+			if (_chunkIndex >= _bufferSize)
+			{
+				_chunkIndex = 0;
+				if (++_chunks >= chunks_per_visit(seg))
+				{
+					_chunks = 0;
+					load((_current + 1) % num_segments());
+				}
+			}
+		}
+		_lastRead = totalRead;
+		return *this;
+	}
+
+	std::streamsize readsome(char* data, unsigned length)
+	{
+		read(data, length);
+		return gcount();
+	}
+
+	std::streamsize gcount() const
+	{
+		return _lastRead;
+	}
+
+protected:
+	unsigned chunks_per_visit(const fountain_encoder_stream& seg) const
+	{
+		return std::ceil(seg.blocks_required() * _redundancy);
+	}
+
+	// swap in segment `index`, picking up its block ids where we left off last time
+	void load(unsigned index)
+	{
+		if (_segment)
+			_blocks[_current] = _segment->block_count();
+		_current = index;
+		if (_segment and num_segments() == 1)
+			return;
+
+		prepared next;
+		if (_prefetch.valid() and _prefetchIndex == index)
+			next = _prefetch.get();
+		else
+		{
+			drop_prefetch();
+			next = prepare(index, _blocks[index]);
+		}
+		_segment = next.segment;
+		if (_segment)
+			_payloadSizes[index] = next.payloadSize;
+
+		// while we send this one, get the next one ready.
+		// its next block id can't change in the meantime: that only happens when we leave it.
+		if (_segment and num_segments() > 1)
+		{
+			_prefetchIndex = (index + 1) % num_segments();
+			unsigned block = _blocks[_prefetchIndex];
+			_prefetch = std::async(std::launch::async | std::launch::deferred, [this, block, i=_prefetchIndex]() {
+				return prepare(i, block);
+			});
+		}
+	}
+
+	void drop_prefetch()
+	{
+		if (_prefetch.valid())
+			_prefetch.wait();
+		_prefetch = std::future<prepared>();
+	}
+
+	// read + pack + wrap in a fountain stream. The only thing (after create()) that touches _source,
+	// and only one of these runs at a time.
+	prepared prepare(unsigned index, unsigned block) const
+	{
+		prepared res;
+		std::string raw(_manifest.segment_length(index), 0);
+		_source->clear();
+		_source->seekg(_manifest.segment_offset(index));
+		_source->read(raw.data(), raw.size());
+		if (_source->gcount() != (std::streamsize)raw.size())
+			return res;
+
+		std::string packed = _pack? _pack(std::move(raw)) : std::move(raw);
+		if (packed.empty() and _manifest.segment_length(index))
+			return res;
+
+		FountainManifest manifest(_encodeId, _manifest.total_size(), _manifest.segment_size(), index, packed.size());
+		std::string payload;
+		// fountain streams need to be at least a block long. The sink knows to ignore the padding.
+		payload.reserve(std::max<size_t>(FountainManifest::md_size + packed.size(), _bufferSize + 1));
+		payload.append((const char*)manifest.data(), FountainManifest::md_size);
+		payload += packed;
+		packed.clear();
+		packed.shrink_to_fit();
+		if (payload.size() <= _bufferSize)
+			payload.resize(_bufferSize + 1, 0);
+
+		res.payloadSize = payload.size();
+		res.segment = fountain_encoder_stream::create(std::move(payload), _bufferSize, _encodeId + index);
+		res.segment->restart(block);
+		return res;
+	}
+
+protected:
+	std::shared_ptr<std::istream> _source;
+	packer _pack;
+	FountainManifest _manifest; // segment 0's. For the sizes
+	unsigned _bufferSize;
+	uint8_t _encodeId;
+
+	fountain_encoder_stream::ptr _segment; // the current one
+	std::vector<unsigned> _blocks; // next block id, per segment
+	std::vector<uint64_t> _payloadSizes; // 0 until we've packed it
+
+	unsigned _current = 0; // segment
+	unsigned _chunkIndex = 0; // bytes into the current chunk
+	unsigned _chunks = 0; // chunks sent from the current segment, this time around
+	std::streamsize _lastRead = 0;
+	double _redundancy = 1.0;
+
+	std::future<prepared> _prefetch; // the segment after _current
+	unsigned _prefetchIndex = 0;
+};
@@ -172,3 +172,42 @@ TEST_CASE( "FountainEncodingTest/testWhichN", "[unit]" )
 	assertEquals( 10, decoder.progress() );
 }
 
+
+TEST_CASE( "FountainEncodingTest/testRecoverChunked", "[unit]" )
+{
+	static const unsigned packetSize = 624;
+
+	unsigned messageSize = 6000;
+	std::string message;
+	while (message.size() < messageSize)
+		message += "0123456789";
+	message.resize(messageSize);
+
+	FountainEncoder encoder((uint8_t*)message.data(), message.size(), packetSize);
+	FountainDecoder decoder(messageSize, packetSize);
+	assertEquals( 10, decoder.blocks_required() );
+
+	// block ids well past blocks_required()
+	std::array<uint8_t,packetSize> block;
+	int block_id = 105;
+	for (; block_id >= 0; block_id -= 1)
+	{
+		unsigned bites = encoder.encode(block_id, block.data(), block.size());
+		if (decoder.decode_block(block_id, block.data(), bites))
+			break;
+
+		// repeats are ignored
+		assertFalse( decoder.decode_block(block_id, block.data(), bites) );
+	}
+	assertEquals( 96, block_id );
+	assertEquals( 10, decoder.progress() );
+
+	stringstream chunked;
+	assertTrue( decoder.recover(chunked) );
+	assertEquals( message, chunked.str() );
+
+	std::vector<uint8_t> flat(messageSize);
+	assertFalse( decoder.recover(flat.data(), flat.size()-1) );
+	assertTrue( decoder.recover(flat.data(), flat.size()) );
+	assertEquals( message, string((char*)flat.data(), flat.size()) );
+}
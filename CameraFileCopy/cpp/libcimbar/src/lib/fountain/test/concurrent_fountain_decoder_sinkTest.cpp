@@ -0,0 +1,158 @@
+/* This code is subject to the terms of the Mozilla Public License, v.2.0. http://mozilla.org/MPL/2.0/. */
+#include "unittest.h"
+
+#include "concurrent_fountain_decoder_sink.h"
+#include "fountain_encoder_stream.h"
+
+#include "serialize/str_join.h"
+#include "util/File.h"
+#include "util/MakeTempDirectory.h"
+#include <atomic>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using std::string;
+using namespace std;
+
+namespace {
+	vector<string> makeChunks(uint8_t encode_id, unsigned size, unsigned count)
+	{
+		stringstream input;
+		for (unsigned i = 0; i < (size/10); ++i)
+			input << "0123456789";
+		fountain_encoder_stream::ptr fes = fountain_encoder_stream::create(input, 690, encode_id);
+
+		vector<string> chunks;
+		std::array<char, 690> buff;
+		for (unsigned i = 0; i < count; ++i)
+		{
+			fes->readsome(buff.data(), buff.size());
+			chunks.push_back(string(buff.data(), buff.size()));
+		}
+		return chunks;
+	}
+
+	void waitForBacklog(const concurrent_fountain_decoder_sink<std::ofstream>& sink)
+	{
+		for (int i = 0; i < 500 and sink.backlog() > 0; ++i)
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+}
+
+TEST_CASE( "ConcurrentFountainDecoderSinkTest/testManyWriters", "[unit]" )
+{
+	MakeTempDirectory tempdir;
+
+	concurrent_fountain_decoder_sink<std::ofstream> sink(tempdir.path(), 690);
+
+	vector<vector<string>> files;
+	for (unsigned i = 0; i < 4; ++i)
+		files.push_back( makeChunks(i, 20000, 40) );
+
+	vector<std::thread> writers;
+	for (unsigned i = 0; i < files.size(); ++i)
+		writers.emplace_back([&sink, &files, i] () {
+			for (const string& chunk : files[i])
+				sink << chunk;
+		});
+	for (std::thread& t : writers)
+		t.join();
+
+	waitForBacklog(sink);
+	assertEquals( 0, sink.backlog() );
+	assertEquals( 0, sink.dropped() );
+	assertEquals( 4, sink.num_done() );
+	assertEquals( 0, sink.num_streams() );
+	assertEquals( "0.20000 1.20000 2.20000 3.20000", turbo::str::join(sink.get_done()) );
+
+	string contents = File(tempdir.path() / "2.20000").read_all();
+	assertEquals( 20000, contents.size() );
+}
+
+TEST_CASE( "ConcurrentFountainDecoderSinkTest/testSplitsWrites", "[unit]" )
+{
+	MakeTempDirectory tempdir;
+
+	concurrent_fountain_decoder_sink<std::ofstream> sink(tempdir.path(), 690);
+
+	vector<string> chunks = makeChunks(5, 20000, 20);
+	string frame;
+	for (unsigned i = 0; i < 10; ++i)
+		frame += chunks[i];
+	assertTrue( sink.write(frame.data(), frame.size()) );
+
+	waitForBacklog(sink);
+	assertEquals( 0, sink.num_done() );
+	assertEquals( 1, sink.num_streams() );
+	assertEquals( "0.333333", turbo::str::join(sink.get_progress()) );
+
+	sink.stop();
+	assertEquals( 0, sink.backlog() );
+}
+
+TEST_CASE( "ConcurrentFountainDecoderSinkTest/testDropsWhenFull", "[unit]" )
+{
+	MakeTempDirectory tempdir;
+
+	vector<string> chunks = makeChunks(6, 20000, 3);
+	string frame = chunks[0] + chunks[1] + chunks[2];
+
+	// no consumer, so nothing gets recycled
+	concurrent_fountain_decoder_sink<std::ofstream> sink(tempdir.path(), 690, 2);
+	sink.stop();
+
+	assertFalse( sink.write(frame.data(), frame.size()) );
+	assertEquals( 2, sink.backlog() );
+	assertEquals( 1, sink.dropped() );
+}
+
+TEST_CASE( "ConcurrentFountainDecoderSinkTest/testLossless", "[unit]" )
+{
+	MakeTempDirectory tempdir;
+
+	// way more chunks than buffers. Nothing gets dropped, the writers just wait their turn.
+	concurrent_fountain_decoder_sink<std::ofstream> sink(tempdir.path(), 690, 2);
+	sink.set_lossless();
+
+	vector<vector<string>> files;
+	for (unsigned i = 0; i < 3; ++i)
+		files.push_back( makeChunks(i, 20000, 30) );
+
+	std::atomic<unsigned> failed = 0;
+	vector<std::thread> writers;
+	for (unsigned i = 0; i < files.size(); ++i)
+		writers.emplace_back([&sink, &files, &failed, i] () {
+			for (const string& chunk : files[i])
+				failed += !sink.write(chunk.data(), chunk.size());
+		});
+	for (std::thread& t : writers)
+		t.join();
+
+	sink.stop();
+	assertEquals( 0, failed );
+	assertEquals( 0, sink.dropped() );
+	assertEquals( 3, sink.num_done() );
+	assertEquals( "0.20000 1.20000 2.20000", turbo::str::join(sink.get_done()) );
+}
+
+TEST_CASE( "ConcurrentFountainDecoderSinkTest/testEvictedPassThrough", "[unit]" )
+{
+	MakeTempDirectory tempdir;
+
+	concurrent_fountain_decoder_sink<std::ofstream> sink(tempdir.path(), 690);
+	sink.set_max_streams(1);
+
+	for (unsigned i = 0; i < 3; ++i)
+		sink << makeChunks(i, 20000, 1).front();
+
+	waitForBacklog(sink);
+	// the counts land just after the backlog does
+	for (int i = 0; i < 100 and sink.num_evicted() < 2; ++i)
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	assertEquals( 1, sink.num_streams() );
+	assertEquals( 2, sink.num_evicted() );
+	assertTrue( sink.memory_usage() > 0 );
+}
@@ -0,0 +1,252 @@
+/* This code is subject to the terms of the Mozilla Public License, v.2.0. http://mozilla.org/MPL/2.0/. */
+#include "unittest.h"
+
+#include "fountain_journal.h"
+#include "fountain_decoder_sink.h"
+#include "fountain_encoder_stream.h"
+
+#include "serialize/str_join.h"
+#include "util/File.h"
+#include "util/MakeTempDirectory.h"
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using std::string;
+using namespace std;
+
+namespace {
+	string journalPath(const MakeTempDirectory& tempdir)
+	{
+		return fmt::format("{}/test.journal", tempdir.path().string());
+	}
+}
+
+TEST_CASE( "FountainJournalTest/testAppendAndReplay", "[unit]" )
+{
+	MakeTempDirectory tempdir;
+	string path = journalPath(tempdir);
+
+	std::array<uint8_t, 4> block = {1, 2, 3, 4};
+	{
+		fountain_journal journal(path, 1000, 4, 2);
+		assertEquals( 0, journal.replay([](uint16_t, const uint8_t*) {}) );
+		assertTrue( journal.good() );
+
+		for (uint16_t id = 0; id < 5; ++id)
+		{
+			block[0] = id;
+			assertTrue( journal.append(id + 300, block.data()) );
+		}
+	}
+
+	vector<string> seen;
+	fountain_journal journal(path, 1000, 4);
+	assertEquals( 5, journal.replay([&seen](uint16_t id, const uint8_t* data) {
+		seen.push_back(fmt::format("{}:{}{}", id, (int)data[0], (int)data[3]));
+	}) );
+	assertEquals( "300:04 301:14 302:24 303:34 304:44", turbo::str::join(seen) );
+
+	// and we can keep going
+	assertTrue( journal.append(400, block.data()) );
+	journal.close();
+	assertEquals( 22 + 6*6, File(path).read_all().size() );
+}
+
+TEST_CASE( "FountainJournalTest/testCheck", "[unit]" )
+{
+	MakeTempDirectory tempdir;
+	string path = journalPath(tempdir);
+
+	std::array<uint8_t, 4> block = {1, 2, 3, 4};
+	{
+		fountain_journal journal(path, 1000, 4);
+		assertEquals( 0, journal.open() );
+		for (uint16_t id = 300; id < 305; ++id)
+		{
+			block[0] = id;
+			journal.append(id, block.data());
+		}
+	}
+
+	fountain_journal journal(path, 1000, 4);
+	assertEquals( 5, journal.open() );
+	assertFalse( journal.good() ); // not until we replay() or discard()
+
+	// the first record is in the header
+	block[0] = 300 & 0xFF;
+	assertEquals( 1, journal.check(300, block.data()) );
+	block[3] = 5;
+	assertEquals( -1, journal.check(300, block.data()) );
+
+	// the rest come off the disk
+	block = {302 & 0xFF, 2, 3, 4};
+	assertEquals( 1, journal.check(302, block.data()) );
+	block[1] = 0;
+	assertEquals( -1, journal.check(302, block.data()) );
+
+	// never seen it, can't say
+	assertEquals( 0, journal.check(299, block.data()) );
+
+	journal.discard();
+	assertTrue( journal.good() );
+	assertEquals( 0, journal.check(302, block.data()) );
+	journal.close();
+	assertEquals( 0, File(path).read_all().size() );
+}
+
+TEST_CASE( "FountainJournalTest/testTornRecord", "[unit]" )
+{
+	MakeTempDirectory tempdir;
+	string path = journalPath(tempdir);
+
+	std::array<uint8_t, 4> block = {1, 2, 3, 4};
+	{
+		fountain_journal journal(path, 1000, 4);
+		journal.replay([](uint16_t, const uint8_t*) {});
+		journal.append(1, block.data());
+		journal.append(2, block.data());
+	}
+	{
+		// we died halfway through a record
+		std::ofstream f(path, std::ios::app | std::ios::binary);
+		f.write("\0\3\1", 3);
+	}
+	assertEquals( 22 + 6*2 + 3, File(path).read_all().size() );
+
+	{
+		fountain_journal journal(path, 1000, 4);
+		assertEquals( 2, journal.replay([](uint16_t, const uint8_t*) {}) );
+		journal.append(3, block.data());
+	}
+	assertEquals( 22 + 6*3, File(path).read_all().size() );
+
+	// different stream params => start over. (the header goes in with the first record)
+	fountain_journal other(path, 1001, 4);
+	assertEquals( 0, other.replay([](uint16_t, const uint8_t*) {}) );
+	other.close();
+	assertEquals( 0, File(path).read_all().size() );
+}
+
+namespace {
+	vector<string> make_chunks(const string& contents, unsigned count)
+	{
+		stringstream input(contents);
+		fountain_encoder_stream::ptr fes = fountain_encoder_stream::create(input, 690, 4);
+
+		vector<string> chunks;
+		std::array<char, 690> buff;
+		for (unsigned i = 0; i < count; ++i)
+		{
+			fes->readsome(buff.data(), buff.size());
+			chunks.push_back(string(buff.data(), buff.size()));
+		}
+		return chunks;
+	}
+
+	string repeat(const string& s, unsigned count)
+	{
+		string res;
+		for (unsigned i = 0; i < count; ++i)
+			res += s;
+		return res;
+	}
+}
+
+TEST_CASE( "FountainJournalTest/testSinkResume", "[unit]" )
+{
+	MakeTempDirectory tempdir;
+	vector<string> chunks = make_chunks(repeat("0123456789", 2000), 40);
+
+	// 20 of the 30 blocks we need, then the receiver goes away
+	{
+		fountain_decoder_sink<std::ofstream> sink(tempdir.path(), 690);
+		sink.set_checkpoint();
+		for (unsigned i = 0; i < 20; ++i)
+			assertFalse( sink.decode_frame(chunks[i].data(), chunks[i].size()) );
+		assertEquals( "0.666667", turbo::str::join(sink.get_progress()) );
+	}
+
+	string journal = fmt::format("{}/.4.20000.journal", tempdir.path().string());
+	assertEquals( 22 + 20*686, File(journal).read_all().size() );
+
+	// a new one picks up where we left off -- once the sender comes back around to a block the journal has
+	fountain_decoder_sink<std::ofstream> sink(tempdir.path(), 690);
+	sink.set_checkpoint();
+	assertFalse( sink.decode_frame(chunks[20].data(), chunks[20].size()) );
+	assertEquals( "0.0333333", turbo::str::join(sink.get_progress()) );
+	assertFalse( sink.decode_frame(chunks[5].data(), chunks[5].size()) );
+	assertEquals( "0.7", turbo::str::join(sink.get_progress()) );
+
+	unsigned i = 21;
+	for (; i < 40; ++i)
+		if (sink.decode_frame(chunks[i].data(), chunks[i].size()))
+			break;
+
+	assertEquals( 29, i );
+	assertEquals( 1, sink.num_done() );
+	assertEquals( 20000, File(tempdir.path() / "4.20000").read_all().size() );
+	assertFalse( std::ifstream(journal).good() );
+}
+
+TEST_CASE( "FountainJournalTest/testSinkStaleJournal", "[unit]" )
+{
+	MakeTempDirectory tempdir;
+	string journal = fmt::format("{}/.4.20000.journal", tempdir.path().string());
+
+	// a transfer we didn't finish...
+	{
+		vector<string> chunks = make_chunks(repeat("0123456789", 2000), 20);
+		fountain_decoder_sink<std::ofstream> sink(tempdir.path(), 690);
+		sink.set_checkpoint();
+		for (const string& chunk : chunks)
+			sink.decode_frame(chunk.data(), chunk.size());
+	}
+	assertEquals( 22 + 20*686, File(journal).read_all().size() );
+
+	// ...and a different file that happens to get the same encode_id. Same size, same block ids.
+	string expected = repeat("abcdefghij", 2000);
+	vector<string> chunks = make_chunks(expected, 40);
+
+	fountain_decoder_sink<std::ofstream> sink(tempdir.path(), 690);
+	sink.set_checkpoint();
+	assertFalse( sink.decode_frame(chunks[0].data(), chunks[0].size()) );
+	// block 0 didn't match, so the stale blocks are gone. It's just us now
+	assertEquals( "0.0333333", turbo::str::join(sink.get_progress()) );
+
+	unsigned i = 1;
+	for (; i < 40; ++i)
+		if (sink.decode_frame(chunks[i].data(), chunks[i].size()))
+			break;
+
+	// we needed all of our own blocks, and got our own file back
+	assertEquals( 29, i );
+	assertEquals( expected, File(tempdir.path() / "4.20000").read_all() );
+	assertFalse( std::ifstream(journal).good() );
+}
+
+TEST_CASE( "FountainJournalTest/testSinkEvictErasesJournal", "[unit]" )
+{
+	MakeTempDirectory tempdir;
+	string journal = fmt::format("{}/.4.20000.journal", tempdir.path().string());
+
+	vector<string> chunks = make_chunks(repeat("0123456789", 2000), 5);
+
+	fountain_decoder_sink<std::ofstream> sink(tempdir.path(), 690);
+	sink.set_checkpoint();
+	sink.set_max_streams(1);
+	for (const string& chunk : chunks)
+		sink.decode_frame(chunk.data(), chunk.size());
+	assertTrue( std::ifstream(journal).good() );
+
+	// someone else's turn
+	stringstream input(repeat("z", 5000));
+	fountain_encoder_stream::ptr fes = fountain_encoder_stream::create(input, 690, 5);
+	std::array<char, 690> buff;
+	fes->readsome(buff.data(), buff.size());
+	sink.decode_frame(buff.data(), buff.size());
+
+	assertEquals( 1, sink.num_evicted() );
+	assertFalse( std::ifstream(journal).good() );
+}
@@ -0,0 +1,282 @@
+/* This code is subject to the terms of the Mozilla Public License, v.2.0. http://mozilla.org/MPL/2.0/. */
+#include "unittest.h"
+
+#include "FountainManifest.h"
+#include "fountain_segmented_encoder_stream.h"
+#include "fountain_decoder_sink.h"
+
+#include "serialize/str_join.h"
+#include "util/File.h"
+#include "util/MakeTempDirectory.h"
+#include <atomic>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <set>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+using std::string;
+using namespace std;
+
+namespace {
+	string dummyContents(unsigned size)
+	{
+		string input;
+		for (unsigned i = 0; input.size() < size; ++i)
+			input += fmt::format("{},", i);
+		input.resize(size);
+		return input;
+	}
+}
+
+TEST_CASE( "FountainSegmentTest/testManifest", "[unit]" )
+{
+	FountainManifest manifest(5, 0x12345678ULL, 3000000, 2, 2500000);
+	assertTrue( manifest.good() );
+
+	FountainManifest other((const char*)manifest.data(), FountainManifest::md_size);
+	assertTrue( other.good() );
+	assertEquals( 5, other.encode_id() );
+	assertEquals( 2, other.index() );
+	assertEquals( 0x12345678ULL, other.total_size() );
+	assertEquals( 3000000, other.segment_size() );
+	assertEquals( 102, other.segment_count() );
+	assertEquals( 2500000, other.payload_length() );
+	assertEquals( manifest.key(), other.key() );
+
+	// too many segments for 7 bit encode_ids
+	assertFalse( FountainManifest(5, 0x123456789ULL, 3000000, 2).good() );
+
+	FountainManifest small(0, 10000, 3000, 3);
+	assertTrue( small.good() );
+	assertEquals( 4, small.segment_count() );
+	assertEquals( 9000, small.segment_offset(3) );
+	assertEquals( 1000, small.segment_length(3) );
+	assertEquals( 3000, small.segment_length(0) );
+
+	assertFalse( FountainManifest(0, 10000, 3000, 4).good() );
+
+	string junk = "CFSG junk";
+	assertFalse( FountainManifest(junk.data(), junk.size()).good() );
+}
+
+TEST_CASE( "FountainSegmentTest/testPickSegmentSize", "[unit]" )
+{
+	assertEquals( FountainManifest::default_segment_size, FountainManifest::pick_segment_size(1000) );
+	assertEquals( FountainManifest::default_segment_size, FountainManifest::pick_segment_size(100000000) );
+	assertEquals( 15625000, FountainManifest::pick_segment_size(2000000000) );
+	assertEquals( 0, FountainManifest::pick_segment_size(10000000000ULL) );
+}
+
+TEST_CASE( "FountainSegmentTest/testRoundTrip", "[unit]" )
+{
+	MakeTempDirectory tempdir;
+
+	string contents = dummyContents(10000);
+	fountain_segmented_encoder_stream::ptr fes = fountain_segmented_encoder_stream::create(std::make_shared<stringstream>(contents), 690, 3, 3000);
+	assertTrue( fes );
+	assertTrue( fes->good() );
+	assertEquals( 4, fes->num_segments() );
+
+	fountain_decoder_sink<std::ofstream> sink(tempdir.path(), 690);
+
+	std::array<char, 690> buff;
+	unsigned chunks = 0;
+	for (; chunks < 1000 and sink.num_done() == 0; ++chunks)
+	{
+		assertEquals( buff.size(), fes->readsome(buff.data(), buff.size()) );
+		if (chunks % 4 == 1) // some packet loss
+			continue;
+		sink.decode_frame(buff.data(), buff.size());
+	}
+
+	assertEquals( 1, sink.num_done() );
+	assertEquals( "3.10000", turbo::str::join(sink.get_done()) );
+	assertEquals( 0, sink.num_streams() );
+
+	string actual = File(tempdir.path() / "3.10000").read_all();
+	assertEquals( contents, actual );
+
+	// no leftover segments
+	for (unsigned i = 0; i < 4; ++i)
+		assertFalse( std::ifstream(fmt::format("{}/.3.10000.part{}", tempdir.path().string(), i)).good() );
+}
+
+TEST_CASE( "FountainSegmentTest/testTinyLastSegment", "[unit]" )
+{
+	MakeTempDirectory tempdir;
+
+	// last segment is smaller than a fountain block, so it gets padded
+	string contents = dummyContents(6100);
+	fountain_segmented_encoder_stream::ptr fes = fountain_segmented_encoder_stream::create(std::make_shared<stringstream>(contents), 690, 120, 3000);
+	assertTrue( fes );
+	assertEquals( 3, fes->num_segments() );
+
+	fountain_decoder_sink<std::ofstream> sink(tempdir.path(), 690);
+	// small reads are fine too -- we only switch segments on chunk boundaries
+	std::array<char, 115> buff;
+	for (unsigned i = 0; i < 1000 and sink.num_done() == 0; ++i)
+	{
+		string chunk;
+		for (int r = 0; r < 6; ++r)
+		{
+			assertEquals( buff.size(), fes->readsome(buff.data(), buff.size()) );
+			chunk += string(buff.data(), buff.size());
+		}
+		sink << chunk;
+	}
+
+	assertEquals( "120.6100", turbo::str::join(sink.get_done()) );
+	assertEquals( contents, File(tempdir.path() / "120.6100").read_all() );
+}
+
+TEST_CASE( "FountainSegmentTest/testPacker", "[unit]" )
+{
+	MakeTempDirectory tempdir;
+
+	// whatever the packer makes of a segment is what gets sent -- and what comes out the other end, back to back.
+	// (for real, it's zstd on the way in and a zstd_decompressor on the way out)
+	string contents = dummyContents(10000);
+	std::atomic<unsigned> packed = 0;
+	fountain_segmented_encoder_stream::packer pack = [&packed](std::string&& raw) {
+		++packed;
+		return raw.substr(0, raw.size()/2);
+	};
+	fountain_segmented_encoder_stream::ptr fes = fountain_segmented_encoder_stream::create(std::make_shared<stringstream>(contents), 690, 7, 3000, pack);
+	assertTrue( fes );
+	assertEquals( 4, fes->num_segments() );
+	// the one we're on, and (maybe already) the next one
+	assertInRange( 1, packed, 2 );
+
+	fountain_decoder_sink<std::ofstream> sink(tempdir.path(), 690);
+	std::array<char, 690> buff;
+	for (unsigned i = 0; i < 1000 and sink.num_done() == 0; ++i)
+	{
+		assertEquals( buff.size(), fes->readsome(buff.data(), buff.size()) );
+		sink.decode_frame(buff.data(), buff.size());
+	}
+
+	string expected = contents.substr(0, 1500) + contents.substr(3000, 1500) + contents.substr(6000, 1500) + contents.substr(9000, 500);
+	assertEquals( "7.10000", turbo::str::join(sink.get_done()) );
+	assertEquals( expected, File(tempdir.path() / "7.10000").read_all() );
+	// (+1 if the last chunk we read moved us back around to the start, +1 more for the one after that)
+	assertInRange( 4, packed, 6 );
+}
+
+TEST_CASE( "FountainSegmentTest/testWrapAround", "[unit]" )
+{
+	// we forget a segment when we move on from it. When we come back, it should pick up with new blocks, not repeat old ones
+	string contents = dummyContents(10000);
+	fountain_segmented_encoder_stream::ptr fes = fountain_segmented_encoder_stream::create(std::make_shared<stringstream>(contents), 690, 3, 3000);
+	assertTrue( fes );
+
+	unsigned required = fes->blocks_required();
+	std::set<std::pair<unsigned, unsigned>> seen;
+	std::array<char, 690> buff;
+	for (unsigned i = 0; i < required * 3; ++i)
+	{
+		assertEquals( buff.size(), fes->readsome(buff.data(), buff.size()) );
+		FountainMetadata md(buff.data(), buff.size());
+		assertTrue( seen.insert({md.encode_id(), md.block_id()}).second );
+	}
+	// (the odd block id gets skipped, so it's at least this many)
+	assertTrue( fes->block_count() >= required * 3 );
+
+	fes->restart();
+	assertEquals( 0, fes->block_count() );
+	assertEquals( buff.size(), fes->readsome(buff.data(), buff.size()) );
+	assertEquals( 3, FountainMetadata(buff.data(), buff.size()).encode_id() );
+	assertEquals( 0, FountainMetadata(buff.data(), buff.size()).block_id() );
+}
+
+TEST_CASE( "FountainSegmentTest/testInterleaved", "[unit]" )
+{
+	MakeTempDirectory tempdir;
+
+	// two transfers of the same size at once. Each stream is its own, whatever it has in common with the other
+	string first = dummyContents(10000);
+	string second = first;
+	std::reverse(second.begin(), second.end());
+	fountain_segmented_encoder_stream::ptr a = fountain_segmented_encoder_stream::create(std::make_shared<stringstream>(first), 690, 3, 3000);
+	fountain_segmented_encoder_stream::ptr b = fountain_segmented_encoder_stream::create(std::make_shared<stringstream>(second), 690, 40, 3000);
+
+	fountain_decoder_sink<std::ofstream> sink(tempdir.path(), 690);
+	std::array<char, 690> buff;
+	unsigned chunks = 0;
+	for (; chunks < 2000 and sink.num_done() < 2; ++chunks)
+	{
+		fountain_segmented_encoder_stream& fes = (chunks % 2)? *b : *a;
+		assertEquals( buff.size(), fes.readsome(buff.data(), buff.size()) );
+		sink.decode_frame(buff.data(), buff.size());
+	}
+
+	// nobody lost any progress: it took no more chunks than the two of them sent separately
+	assertTrue( chunks <= 2 * a->blocks_required() + 2 );
+	assertEquals( 2, sink.num_done() );
+	assertEquals( first, File(tempdir.path() / "3.10000").read_all() );
+	assertEquals( second, File(tempdir.path() / "40.10000").read_all() );
+}
+
+TEST_CASE( "FountainSegmentTest/testAssembledAgesOut", "[unit]" )
+{
+	MakeTempDirectory tempdir;
+
+	fountain_decoder_sink<std::ofstream> sink(tempdir.path(), 690);
+	sink.set_max_done(2);
+
+	std::array<char, 690> buff;
+	for (unsigned encodeId : {10, 20, 30})
+	{
+		fountain_segmented_encoder_stream::ptr fes = fountain_segmented_encoder_stream::create(std::make_shared<stringstream>(dummyContents(10000)), 690, encodeId, 3000);
+		unsigned before = sink.num_done();
+		for (unsigned i = 0; i < 1000 and sink.num_done() == before; ++i)
+		{
+			assertEquals( buff.size(), fes->readsome(buff.data(), buff.size()) );
+			sink.decode_frame(buff.data(), buff.size());
+		}
+	}
+
+	// all 3 made it to disk. We only remember the most recent
+	for (unsigned encodeId : {10, 20, 30})
+		assertTrue( std::ifstream(fmt::format("{}/{}.10000", tempdir.path().string(), encodeId)).good() );
+	assertEquals( "20.10000 30.10000", turbo::str::join(sink.get_done()) );
+	assertEquals( 2, sink.num_done() );
+}
+
+TEST_CASE( "FountainSegmentTest/testRedundancy", "[unit]" )
+{
+	MakeTempDirectory tempdir;
+
+	// 3 segments of 5 blocks, and one of 2. Each visit sends twice what the segment needs
+	string contents = dummyContents(10000);
+	fountain_segmented_encoder_stream::ptr fes = fountain_segmented_encoder_stream::create(std::make_shared<stringstream>(contents), 690, 3, 3000);
+	assertTrue( fes );
+	assertEquals( 17, fes->blocks_required() );
+	fes->set_redundancy(2);
+
+	fountain_decoder_sink<std::ofstream> sink(tempdir.path(), 690);
+	std::vector<unsigned> visits;
+	unsigned lastId = ~0U;
+	std::array<char, 690> buff;
+	for (unsigned chunks = 0; chunks < 34; ++chunks)
+	{
+		assertEquals( buff.size(), fes->readsome(buff.data(), buff.size()) );
+		FountainMetadata md(buff.data(), buff.size());
+		if (md.encode_id() != lastId)
+			visits.push_back(0);
+		++visits.back();
+		lastId = md.encode_id();
+
+		if (chunks % 3 == 1) // a third of them don't make it
+			continue;
+		sink.decode_frame(buff.data(), buff.size());
+	}
+	assertEquals( "10 10 10 4", turbo::str::join(visits) );
+
+	// ... and it's enough to get everything the first time through
+	assertEquals( 1, sink.num_done() );
+	assertEquals( contents, File(tempdir.path() / "3.10000").read_all() );
+}
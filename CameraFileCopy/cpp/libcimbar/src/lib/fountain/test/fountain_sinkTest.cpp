@@ -139,3 +139,149 @@ TEST_CASE( "FountainSinkTest/testSameFrameManyTimes", "[unit]" )
 	assertEquals( "0.333333", turbo::str::join(sink.get_progress()) ); // 33% done
 	assertEquals( "", turbo::str::join(sink.get_done()) );
 }
+
+TEST_CASE( "FountainSinkTest/testManyStreams", "[unit]" )
+{
+	MakeTempDirectory tempdir;
+
+	fountain_decoder_sink<std::ofstream> sink(tempdir.path(), 690);
+	sink.set_max_streams(16);
+
+	// encode_ids 0 and 8 used to share a slot
+	vector<fountain_encoder_stream::ptr> encoders;
+	vector<stringstream> inputs;
+	for (unsigned i = 0; i < 16; ++i)
+	{
+		inputs.push_back(dummyContents(20000));
+		encoders.push_back( fountain_encoder_stream::create(inputs.back(), 690, i) );
+	}
+
+	for (int round = 0; round < 3; ++round)
+		for (fountain_encoder_stream::ptr& fes : encoders)
+		{
+			string iframe = createFrame(*fes);
+			sink.decode_frame(iframe.data(), iframe.size());
+		}
+
+	assertEquals( 16, sink.num_done() );
+	assertEquals( 0, sink.num_streams() );
+	assertEquals( 0, sink.num_evicted() );
+}
+
+TEST_CASE( "FountainSinkTest/testEvictLeastRecentlyUsed", "[unit]" )
+{
+	MakeTempDirectory tempdir;
+
+	fountain_decoder_sink<std::ofstream> sink(tempdir.path(), 690);
+	sink.set_max_streams(2);
+
+	stringstream in0 = dummyContents(20000), in1 = dummyContents(20000), in2 = dummyContents(20000);
+	fountain_encoder_stream::ptr fes0 = fountain_encoder_stream::create(in0, 690, 0);
+	fountain_encoder_stream::ptr fes1 = fountain_encoder_stream::create(in1, 690, 1);
+	fountain_encoder_stream::ptr fes2 = fountain_encoder_stream::create(in2, 690, 2);
+
+	string frame = createFrame(*fes0);
+	assertFalse( sink.decode_frame(frame.data(), frame.size()) );
+	frame = createFrame(*fes1);
+	assertFalse( sink.decode_frame(frame.data(), frame.size()) );
+	frame = createFrame(*fes0); // 0 is now more recent than 1
+	assertFalse( sink.decode_frame(frame.data(), frame.size()) );
+
+	frame = createFrame(*fes2);
+	assertFalse( sink.decode_frame(frame.data(), frame.size()) );
+	assertEquals( 2, sink.num_streams() );
+	assertEquals( 1, sink.num_evicted() );
+
+	// 0 kept its progress
+	frame = createFrame(*fes0);
+	assertTrue( sink.decode_frame(frame.data(), frame.size()) );
+	assertEquals( "0.20000", turbo::str::join(sink.get_done()) );
+	assertEquals( "0.333333", turbo::str::join(sink.get_progress()) );
+}
+
+TEST_CASE( "FountainSinkTest/testMemoryBudget", "[unit]" )
+{
+	MakeTempDirectory tempdir;
+
+	fountain_decoder_sink<std::ofstream> sink(tempdir.path(), 690);
+
+	stringstream in0 = dummyContents(20000), in1 = dummyContents(20000);
+	fountain_encoder_stream::ptr fes0 = fountain_encoder_stream::create(in0, 690, 0);
+	fountain_encoder_stream::ptr fes1 = fountain_encoder_stream::create(in1, 690, 1);
+
+	string frame = createFrame(*fes0);
+	sink.decode_frame(frame.data(), frame.size());
+	size_t oneStream = sink.memory_usage();
+	assertTrue( oneStream >= 20000 );
+
+	// room for one, not two
+	sink.set_memory_budget(oneStream * 3 / 2);
+	frame = createFrame(*fes1);
+	sink.decode_frame(frame.data(), frame.size());
+
+	assertEquals( 1, sink.num_streams() );
+	assertEquals( 1, sink.num_evicted() );
+	assertTrue( sink.memory_usage() <= sink.memory_budget() );
+}
+
+TEST_CASE( "FountainSinkTest/testMemoryBudgetAsStreamsGrow", "[unit]" )
+{
+	MakeTempDirectory tempdir;
+
+	stringstream in0 = dummyContents(20000), in1 = dummyContents(20000);
+	fountain_encoder_stream::ptr fes0 = fountain_encoder_stream::create(in0, 690, 0);
+	fountain_encoder_stream::ptr fes1 = fountain_encoder_stream::create(in1, 690, 1);
+
+	std::vector<string> chunks1;
+	std::array<char, 690> buff;
+	for (int i = 0; i < 25; ++i)
+	{
+		fes1->readsome(buff.data(), buff.size());
+		chunks1.push_back(string(buff.data(), buff.size()));
+	}
+
+	// a journal for stream 1 with blocks 20-24...
+	{
+		fountain_decoder_sink<std::ofstream> sink(tempdir.path(), 690);
+		sink.set_checkpoint();
+		for (int i = 20; i < 25; ++i)
+			sink.decode_frame(chunks1[i].data(), chunks1[i].size());
+	}
+
+	fountain_decoder_sink<std::ofstream> sink(tempdir.path(), 690);
+	sink.set_checkpoint();
+
+	fes0->readsome(buff.data(), buff.size());
+	sink.decode_frame(buff.data(), buff.size());
+	sink.decode_frame(chunks1[0].data(), chunks1[0].size());
+
+	sink.set_memory_budget(sink.memory_usage() + 3000);
+	assertEquals( 2, sink.num_streams() );
+	assertEquals( 0, sink.num_evicted() );
+
+	// ...so the live blocks 1-9 pile up until it can vouch for them. Nobody new shows up, but we still go over budget
+	for (int i = 1; i < 10; ++i)
+		sink.decode_frame(chunks1[i].data(), chunks1[i].size());
+
+	assertEquals( 1, sink.num_streams() );
+	assertEquals( 1, sink.num_evicted() );
+	assertEquals( "0.333333", turbo::str::join(sink.get_progress()) );
+}
+
+TEST_CASE( "FountainSinkTest/testForgetOldDone", "[unit]" )
+{
+	MakeTempDirectory tempdir;
+
+	fountain_decoder_sink<std::ofstream> sink(tempdir.path(), 690);
+	sink.set_max_done(2);
+
+	for (unsigned i = 0; i < 3; ++i)
+	{
+		string frame = createFrame(i, 1200);
+		assertTrue( sink.decode_frame(frame.data(), frame.size()) );
+	}
+
+	assertEquals( 2, sink.num_done() );
+	assertFalse( sink.is_done(FountainMetadata(0, 1200, 0).id()) );
+	assertTrue( sink.is_done(FountainMetadata(2, 1200, 0).id()) );
+}
@@ -104,6 +104,23 @@ public:
 #endif
     }
 
+    // keep the window responsive when we have nothing new to show()
+    void poll()
+    {
+#if !defined(CIMBAR_IOS_PLATFORM)
+        glfwPollEvents();
+#endif
+    }
+
+    void set_title(const std::string& title)
+    {
+        _title = title;
+#if !defined(CIMBAR_IOS_PLATFORM)
+        if (_w)
+            glfwSetWindowTitle(_w, title.c_str());
+#endif
+    }
+
     unsigned width() const
     {
         return _width;
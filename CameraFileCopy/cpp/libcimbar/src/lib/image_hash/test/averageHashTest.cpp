@@ -58,3 +58,19 @@ TEST_CASE( "averageHashTest/test8x8.Resize", "[unit]" )
 	assertEquals(0xfffefcf8f0e0c080, image_hash::average_hash(big));
 }
 
+
+TEST_CASE( "averageHashTest/testPrecomputedTileHashes", "[unit]" )
+{
+	// bitmaps.h ships the tile hashes, so make sure they agree with the real thing
+	for (unsigned symbolBits : {2, 4})
+		for (bool dark : {true, false})
+			for (unsigned color : {0, 1, 2, 3})
+				for (unsigned i = 0; i < (1U << symbolBits); ++i)
+				{
+					DYNAMIC_SECTION( "tile " << symbolBits << "," << dark << "," << color << "," << i )
+					{
+						cv::Mat tile = cimbar::getTile(symbolBits, i, dark, 4, color);
+						assertEquals( image_hash::average_hash(tile), cimbar::getTileHash(symbolBits, i, dark) );
+					}
+				}
+}
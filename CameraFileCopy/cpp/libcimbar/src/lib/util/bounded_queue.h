@@ -0,0 +1,133 @@
+/* This code is subject to the terms of the Mozilla Public License, v.2.0. http://mozilla.org/MPL/2.0/. */
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <optional>
+
+// fixed size, blocking, many producer/many consumer.
+// push() waits for room, pop() waits for work. close() wakes everyone up: pushes fail, pops drain what's left.
+// push_latest() never waits -- if we're full, the oldest item is thrown out to make room. For "latest frame wins" producers.
+template <typename T>
+class bounded_queue
+{
+public:
+	bounded_queue(unsigned capacity)
+		: _capacity(std::max(1U, capacity))
+	{}
+
+	bool push(T item)
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		_notFull.wait(lock, [this]() { return _items.size() < _capacity or _closed; });
+		if (_closed)
+			return false;
+
+		_items.push_back(std::move(item));
+		lock.unlock();
+		_notEmpty.notify_one();
+		return true;
+	}
+
+	bool push_latest(T item)
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		if (_closed)
+			return false;
+
+		if (_items.size() >= _capacity)
+		{
+			_items.pop_front();
+			++_dropped;
+		}
+		_items.push_back(std::move(item));
+		lock.unlock();
+		_notEmpty.notify_one();
+		return true;
+	}
+
+	std::optional<T> pop()
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		_notEmpty.wait(lock, [this]() { return !_items.empty() or _closed; });
+		if (_items.empty())
+			return std::nullopt;
+
+		T item = std::move(_items.front());
+		_items.pop_front();
+		lock.unlock();
+		_notFull.notify_one();
+		return item;
+	}
+
+	// pop(), but never wait. For workers that get scheduled when there's (probably) something to do.
+	std::optional<T> try_pop()
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		if (_items.empty())
+			return std::nullopt;
+
+		T item = std::move(_items.front());
+		_items.pop_front();
+		lock.unlock();
+		_notFull.notify_one();
+		return item;
+	}
+
+	// pop(), but give up after `timeout`. For threads that have other things to look after (like a window).
+	template <typename Rep, typename Period>
+	std::optional<T> pop_for(const std::chrono::duration<Rep, Period>& timeout)
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		_notEmpty.wait_for(lock, timeout, [this]() { return !_items.empty() or _closed; });
+		if (_items.empty())
+			return std::nullopt;
+
+		T item = std::move(_items.front());
+		_items.pop_front();
+		lock.unlock();
+		_notFull.notify_one();
+		return item;
+	}
+
+	void close()
+	{
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_closed = true;
+		}
+		_notFull.notify_all();
+		_notEmpty.notify_all();
+	}
+
+	unsigned size() const
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		return _items.size();
+	}
+
+	unsigned capacity() const
+	{
+		return _capacity;
+	}
+
+	// how many items push_latest() has thrown away
+	unsigned dropped() const
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		return _dropped;
+	}
+
+protected:
+	unsigned _capacity;
+	std::deque<T> _items;
+	bool _closed = false;
+	unsigned _dropped = 0;
+
+	mutable std::mutex _mutex;
+	std::condition_variable _notFull;
+	std::condition_variable _notEmpty;
+};
@@ -1243,6 +1243,7 @@ public:
     GF256_FORCE_INLINE uint32_t PSeed() const { return _p_seed; }
     GF256_FORCE_INLINE uint32_t CSeed() const { return _d_seed; }
     GF256_FORCE_INLINE uint32_t BlockCount() const { return _block_count; }
+    GF256_FORCE_INLINE uint64_t AllocatedBytes() const { return _input_allocated + _workspace_allocated + _ge_allocated; }
 
 
     //--------------------------------------------------------------------------
@@ -304,6 +304,16 @@ WIREHAIR_EXPORT WirehairResult wirehair_decoder_becomes_encoder(
     WirehairCodec codec ///< Codec to change
 );
 
+/**
+    wirehair_allocated_bytes()
+
+    Returns the number of bytes currently allocated by the codec for its
+    input, workspace and matrix buffers.  Returns 0 for a null codec.
+*/
+WIREHAIR_EXPORT uint64_t wirehair_allocated_bytes(
+    WirehairCodec codec ///< Codec to inspect
+);
+
 /**
     wirehair_free()
 
@@ -242,6 +242,19 @@ WIREHAIR_EXPORT WirehairResult wirehair_decoder_becomes_encoder(
     return encoder->InitializeEncoderFromDecoder();
 }
 
+WIREHAIR_EXPORT uint64_t wirehair_allocated_bytes(
+    WirehairCodec codec ///< Codec to inspect
+)
+{
+    if (!codec) {
+        return 0;
+    }
+
+    wirehair::Codec* object = reinterpret_cast<wirehair::Codec*>(codec);
+
+    return object->AllocatedBytes();
+}
+
 WIREHAIR_EXPORT void wirehair_free(
     WirehairCodec codec ///< Codec object to free
 )